@@ -0,0 +1,1287 @@
+/******************************************************************************//**
+ * @file
+ * @brief Benchmarks of the glicko system
+ *
+ * @copyright Copyright (C) by Doru Julian Bugariu
+ * julian@bugariu.eu
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the
+ * Free Software Foundation
+ * 51 Franklin Street, Fifth Floor
+ * Boston, MA 02110-1301, USA
+ * http://www.fsf.org/about/contact.html
+ *********************************************************************************/
+
+
+#include "glicko.h"
+#include "partition.h"
+#include "replay.h"
+#include "workload.h"
+
+#include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+/**
+ * @brief Benchmark state, in the style of Google Benchmark.
+ *
+ * The benchmark body runs "for(auto _ : state)" and may exclude setup code
+ * from the measurement with PauseTiming/ResumeTiming.
+ */
+class State
+{
+public:
+    /**
+     * @brief Iterator of the benchmark loop.
+     */
+    class Iterator
+    {
+    public:
+        /**
+         * @brief Value of an iteration, empty and marked unused like in Google Benchmark.
+         */
+        struct [[maybe_unused]] Value
+        {
+        };
+        /**
+         * @brief Constructor.
+         *
+         * @param[in]   state       The state.
+         * @param[in]   remaining   Number of remaining iterations.
+         */
+        Iterator(State *state, std::size_t remaining):
+            m_State{state},
+            m_Remaining{remaining}
+        {
+        }
+        /**
+         * @brief Dereference (unused value).
+         *
+         * @return  Empty value.
+         */
+        Value operator*() const
+        {
+            return {};
+        }
+        /**
+         * @brief Next iteration.
+         *
+         * @return  This iterator.
+         */
+        Iterator & operator++()
+        {
+            --m_Remaining;
+            return *this;
+        }
+        /**
+         * @brief Check for end of loop, stops the timer at the end.
+         *
+         * @return  true while iterations remain.
+         */
+        bool operator!=(const Iterator &) const
+        {
+            if(m_Remaining == 0)
+            {
+                m_State->PauseTiming();
+                return false;
+            }
+            return true;
+        }
+    private:
+        State *     m_State;        ///< The state.
+        std::size_t m_Remaining;    ///< Number of remaining iterations.
+    };
+    /**
+     * @brief Constructor.
+     *
+     * @param[in]   iterations  Number of iterations to run.
+     */
+    explicit State(std::size_t iterations):
+        m_Iterations{iterations}
+    {
+    }
+    /**
+     * @brief Start of the benchmark loop, starts the timer.
+     *
+     * @return  Iterator.
+     */
+    Iterator begin()
+    {
+        ResumeTiming();
+        return {this, m_Iterations};
+    }
+    /**
+     * @brief End of the benchmark loop.
+     *
+     * @return  Iterator.
+     */
+    Iterator end()
+    {
+        return {this, 0};
+    }
+    /**
+     * @brief Stop the timer.
+     */
+    void PauseTiming()
+    {
+        if(m_Running)
+        {
+            m_Elapsed += std::chrono::duration<double>(std::chrono::steady_clock::now() - m_Start).count();
+            m_Running = false;
+        }
+    }
+    /**
+     * @brief Start the timer.
+     */
+    void ResumeTiming()
+    {
+        m_Start = std::chrono::steady_clock::now();
+        m_Running = true;
+    }
+    /**
+     * @brief Set number of processed items for throughput reporting.
+     *
+     * @param[in]   items   Total number of items of all iterations.
+     */
+    void SetItemsProcessed(double items)
+    {
+        m_Items = items;
+    }
+    /**
+     * @brief Get number of iterations.
+     *
+     * @return  Number of iterations.
+     */
+    std::size_t GetIterations() const
+    {
+        return m_Iterations;
+    }
+    /**
+     * @brief Get measured time.
+     *
+     * @return  Time in seconds.
+     */
+    double GetElapsed() const
+    {
+        return m_Elapsed;
+    }
+    /**
+     * @brief Get number of processed items.
+     *
+     * @return  Number of items, 0 if not set.
+     */
+    double GetItems() const
+    {
+        return m_Items;
+    }
+private:
+    std::size_t                             m_Iterations{0};    ///< Number of iterations.
+    double                                  m_Elapsed{0};       ///< Measured time.
+    double                                  m_Items{0};         ///< Number of processed items.
+    bool                                    m_Running{false};   ///< Timer is running.
+    std::chrono::steady_clock::time_point   m_Start;            ///< Start of current measurement.
+};
+
+
+/**
+ * @brief Command line options.
+ */
+struct Options
+{
+    std::string                 filter;             ///< Only run benchmarks whose name contains this.
+    double                      minTime{0.5};       ///< Minimum measured time per benchmark in seconds.
+    std::string                 outFile;            ///< JSON output file.
+    glicko::workload::Settings  workload;           ///< Workload settings.
+    unsigned                    threads{0};         ///< Threads of the multi-threaded benchmarks, 0 for all cores.
+};
+
+
+/**
+ * @brief Result of one benchmark.
+ */
+struct Result
+{
+    std::string     name;               ///< Benchmark name.
+    std::size_t     iterations{0};      ///< Number of iterations.
+    double          timePerIteration{0};///< Time per iteration in ns.
+    double          itemsPerSecond{0};  ///< Throughput, 0 if not reported.
+};
+
+
+/**
+ * @brief Configuration with statistics of each rating period.
+ */
+struct StatisticsTraits : glicko::DefaultTraits
+{
+    static constexpr bool STATISTICS = true;    ///< Collect statistics.
+};
+
+
+/**
+ * @brief Configuration with an ordered map index.
+ */
+struct OrderedIndexTraits : glicko::DefaultTraits
+{
+    template <typename IDTYPE> using index_type = glicko::index::OrderedIndex<IDTYPE>;      ///< Index of the players.
+};
+
+
+/**
+ * @brief Configuration with a hash table index.
+ */
+struct HashIndexTraits : glicko::DefaultTraits
+{
+    template <typename IDTYPE> using index_type = glicko::index::HashIndex<IDTYPE>;         ///< Index of the players.
+};
+
+
+/**
+ * @brief Configuration with a direct-indexed vector index.
+ */
+struct DenseIndexTraits : glicko::DefaultTraits
+{
+    template <typename IDTYPE> using index_type = glicko::index::DenseIndex<IDTYPE>;        ///< Index of the players.
+};
+
+
+/**
+ * @brief Configuration with a perfect hash index.
+ */
+struct PerfectHashIndexTraits : glicko::DefaultTraits
+{
+    template <typename IDTYPE> using index_type = glicko::index::PerfectHashIndex<IDTYPE>;  ///< Index of the players.
+};
+
+
+Options                                                             g_Options;      ///< Command line options.
+volatile double                                                     g_Sink;         ///< Keeps results of lookups alive.
+std::vector<std::pair<std::string, std::function<void(State &)>>>  g_Benchmarks;   ///< Registered benchmarks.
+
+
+/**
+ * @brief Register a benchmark.
+ *
+ * @param[in]   name        Benchmark name.
+ * @param[in]   function    Benchmark body.
+ */
+void Register(const std::string &name, std::function<void(State &)> function)
+{
+    g_Benchmarks.emplace_back(name, std::move(function));
+}
+
+
+/**
+ * @brief Get the generated workload, created on first use.
+ *
+ * @return  Generator and two rating periods of games.
+ */
+const std::pair<std::unique_ptr<glicko::workload::Generator>, std::vector<std::vector<glicko::workload::Game>>> & GetWorkload()
+{
+    static std::pair<std::unique_ptr<glicko::workload::Generator>, std::vector<std::vector<glicko::workload::Game>>> workload;
+    if(!workload.first)
+    {
+        workload.first = std::make_unique<glicko::workload::Generator>(g_Options.workload);
+        workload.second.push_back(workload.first->GeneratePeriod());
+        workload.second.push_back(workload.first->GeneratePeriod());
+    }
+    return workload;
+}
+
+
+/**
+ * @brief Convert player index to ID.
+ *
+ * int IDs are sparse, unsigned IDs are dense (0 to n-1).
+ * @param[in]   index   Player index.
+ * @return              ID.
+ */
+template <typename IDTYPE> IDTYPE MakeID(std::uint32_t index);
+
+template <> int MakeID<int>(std::uint32_t index)
+{
+    return static_cast<int>(index*7919u % 2147483647u);
+}
+
+template <> unsigned MakeID<unsigned>(std::uint32_t index)
+{
+    // dense IDs
+    return index;
+}
+
+template <> std::string MakeID<std::string>(std::uint32_t index)
+{
+    return "player-" + std::to_string(index) + "@example.org";
+}
+
+
+/**
+ * @brief Convert the IDs of all players.
+ *
+ * @return  IDs.
+ */
+template <typename IDTYPE> std::vector<IDTYPE> MakePlayerIDs()
+{
+    std::vector<IDTYPE> ids;
+    ids.reserve(g_Options.workload.playerCount);
+    for(std::size_t i = 0; i < g_Options.workload.playerCount; ++i)
+    {
+        ids.push_back(MakeID<IDTYPE>(static_cast<std::uint32_t>(i)));
+    }
+    return ids;
+}
+
+
+/**
+ * @brief Convert the games of one period to records.
+ *
+ * @param[in]   period  Rating period of the workload.
+ * @return              Game records.
+ */
+template <typename IDTYPE, typename TRAITS = glicko::DefaultTraits>
+std::vector<typename glicko::Glicko<IDTYPE, TRAITS>::GameRecord> MakeGameRecords(std::size_t period)
+{
+    std::vector<typename glicko::Glicko<IDTYPE, TRAITS>::GameRecord> records;
+    const auto & games = GetWorkload().second[period];
+    records.reserve(games.size());
+    for(const auto & game : games)
+    {
+        records.push_back({MakeID<IDTYPE>(game.player1), MakeID<IDTYPE>(game.player2), game.result});
+    }
+    return records;
+}
+
+
+/**
+ * @brief Create an engine with all players of the workload.
+ *
+ * @return  The engine.
+ */
+template <typename IDTYPE, typename TRAITS = glicko::DefaultTraits> std::unique_ptr<glicko::Glicko<IDTYPE, TRAITS>> MakeEngine()
+{
+    auto engine = std::make_unique<glicko::Glicko<IDTYPE, TRAITS>>(0.06, 0.5);
+    std::vector<IDTYPE> ids = MakePlayerIDs<IDTYPE>();
+    engine->CreatePlayers(std::make_move_iterator(ids.begin()), std::make_move_iterator(ids.end()));
+    return engine;
+}
+
+
+/**
+ * @brief Register the benchmarks of one ID type.
+ *
+ * @param[in]   typeName    Name of the ID type.
+ */
+template <typename IDTYPE> void RegisterForType(const std::string &typeName)
+{
+    using Engine = glicko::Glicko<IDTYPE>;
+    Register("BM_CreatePlayer/" + typeName, [](State &state)
+    {
+        for(auto _ : state)
+        {
+            state.PauseTiming();
+            std::vector<IDTYPE> ids = MakePlayerIDs<IDTYPE>();
+            Engine engine{0.06, 0.5};
+            state.ResumeTiming();
+            for(const auto & id : ids)
+            {
+                engine.CreatePlayer(id);
+            }
+        }
+        state.SetItemsProcessed(static_cast<double>(state.GetIterations()*g_Options.workload.playerCount));
+    });
+    Register("BM_CreatePlayers/" + typeName, [](State &state)
+    {
+        for(auto _ : state)
+        {
+            state.PauseTiming();
+            std::vector<IDTYPE> ids = MakePlayerIDs<IDTYPE>();
+            Engine engine{0.06, 0.5};
+            state.ResumeTiming();
+            engine.CreatePlayers(std::make_move_iterator(ids.begin()), std::make_move_iterator(ids.end()));
+        }
+        state.SetItemsProcessed(static_cast<double>(state.GetIterations()*g_Options.workload.playerCount));
+    });
+    Register("BM_AddGame/" + typeName, [](State &state)
+    {
+        auto engine = MakeEngine<IDTYPE>();
+        auto records = MakeGameRecords<IDTYPE>(0);
+        for(auto _ : state)
+        {
+            for(const auto & record : records)
+            {
+                engine->AddGame(record.player1, record.player2, record.result);
+            }
+            state.PauseTiming();
+            engine = MakeEngine<IDTYPE>();
+            state.ResumeTiming();
+        }
+        state.SetItemsProcessed(static_cast<double>(state.GetIterations()*records.size()));
+    });
+    Register("BM_AddGames/" + typeName, [](State &state)
+    {
+        auto engine = MakeEngine<IDTYPE>();
+        std::size_t count = 0;
+        for(auto _ : state)
+        {
+            state.PauseTiming();
+            auto records = MakeGameRecords<IDTYPE>(0);
+            count = records.size();
+            state.ResumeTiming();
+            engine->AddGames(std::make_move_iterator(records.begin()), std::make_move_iterator(records.end()));
+            state.PauseTiming();
+            engine = MakeEngine<IDTYPE>();
+            state.ResumeTiming();
+        }
+        state.SetItemsProcessed(static_cast<double>(state.GetIterations()*count));
+    });
+    Register("BM_GetRating/" + typeName, [](State &state)
+    {
+        auto engine = MakeEngine<IDTYPE>();
+        std::vector<IDTYPE> ids = MakePlayerIDs<IDTYPE>();
+        std::shuffle(ids.begin(), ids.end(), std::mt19937_64{g_Options.workload.seed});
+        double sum = 0;
+        for(auto _ : state)
+        {
+            for(const auto & id : ids)
+            {
+                sum += engine->GetRating(id);
+            }
+        }
+        state.SetItemsProcessed(static_cast<double>(state.GetIterations()*ids.size()));
+        g_Sink = sum;
+    });
+    Register("BM_SnapshotSave/" + typeName, [](State &state)
+    {
+        auto engine = MakeEngine<IDTYPE>();
+        for(auto _ : state)
+        {
+            engine->SaveSnapshot("glicko_benchmark.snapshot");
+        }
+        std::remove("glicko_benchmark.snapshot");
+        state.SetItemsProcessed(static_cast<double>(state.GetIterations()*g_Options.workload.playerCount));
+    });
+    Register("BM_SnapshotLoad/" + typeName, [](State &state)
+    {
+        MakeEngine<IDTYPE>()->SaveSnapshot("glicko_benchmark.snapshot");
+        for(auto _ : state)
+        {
+            Engine engine{0.06, 0.5};
+            engine.LoadSnapshot("glicko_benchmark.snapshot");
+        }
+        std::remove("glicko_benchmark.snapshot");
+        state.SetItemsProcessed(static_cast<double>(state.GetIterations()*g_Options.workload.playerCount));
+    });
+}
+
+
+/**
+ * @brief Register lookup and rating period benchmarks of an index backend.
+ *
+ * The "map" backend (the ordered map) is the baseline, "slot" is the default.
+ * @tparam      IDTYPE      Type of the player IDs.
+ * @tparam      TRAITS      Configuration with the index backend.
+ * @tparam      FREEZE      Freeze the index after creating the players.
+ * @param[in]   typeName    Name of the ID type.
+ * @param[in]   indexName   Name of the index backend.
+ */
+template <typename IDTYPE, typename TRAITS, bool FREEZE = false>
+void RegisterIndex(const std::string &typeName, const std::string &indexName)
+{
+    auto makeEngine = []
+    {
+        auto engine = MakeEngine<IDTYPE, TRAITS>();
+        if constexpr(FREEZE)
+        {
+            engine->FreezeIndex();
+        }
+        return engine;
+    };
+    Register("BM_GetRating/" + typeName + "/" + indexName, [makeEngine](State &state)
+    {
+        auto engine = makeEngine();
+        std::vector<IDTYPE> ids = MakePlayerIDs<IDTYPE>();
+        std::shuffle(ids.begin(), ids.end(), std::mt19937_64{g_Options.workload.seed});
+        double sum = 0;
+        for(auto _ : state)
+        {
+            for(const auto & id : ids)
+            {
+                sum += engine->GetRating(id);
+            }
+        }
+        state.SetItemsProcessed(static_cast<double>(state.GetIterations()*ids.size()));
+        g_Sink = sum;
+    });
+    Register("BM_ComputeRatings/" + typeName + "/" + indexName, [makeEngine](State &state)
+    {
+        auto engine = makeEngine();
+        auto records = MakeGameRecords<IDTYPE, TRAITS>(0);
+        for(auto _ : state)
+        {
+            state.PauseTiming();
+            engine->AddGames(records.begin(), records.end());
+            state.ResumeTiming();
+            engine->ComputeRatings();
+        }
+        state.SetItemsProcessed(static_cast<double>(state.GetIterations()*records.size()));
+    });
+}
+
+
+/**
+ * @brief Register a rating period benchmark.
+ *
+ * @tparam     TRAITS      Configuration of the engine.
+ * @param[in]   name        Benchmark name.
+ * @param[in]   configure   Configures the engine.
+ */
+template <typename TRAITS = glicko::DefaultTraits, typename CONFIGURE>
+void RegisterComputeRatings(const std::string &name, CONFIGURE configure)
+{
+    Register("BM_ComputeRatings/" + name, [configure](State &state)
+    {
+        auto engine = MakeEngine<int, TRAITS>();
+        configure(*engine);
+        auto records = MakeGameRecords<int, TRAITS>(0);
+        for(auto _ : state)
+        {
+            state.PauseTiming();
+            engine->AddGames(records.begin(), records.end());
+            state.ResumeTiming();
+            engine->ComputeRatings();
+        }
+        state.SetItemsProcessed(static_cast<double>(state.GetIterations()*records.size()));
+    });
+}
+
+
+/**
+ * @brief Register the rating period benchmark reading the games from a game log.
+ *
+ * The in-memory baseline is BM_ComputeRatings/scalar, which gives the same results.
+ */
+void RegisterComputeRatingsFromLog()
+{
+    Register("BM_ComputeRatings/log", [](State &state)
+    {
+        auto engine = MakeEngine<int>();
+        const auto & games = GetWorkload().second[0];
+        glicko::gamelog::Writer<int> writer{"glicko_benchmark.gamelog"};
+        for(const auto & game : games)
+        {
+            writer.Write(MakeID<int>(game.player1), MakeID<int>(game.player2), game.result);
+        }
+        writer.Close();
+        for(auto _ : state)
+        {
+            glicko::gamelog::Reader<int> reader{"glicko_benchmark.gamelog"};
+            engine->ComputeRatings(reader);
+        }
+        std::remove("glicko_benchmark.gamelog");
+        state.SetItemsProcessed(static_cast<double>(state.GetIterations()*games.size()));
+    });
+}
+
+
+/**
+ * @brief Register a partitioned rating period benchmark.
+ *
+ * Includes routing the games and exchanging the ghost opponents between the
+ * shard processes; the single engine baseline is BM_ComputeRatings/scalar.
+ * @param[in]   shards  Number of shard processes.
+ */
+void RegisterPartition(unsigned shards)
+{
+    Register("BM_Partition/shards:" + std::to_string(shards), [shards](State &state)
+    {
+        glicko::partition::Coordinator<int> partition{shards, 0.06, 0.5};
+        for(int id : MakePlayerIDs<int>())
+        {
+            partition.CreatePlayer(id);
+        }
+        auto records = MakeGameRecords<int>(0);
+        for(auto _ : state)
+        {
+            for(const auto & record : records)
+            {
+                partition.AddGame(record.player1, record.player2, record.result);
+            }
+            partition.ComputeRatings();
+        }
+        state.SetItemsProcessed(static_cast<double>(state.GetIterations()*records.size()));
+    });
+}
+
+
+/**
+ * @brief Register the replay benchmarks.
+ *
+ * The history has eight rating periods of one hour, alternating the two
+ * periods of the workload. "sequential" adds the games and computes one
+ * period after the other on one core, "pipelined" uses replay::Replay with
+ * the engine threads.
+ */
+void RegisterReplay()
+{
+    auto makeHistory = []
+    {
+        std::vector<glicko::replay::TimedGame<int>> history;
+        for(std::int64_t period = 0; period < 8; ++period)
+        {
+            const auto & games = GetWorkload().second[period % 2];
+            for(std::size_t i = 0; i < games.size(); ++i)
+            {
+                std::int64_t time = period*3600 + static_cast<std::int64_t>(i*3600/games.size());
+                history.push_back({time, MakeID<int>(games[i].player1), MakeID<int>(games[i].player2), games[i].result});
+            }
+        }
+        return history;
+    };
+    Register("BM_Replay/sequential", [makeHistory](State &state)
+    {
+        auto history = makeHistory();
+        for(auto _ : state)
+        {
+            state.PauseTiming();
+            auto engine = MakeEngine<int>();
+            state.ResumeTiming();
+            std::int64_t periodEnd = 3600;
+            for(const auto & game : history)
+            {
+                while(game.time >= periodEnd)
+                {
+                    engine->ComputeRatings();
+                    periodEnd += 3600;
+                }
+                engine->AddGame(game.player1, game.player2, game.result);
+            }
+            engine->ComputeRatings();
+        }
+        state.SetItemsProcessed(static_cast<double>(state.GetIterations()*history.size()));
+    });
+    Register("BM_Replay/pipelined", [makeHistory](State &state)
+    {
+        auto history = makeHistory();
+        for(auto _ : state)
+        {
+            state.PauseTiming();
+            auto engine = MakeEngine<int>();
+            engine->SetThreadCount(g_Options.threads);
+            state.ResumeTiming();
+            glicko::replay::Replay<int> replay{*engine, 0, 3600};
+            replay.Run(history.begin(), history.end());
+        }
+        state.SetItemsProcessed(static_cast<double>(state.GetIterations()*history.size()));
+    });
+}
+
+
+/**
+ * @brief Register the team game benchmarks.
+ *
+ * 5 vs 5 matches from the players of the workload games, added and computed
+ * either as team games with composite opponents or expanded into 25 games.
+ */
+void RegisterTeamGames()
+{
+    struct Match
+    {
+        std::vector<int>    team1;  ///< IDs of team 1.
+        std::vector<int>    team2;  ///< IDs of team 2.
+        glicko::GameResult  result; ///< Match result.
+    };
+    auto makeMatches = []
+    {
+        std::vector<Match> matches;
+        const auto & games = GetWorkload().second[0];
+        for(std::size_t i = 0; i + 5 <= games.size(); i += 5)
+        {
+            Match match{{}, {}, games[i].result};
+            for(std::size_t k = i; k < i + 5; ++k)
+            {
+                match.team1.push_back(MakeID<int>(games[k].player1));
+                match.team2.push_back(MakeID<int>(games[k].player2));
+            }
+            matches.push_back(std::move(match));
+        }
+        return matches;
+    };
+    Register("BM_TeamGames/composite", [makeMatches](State &state)
+    {
+        auto engine = MakeEngine<int>();
+        auto matches = makeMatches();
+        for(auto _ : state)
+        {
+            for(const auto & match : matches)
+            {
+                engine->AddTeamGame(match.team1, match.team2, match.result);
+            }
+            engine->ComputeRatings();
+        }
+        state.SetItemsProcessed(static_cast<double>(state.GetIterations()*matches.size()));
+    });
+    Register("BM_TeamGames/pairwise", [makeMatches](State &state)
+    {
+        auto engine = MakeEngine<int>();
+        auto matches = makeMatches();
+        for(auto _ : state)
+        {
+            for(const auto & match : matches)
+            {
+                for(int player1 : match.team1)
+                {
+                    for(int player2 : match.team2)
+                    {
+                        engine->AddGame(player1, player2, match.result);
+                    }
+                }
+            }
+            engine->ComputeRatings();
+        }
+        state.SetItemsProcessed(static_cast<double>(state.GetIterations()*matches.size()));
+    });
+}
+
+
+/**
+ * @brief Register the player churn benchmarks.
+ *
+ * Each iteration removes 1% of the players, creates as many new ones and
+ * computes a rating period. "compact" reclaims the removed slots in steps
+ * of 4096 between the operations, "tombstones" lets the table grow.
+ * @param[in]   name        Benchmark name.
+ * @param[in]   compact     Compact the player table.
+ */
+void RegisterChurn(const std::string &name, bool compact)
+{
+    Register("BM_Churn/" + name, [compact](State &state)
+    {
+        auto engine = MakeEngine<int>();
+        auto records = MakeGameRecords<int>(0);
+        std::vector<int> ids = MakePlayerIDs<int>();
+        std::mt19937_64 random{g_Options.workload.seed};
+        std::size_t churn = std::max<std::size_t>(ids.size()/100, 1);
+        int nextID = -1;
+        for(auto _ : state)
+        {
+            for(std::size_t i = 0; i < churn; ++i)
+            {
+                std::size_t k = random() % ids.size();
+                engine->RemovePlayer(ids[k]);
+                ids[k] = nextID--;
+                engine->CreatePlayer(ids[k]);
+                if(compact && i % 256 == 0)
+                {
+                    engine->Compact(4096);
+                }
+            }
+            engine->AddGames(records.begin(), records.end());
+            engine->ComputeRatings();
+        }
+        state.SetItemsProcessed(static_cast<double>(state.GetIterations()*(2*churn + records.size())));
+    });
+}
+
+
+/**
+ * @brief Register the change feed benchmarks.
+ *
+ * A rating period in streaming mode followed by updating a cache of all
+ * ratings, either by reading all players ("poll") or from the change feed
+ * ("feed").
+ */
+void RegisterChangeFeed()
+{
+    Register("BM_ChangeFeed/poll", [](State &state)
+    {
+        auto engine = MakeEngine<int>();
+        engine->SetStreaming(true);
+        auto records = MakeGameRecords<int>(0);
+        std::vector<int> ids = MakePlayerIDs<int>();
+        std::vector<double> cache(ids.size());
+        std::size_t changed = 0;
+        for(auto _ : state)
+        {
+            engine->AddGames(records.begin(), records.end());
+            engine->ComputeRatings();
+            for(std::size_t i = 0; i < ids.size(); ++i)
+            {
+                double rating = engine->GetRating(ids[i]) + engine->GetDeviation(ids[i]) + engine->GetVolatility(ids[i]);
+                changed += (rating != cache[i]);
+                cache[i] = rating;
+            }
+        }
+        state.SetItemsProcessed(static_cast<double>(state.GetIterations()*records.size()));
+        g_Sink = static_cast<double>(changed);
+    });
+    Register("BM_ChangeFeed/feed", [](State &state)
+    {
+        auto engine = MakeEngine<int>();
+        engine->SetStreaming(true);
+        engine->SetChangeFeed(true);
+        auto records = MakeGameRecords<int>(0);
+        std::vector<double> cache(g_Options.workload.playerCount);
+        std::size_t changed = 0;
+        for(auto _ : state)
+        {
+            engine->AddGames(records.begin(), records.end());
+            engine->ComputeRatings();
+            for(const auto & change : engine->GetChanges())
+            {
+                // the IDs are not dense, collisions in the cache do not matter here
+                cache[static_cast<std::size_t>(change.id) % cache.size()] = change.after.rating + change.after.deviation + change.after.volatility;
+                ++changed;
+            }
+        }
+        state.SetItemsProcessed(static_cast<double>(state.GetIterations()*records.size()));
+        g_Sink = static_cast<double>(changed);
+    });
+}
+
+
+/**
+ * @brief Register the leaderboard query benchmarks.
+ */
+void RegisterLeaderboard()
+{
+    auto makeRankedEngine = []
+    {
+        auto engine = MakeEngine<int>();
+        engine->SetLeaderboard(true);
+        auto records = MakeGameRecords<int>(0);
+        engine->AddGames(records.begin(), records.end());
+        engine->ComputeRatings();
+        return engine;
+    };
+    Register("BM_GetRank", [makeRankedEngine](State &state)
+    {
+        auto engine = makeRankedEngine();
+        std::vector<int> ids = MakePlayerIDs<int>();
+        std::shuffle(ids.begin(), ids.end(), std::mt19937_64{g_Options.workload.seed});
+        std::size_t sum = 0;
+        for(auto _ : state)
+        {
+            for(int id : ids)
+            {
+                sum += engine->GetRank(id);
+            }
+        }
+        state.SetItemsProcessed(static_cast<double>(state.GetIterations()*ids.size()));
+        g_Sink = static_cast<double>(sum);
+    });
+    Register("BM_GetPlayersInRange", [makeRankedEngine](State &state)
+    {
+        auto engine = makeRankedEngine();
+        std::vector<int> ids = MakePlayerIDs<int>();
+        std::shuffle(ids.begin(), ids.end(), std::mt19937_64{g_Options.workload.seed});
+        ids.resize(std::min<std::size_t>(ids.size(), 1000));
+        std::size_t sum = 0;
+        for(auto _ : state)
+        {
+            for(int id : ids)
+            {
+                // matchmaking window around the player's rating
+                double rating = engine->GetRating(id);
+                sum += engine->GetPlayersInRange(rating - 10, rating + 10).size();
+            }
+        }
+        state.SetItemsProcessed(static_cast<double>(state.GetIterations()*ids.size()));
+        g_Sink = static_cast<double>(sum);
+    });
+}
+
+
+/**
+ * @brief Register a prediction benchmark.
+ *
+ * Predicts a matrix of 100 players against 10000 candidates.
+ * @param[in]   name    Benchmark name.
+ * @param[in]   kernel  Kernel to use.
+ */
+void RegisterPredict(const std::string &name, glicko::Kernel kernel)
+{
+    Register("BM_Predict/" + name, [kernel](State &state)
+    {
+        auto engine = MakeEngine<int>();
+        engine->SetKernel(kernel);
+        std::vector<int> ids = MakePlayerIDs<int>();
+        std::shuffle(ids.begin(), ids.end(), std::mt19937_64{g_Options.workload.seed});
+        std::size_t rows = std::min<std::size_t>(ids.size(), 100);
+        std::size_t columns = std::min<std::size_t>(ids.size(), 10000);
+        glicko::Glicko<int>::PlayerBatch players;
+        glicko::Glicko<int>::PlayerBatch candidates;
+        engine->GetPlayerBatch(ids.begin(), ids.begin() + rows, players);
+        engine->GetPlayerBatch(ids.begin(), ids.begin() + columns, candidates);
+        std::vector<double> expected;
+        std::vector<double> quality;
+        double sum = 0;
+        for(auto _ : state)
+        {
+            engine->Predict(players, candidates, expected, quality);
+            sum += expected.back();
+        }
+        state.SetItemsProcessed(static_cast<double>(state.GetIterations()*rows*columns));
+        g_Sink = sum;
+    });
+}
+
+
+/**
+ * @brief Register the what-if preview benchmarks.
+ *
+ * Previews a win, a draw and a loss for pairs of players, on the engine and on a
+ * published rating table.
+ */
+void RegisterPreview()
+{
+    auto run = [](State &state, bool table)
+    {
+        using Engine = glicko::Glicko<int>;
+        auto engine = MakeEngine<int>();
+        engine->PublishRatings();
+        auto published = engine->GetRatingTable();
+        std::vector<int> ids = MakePlayerIDs<int>();
+        std::shuffle(ids.begin(), ids.end(), std::mt19937_64{g_Options.workload.seed});
+        std::vector<Engine::GameRecord> games(1);
+        std::size_t pair = 0;
+        double sum = 0;
+        for(auto _ : state)
+        {
+            games[0].player1 = ids[pair % ids.size()];
+            games[0].player2 = ids[(pair + 1) % ids.size()];
+            pair += 2;
+            for(glicko::GameResult result : {glicko::GameResult::Player1, glicko::GameResult::Draw, glicko::GameResult::Player2})
+            {
+                games[0].result = result;
+                auto changes = table ? published->Preview(games) : engine->Preview(games);
+                sum += changes[0].after.rating;
+            }
+        }
+        state.SetItemsProcessed(static_cast<double>(state.GetIterations()*3));
+        g_Sink = sum;
+    };
+    Register("BM_Preview/engine", [run](State &state)
+    {
+        run(state, false);
+    });
+    Register("BM_Preview/table", [run](State &state)
+    {
+        run(state, true);
+    });
+}
+
+
+/**
+ * @brief Register a concurrent ingestion benchmark.
+ *
+ * @param[in]   threads     Number of producer threads.
+ */
+void RegisterAddGameConcurrent(unsigned threads)
+{
+    Register("BM_AddGameConcurrent/threads:" + std::to_string(threads), [threads](State &state)
+    {
+        auto engine = MakeEngine<int>();
+        engine->SetIngestionShards(0);
+        auto records = MakeGameRecords<int>(0);
+        for(auto _ : state)
+        {
+            std::vector<std::thread> producers;
+            for(unsigned t = 0; t < threads; ++t)
+            {
+                producers.emplace_back([&, t]
+                {
+                    for(std::size_t i = t; i < records.size(); i += threads)
+                    {
+                        engine->AddGameConcurrent(records[i].player1, records[i].player2, records[i].result);
+                    }
+                });
+            }
+            for(auto & producer : producers)
+            {
+                producer.join();
+            }
+            state.PauseTiming();
+            engine = MakeEngine<int>();
+            engine->SetIngestionShards(0);
+            state.ResumeTiming();
+        }
+        state.SetItemsProcessed(static_cast<double>(state.GetIterations()*records.size()));
+    });
+}
+
+
+/**
+ * @brief Run one benchmark.
+ *
+ * Increases the number of iterations until the measured time reaches the minimum time.
+ * @param[in]   name        Benchmark name.
+ * @param[in]   function    Benchmark body.
+ * @return                  Result.
+ */
+Result Run(const std::string &name, const std::function<void(State &)> &function)
+{
+    std::size_t iterations = 1;
+    for(;;)
+    {
+        State state{iterations};
+        function(state);
+        double elapsed = state.GetElapsed();
+        if(elapsed >= g_Options.minTime || iterations >= 1000000000)
+        {
+            Result result;
+            result.name = name;
+            result.iterations = iterations;
+            result.timePerIteration = elapsed/iterations*1e9;
+            result.itemsPerSecond = (state.GetItems() > 0 && elapsed > 0) ? state.GetItems()/elapsed : 0;
+            return result;
+        }
+        double factor = (elapsed > 0) ? g_Options.minTime/elapsed*1.4 : 10;
+        iterations = static_cast<std::size_t>(iterations*std::min(10.0, std::max(1.5, factor))) + 1;
+    }
+}
+
+
+/**
+ * @brief Write results as JSON.
+ *
+ * @param[in]   results     Results.
+ */
+void WriteJson(const std::vector<Result> &results)
+{
+    std::ofstream out{g_Options.outFile};
+    if(!out)
+    {
+        std::cerr << "Cannot write " << g_Options.outFile << std::endl;
+        return;
+    }
+    char date[64];
+    std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+    out << "{\n  \"context\": {\n"
+        << "    \"date\": \"" << date << "\",\n"
+        << "    \"library_version\": \"" << glicko::Glicko<int>::GetVersion() << "\",\n"
+        << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n"
+        << "    \"players\": " << g_Options.workload.playerCount << ",\n"
+        << "    \"games_per_period\": " << g_Options.workload.gamesPerPeriod << ",\n"
+        << "    \"activity_exponent\": " << g_Options.workload.activityExponent << ",\n"
+        << "    \"seed\": " << g_Options.workload.seed << "\n"
+        << "  },\n  \"benchmarks\": [\n";
+    for(std::size_t i = 0; i < results.size(); ++i)
+    {
+        const Result & result = results[i];
+        out << "    {\n"
+            << "      \"name\": \"" << result.name << "\",\n"
+            << "      \"iterations\": " << result.iterations << ",\n"
+            << "      \"real_time\": " << result.timePerIteration << ",\n"
+            << "      \"time_unit\": \"ns\",\n"
+            << "      \"items_per_second\": " << result.itemsPerSecond << "\n"
+            << "    }" << ((i + 1 < results.size()) ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+
+/**
+ * @brief Print usage.
+ */
+void PrintUsage()
+{
+    std::cout << "usage: glicko_benchmark [options]\n"
+              << "  --benchmark_filter=<text>       run benchmarks whose name contains text\n"
+              << "  --benchmark_min_time=<seconds>  minimum time per benchmark (default 0.5)\n"
+              << "  --benchmark_out=<file>          write results as JSON\n"
+              << "  --players=<n>                   number of players (default 100000)\n"
+              << "  --games=<n>                     games per rating period (default 300000)\n"
+              << "  --seed=<n>                      workload seed (default 1)\n"
+              << "  --skill=normal|uniform          skill distribution (default normal)\n"
+              << "  --activity=<exponent>           Pareto exponent of player activity, 0 = uniform (default 1.5)\n"
+              << "  --threads=<n>                   threads of multi-threaded benchmarks (default: all cores)\n";
+}
+
+
+/**
+ * @brief Parse command line.
+ *
+ * @param[in]   argc    Number of arguments.
+ * @param[in]   argv    Arguments.
+ * @return              false on error.
+ */
+bool ParseOptions(int argc, char *argv[])
+{
+    for(int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        std::size_t pos = arg.find('=');
+        std::string key = arg.substr(0, pos);
+        std::string value = (pos != std::string::npos) ? arg.substr(pos + 1) : "";
+        try
+        {
+            if(key == "--benchmark_filter")
+            {
+                g_Options.filter = value;
+            }
+            else if(key == "--benchmark_min_time")
+            {
+                g_Options.minTime = std::stod(value);
+            }
+            else if(key == "--benchmark_out")
+            {
+                g_Options.outFile = value;
+            }
+            else if(key == "--players")
+            {
+                g_Options.workload.playerCount = std::stoul(value);
+            }
+            else if(key == "--games")
+            {
+                g_Options.workload.gamesPerPeriod = std::stoul(value);
+            }
+            else if(key == "--seed")
+            {
+                g_Options.workload.seed = std::stoull(value);
+            }
+            else if(key == "--skill")
+            {
+                g_Options.workload.skillDistribution = (value == "uniform") ? glicko::workload::SkillDistribution::Uniform
+                                                                            : glicko::workload::SkillDistribution::Normal;
+            }
+            else if(key == "--activity")
+            {
+                g_Options.workload.activityExponent = std::stod(value);
+            }
+            else if(key == "--threads")
+            {
+                g_Options.threads = static_cast<unsigned>(std::stoul(value));
+            }
+            else
+            {
+                return false;
+            }
+        }
+        catch(const std::exception &)
+        {
+            return false;
+        }
+    }
+    return g_Options.workload.playerCount > 0;
+}
+
+} // namespace
+
+
+int main(int argc, char *argv[])
+{
+    if(!ParseOptions(argc, argv))
+    {
+        PrintUsage();
+        return 1;
+    }
+    RegisterForType<int>("int");
+    RegisterForType<std::string>("string");
+    RegisterIndex<int, OrderedIndexTraits>("int", "map");
+    RegisterIndex<int, glicko::DefaultTraits>("int", "slot");
+    RegisterIndex<int, HashIndexTraits>("int", "hash");
+    RegisterIndex<unsigned, glicko::DefaultTraits>("dense", "slot");
+    RegisterIndex<unsigned, DenseIndexTraits>("dense", "dense");
+    RegisterIndex<int, PerfectHashIndexTraits, true>("int", "perfect");
+    RegisterIndex<std::string, OrderedIndexTraits>("string", "map");
+    RegisterIndex<std::string, glicko::DefaultTraits>("string", "slot");
+    RegisterIndex<std::string, HashIndexTraits>("string", "hash");
+    RegisterIndex<std::string, PerfectHashIndexTraits, true>("string", "perfect");
+    unsigned maxThreads = (g_Options.threads > 0) ? g_Options.threads : std::max(1u, std::thread::hardware_concurrency());
+    for(unsigned threads = 1; threads < 2*maxThreads; threads *= 2)
+    {
+        RegisterAddGameConcurrent(std::min(threads, maxThreads));
+        if(threads >= maxThreads)
+        {
+            break;
+        }
+    }
+    RegisterComputeRatings("scalar", [](glicko::Glicko<int> &)
+    {
+    });
+    RegisterComputeRatings("vector", [](glicko::Glicko<int> &engine)
+    {
+        engine.SetKernel(glicko::Kernel::Auto);
+    });
+    RegisterComputeRatings("newton", [](glicko::Glicko<int> &engine)
+    {
+        glicko::SolverSettings settings;
+        settings.method = glicko::SolverMethod::Newton;
+        engine.SetSolverSettings(settings);
+    });
+    RegisterComputeRatings("threads", [](glicko::Glicko<int> &engine)
+    {
+        engine.SetThreadCount(g_Options.threads);
+        engine.SetKernel(glicko::Kernel::Auto);
+    });
+    RegisterComputeRatings("streaming", [](glicko::Glicko<int> &engine)
+    {
+        engine.SetStreaming(true);
+        engine.SetKernel(glicko::Kernel::Auto);
+    });
+    RegisterComputeRatings<glicko::FloatTraits>("float", [](glicko::Glicko<int, glicko::FloatTraits> &)
+    {
+    });
+    RegisterComputeRatings<StatisticsTraits>("statistics", [](glicko::Glicko<int, StatisticsTraits> &)
+    {
+    });
+    RegisterComputeRatings("leaderboard", [](glicko::Glicko<int> &engine)
+    {
+        engine.SetLeaderboard(true);
+    });
+    RegisterComputeRatingsFromLog();
+    for(unsigned shards : {1u, 2u, 4u})
+    {
+        RegisterPartition(shards);
+    }
+    RegisterReplay();
+    RegisterTeamGames();
+    RegisterChurn("compact", true);
+    RegisterChurn("tombstones", false);
+    RegisterChangeFeed();
+    RegisterLeaderboard();
+    RegisterPredict("scalar", glicko::Kernel::Scalar);
+    RegisterPredict("vector", glicko::Kernel::Auto);
+    RegisterPreview();
+
+    std::vector<Result> results;
+    std::printf("%-40s %12s %16s %18s\n", "Benchmark", "Iterations", "Time/iter (ns)", "Items/s");
+    for(const auto & benchmark : g_Benchmarks)
+    {
+        if(benchmark.first.find(g_Options.filter) == std::string::npos)
+        {
+            continue;
+        }
+        Result result = Run(benchmark.first, benchmark.second);
+        std::printf("%-40s %12zu %16.0f %18.0f\n", result.name.c_str(), result.iterations, result.timePerIteration, result.itemsPerSecond);
+        std::fflush(stdout);
+        results.push_back(result);
+    }
+    if(!g_Options.outFile.empty())
+    {
+        WriteJson(results);
+    }
+    return 0;
+}
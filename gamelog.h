@@ -0,0 +1,443 @@
+/******************************************************************************//**
+ * @file
+ * @brief Binary game log read in chunks or parsed in memory
+ *
+ * @copyright Copyright (C) by Doru Julian Bugariu
+ * julian@bugariu.eu
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the
+ * Free Software Foundation
+ * 51 Franklin Street, Fifth Floor
+ * Boston, MA 02110-1301, USA
+ * http://www.fsf.org/about/contact.html
+ *********************************************************************************/
+
+
+#ifndef GLICKO_GAMELOG_H
+#define GLICKO_GAMELOG_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+#include "exception.h"
+#include "snapshot.h"
+
+namespace glicko
+{
+
+enum class GameResult;     // defined in glicko.h
+
+namespace gamelog
+{
+
+constexpr char          MAGIC[8] = {'G', 'L', 'I', 'C', 'K', 'O', 'G', 'L'};   ///< File magic.
+constexpr std::uint32_t VERSION = 1;                                            ///< Current format version.
+constexpr std::uint32_t BUFFER_SIZE = 1 << 20;                                  ///< Read buffer size in bytes.
+
+/**
+ * @brief File header.
+ *
+ * Followed by the games, each as player 1 ID, player 2 ID and the result as one
+ * byte. Trivially copyable IDs are stored raw, strings as uint32 length and
+ * characters. The number of games is not stored, so logs can be appended to.
+ */
+struct Header
+{
+    char            magic[8];           ///< File magic.
+    std::uint32_t   version;            ///< Format version.
+    std::uint32_t   byteOrder;          ///< snapshot::BYTE_ORDER_MARK.
+    std::uint32_t   idKind;             ///< snapshot::IdCodec::KIND of the IDs.
+    std::uint32_t   idSize;             ///< snapshot::IdCodec::SIZE of the IDs.
+};
+
+/**
+ * @brief One game of the log.
+ *
+ * @tparam  IDTYPE  Type of player ID.
+ */
+template <typename IDTYPE>
+struct Record
+{
+    IDTYPE      player1;    ///< ID of player 1.
+    IDTYPE      player2;    ///< ID of player 2.
+    GameResult  result;     ///< Result of the game.
+};
+
+/**
+ * @brief Check the header of a game log.
+ *
+ * @throws glicko::GlickoException when the header is no game log header of IDTYPE.
+ * @tparam      IDTYPE      Type of player ID.
+ * @param[in]   header      The header.
+ * @param[in]   fileName    Name of the file, used in messages.
+ */
+template <typename IDTYPE>
+void CheckHeader(const Header &header, const std::string &fileName)
+{
+    if(std::memcmp(header.magic, MAGIC, sizeof(header.magic)) != 0)
+    {
+        GLTHROW("File " + fileName + " is no game log.");
+    }
+    if(header.version != VERSION || header.byteOrder != snapshot::BYTE_ORDER_MARK)
+    {
+        GLTHROW("Unsupported game log version or byte order in " + fileName + ".");
+    }
+    if(header.idKind != snapshot::IdCodec<IDTYPE>::KIND || header.idSize != snapshot::IdCodec<IDTYPE>::SIZE)
+    {
+        GLTHROW("Game log " + fileName + " has another ID type.");
+    }
+}
+
+/**
+ * @brief Writer of a game log.
+ *
+ * @tparam  IDTYPE  Type of player ID, trivially copyable or std::string.
+ */
+template <typename IDTYPE>
+class Writer
+{
+public:
+    /**
+     * @brief Constructor.
+     *
+     * Creates the file and writes the header.
+     * @throws glicko::GlickoException when the file cannot be created.
+     * @param[in]   fileName    Name of the file.
+     */
+    explicit Writer(const std::string &fileName):
+        m_FileName{fileName},
+        m_Out{fileName, std::ios::binary | std::ios::trunc}
+    {
+        if(!m_Out)
+        {
+            GLTHROW("Cannot create file " + fileName + ".");
+        }
+        Header header{};
+        std::memcpy(header.magic, MAGIC, sizeof(header.magic));
+        header.version = VERSION;
+        header.byteOrder = snapshot::BYTE_ORDER_MARK;
+        header.idKind = snapshot::IdCodec<IDTYPE>::KIND;
+        header.idSize = snapshot::IdCodec<IDTYPE>::SIZE;
+        m_Out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    }
+    /**
+     * @brief Append a game.
+     *
+     * @param[in]   player1     ID of player 1.
+     * @param[in]   player2     ID of player 2.
+     * @param[in]   result      Result of the game.
+     */
+    void Write(const IDTYPE &player1, const IDTYPE &player2, GameResult result)
+    {
+        WriteID(player1);
+        WriteID(player2);
+        char code = static_cast<char>(result);
+        m_Out.put(code);
+    }
+    /**
+     * @brief Flush and close the file.
+     *
+     * @throws glicko::GlickoException when the file cannot be written.
+     */
+    void Close()
+    {
+        m_Out.close();
+        if(!m_Out)
+        {
+            GLTHROW("Cannot write file " + m_FileName + ".");
+        }
+    }
+private:
+    /**
+     * @brief Write a player ID.
+     *
+     * @param[in]   id  The ID.
+     */
+    void WriteID(const IDTYPE &id)
+    {
+        if constexpr(std::is_trivially_copyable<IDTYPE>::value)
+        {
+            m_Out.write(reinterpret_cast<const char *>(&id), sizeof(IDTYPE));
+        }
+        else
+        {
+            std::uint32_t length = static_cast<std::uint32_t>(id.size());
+            m_Out.write(reinterpret_cast<const char *>(&length), sizeof(length));
+            m_Out.write(id.data(), length);
+        }
+    }
+    std::string     m_FileName;     ///< Name of the file.
+    std::ofstream   m_Out;          ///< Output stream.
+};
+
+/**
+ * @brief Reader of a game log.
+ *
+ * Reads the games in chunks through a fixed buffer, so logs larger than the
+ * memory can be processed.
+ * @tparam  IDTYPE  Type of player ID, trivially copyable or std::string.
+ */
+template <typename IDTYPE>
+class Reader
+{
+public:
+    /**
+     * @brief Constructor.
+     *
+     * Opens the file and checks the header.
+     * @throws glicko::GlickoException when the file cannot be opened or is no game log of IDTYPE.
+     * @param[in]   fileName    Name of the file.
+     */
+    explicit Reader(const std::string &fileName):
+        m_FileName{fileName},
+        m_In{fileName, std::ios::binary},
+        m_Buffer(BUFFER_SIZE)
+    {
+        if(!m_In)
+        {
+            GLTHROW("Cannot open file " + fileName + ".");
+        }
+        // size bounds the lengths of string IDs, unknown for streams that cannot seek
+        m_In.seekg(0, std::ios::end);
+        std::streamoff size = m_In.tellg();
+        m_In.seekg(0, std::ios::beg);
+        if(size >= 0 && m_In)
+        {
+            m_Remaining = static_cast<std::uint64_t>(size);
+        }
+        m_In.clear();
+        Header header{};
+        if(!ReadBytes(&header, sizeof(header)))
+        {
+            GLTHROW("File " + fileName + " is no game log.");
+        }
+        CheckHeader<IDTYPE>(header, fileName);
+    }
+    /**
+     * @brief Read the next chunk of games.
+     *
+     * @throws glicko::GlickoException when the file is truncated or corrupt.
+     * @param[out]  games       Games read, replaces the previous contents.
+     * @param[in]   maxCount    Maximum number of games to read.
+     * @return                  false if the end of the log has been reached.
+     */
+    bool Read(std::vector<Record<IDTYPE>> &games, std::size_t maxCount)
+    {
+        games.clear();
+        Record<IDTYPE> game;
+        while(games.size() < maxCount && ReadID(game.player1))
+        {
+            unsigned char code;
+            if(!ReadID(game.player2) || !ReadBytes(&code, 1))
+            {
+                GLTHROW("Game log " + m_FileName + " is truncated.");
+            }
+            if(code > 2)
+            {
+                GLTHROW("Game log " + m_FileName + " contains an invalid result.");
+            }
+            game.result = static_cast<GameResult>(code);
+            games.push_back(std::move(game));
+        }
+        return !games.empty();
+    }
+private:
+    /**
+     * @brief Read a player ID.
+     *
+     * @param[out]  id  The ID.
+     * @return          false at the end of the file.
+     */
+    bool ReadID(IDTYPE &id)
+    {
+        if constexpr(std::is_trivially_copyable<IDTYPE>::value)
+        {
+            return ReadBytes(&id, sizeof(IDTYPE));
+        }
+        else
+        {
+            std::uint32_t length;
+            if(!ReadBytes(&length, sizeof(length)))
+            {
+                return false;
+            }
+            if(length > m_Remaining)
+            {
+                GLTHROW("Game log " + m_FileName + " is truncated.");
+            }
+            id.resize(length);
+            if(!ReadBytes(&id[0], length))
+            {
+                GLTHROW("Game log " + m_FileName + " is truncated.");
+            }
+            return true;
+        }
+    }
+    /**
+     * @brief Read bytes through the buffer.
+     *
+     * @param[out]  data    Destination.
+     * @param[in]   size    Number of bytes.
+     * @return              false if the file ends before the first byte.
+     * @throws glicko::GlickoException when the file ends after the first byte.
+     */
+    bool ReadBytes(void *data, std::size_t size)
+    {
+        char * destination = static_cast<char *>(data);
+        std::size_t done = 0;
+        while(done < size)
+        {
+            if(m_Position == m_Filled)
+            {
+                m_In.read(m_Buffer.data(), m_Buffer.size());
+                m_Filled = static_cast<std::size_t>(m_In.gcount());
+                m_Position = 0;
+                if(m_Filled == 0)
+                {
+                    if(done > 0)
+                    {
+                        GLTHROW("Game log " + m_FileName + " is truncated.");
+                    }
+                    return false;
+                }
+            }
+            std::size_t count = std::min(size - done, m_Filled - m_Position);
+            std::memcpy(destination + done, m_Buffer.data() + m_Position, count);
+            m_Position += count;
+            done += count;
+        }
+        m_Remaining -= std::min<std::uint64_t>(m_Remaining, size);
+        return true;
+    }
+    std::string         m_FileName;     ///< Name of the file.
+    std::ifstream       m_In;           ///< Input stream.
+    std::vector<char>   m_Buffer;       ///< Read buffer.
+    std::size_t         m_Position{0};  ///< Read position in the buffer.
+    std::size_t         m_Filled{0};    ///< Number of valid bytes in the buffer.
+    std::uint64_t       m_Remaining{std::numeric_limits<std::uint64_t>::max()};  ///< Bytes not yet read from the file.
+};
+
+/**
+ * @brief Parser of a game log in memory, e.g. a mapped file.
+ *
+ * Nothing is copied: string IDs are returned as views into the memory, which
+ * must outlive them.
+ * @tparam  IDTYPE  Type of player ID, trivially copyable or std::string.
+ */
+template <typename IDTYPE>
+class View
+{
+public:
+    using id_type = std::conditional_t<std::is_trivially_copyable<IDTYPE>::value, IDTYPE, std::string_view>;   ///< Type of the returned IDs.
+    /**
+     * @brief Constructor.
+     *
+     * Checks the header.
+     * @throws glicko::GlickoException when the data is no game log of IDTYPE.
+     * @param[in]   data        Contents of the file.
+     * @param[in]   fileName    Name of the file, used in messages.
+     */
+    View(std::string_view data, const std::string &fileName):
+        m_FileName{fileName},
+        m_Data{data}
+    {
+        Header header{};
+        if(m_Data.size() < sizeof(header))
+        {
+            GLTHROW("File " + fileName + " is no game log.");
+        }
+        std::memcpy(&header, m_Data.data(), sizeof(header));
+        CheckHeader<IDTYPE>(header, fileName);
+        m_Position = sizeof(header);
+    }
+    /**
+     * @brief Parse the next game.
+     *
+     * @throws glicko::GlickoException when the log is truncated or corrupt.
+     * @param[out]  player1     ID of player 1.
+     * @param[out]  player2     ID of player 2.
+     * @param[out]  result      Result of the game.
+     * @return                  false at the end of the log.
+     */
+    bool Next(id_type &player1, id_type &player2, GameResult &result)
+    {
+        if(m_Position == m_Data.size())
+        {
+            return false;
+        }
+        if(!ParseID(player1) || !ParseID(player2) || m_Position == m_Data.size())
+        {
+            GLTHROW("Game log " + m_FileName + " is truncated.");
+        }
+        unsigned char code = static_cast<unsigned char>(m_Data[m_Position++]);
+        if(code > 2)
+        {
+            GLTHROW("Game log " + m_FileName + " contains an invalid result.");
+        }
+        result = static_cast<GameResult>(code);
+        return true;
+    }
+private:
+    /**
+     * @brief Parse a player ID.
+     *
+     * @param[out]  id  The ID.
+     * @return          false if the data ends within the ID.
+     */
+    bool ParseID(id_type &id)
+    {
+        if constexpr(std::is_trivially_copyable<IDTYPE>::value)
+        {
+            if(m_Data.size() - m_Position < sizeof(IDTYPE))
+            {
+                return false;
+            }
+            std::memcpy(&id, m_Data.data() + m_Position, sizeof(IDTYPE));
+            m_Position += sizeof(IDTYPE);
+        }
+        else
+        {
+            std::uint32_t length;
+            if(m_Data.size() - m_Position < sizeof(length))
+            {
+                return false;
+            }
+            std::memcpy(&length, m_Data.data() + m_Position, sizeof(length));
+            m_Position += sizeof(length);
+            if(m_Data.size() - m_Position < length)
+            {
+                return false;
+            }
+            id = m_Data.substr(m_Position, length);
+            m_Position += length;
+        }
+        return true;
+    }
+    std::string         m_FileName;     ///< Name of the file.
+    std::string_view    m_Data;         ///< Contents of the file.
+    std::size_t         m_Position{0};  ///< Parse position in m_Data.
+};
+
+} // namespace gamelog
+
+} // namespace glicko
+
+#endif // GLICKO_GAMELOG_H
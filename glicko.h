@@ -27,80 +27,390 @@
 #define GLICKO_GLICKO_H
 
 #include <map>
-#include <list>
+#include <memory>
+#include <vector>
 #include <cmath>
 #include <stdexcept>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
 
-namespace glicko
-{
+#include "exception.h"
+#include "gamelog.h"
+#include "kernel.h"
+#include "leaderboard.h"
+#include "snapshot.h"
+#include "solver.h"
+#include "statistics.h"
+#include "traits.h"
 
-namespace config
+namespace glicko
 {
-constexpr double GLICO_CONSTANT = 173.7178;                     ///< The glicko constant to convert from glicko to glicko2 ratings.
-constexpr double INITIAL_RATING = 1500;                         ///< Initial glicko rating for a new player.
-constexpr double INITIAL_DEVIATION = 350;                       ///< Initial glicko rating deviation for a new player.
-}
 
 /**
- * @brief Additional macro to throw an exception of type glicko::GlickoException.
- *
- * @param[in] msg   The message.
+ * @brief Game result
  */
-#define GLTHROW(msg) throw glicko::GlickoException{msg, __FILE__, __LINE__};
+enum class GameResult
+{
+    Player1,    ///< Player 1 has won.
+    Draw,       ///< Draw.
+    Player2     ///< player 2 has won.
+};
+
 
 /**
- * @brief Glicko exception.
+ * @brief Simple pool of worker threads.
  *
- * Saves file name and line number where exception was thrown.
+ * Runs a job over a range of items, handing out chunks of items to the
+ * workers and the calling thread. Threads are started on first use.
+ * Copying a pool creates a new pool with the same number of threads.
  */
-class GlickoException : public std::runtime_error
+class ThreadPool
 {
 public:
+    /**
+     * @brief Job function, called for a range [begin, end) of items.
+     *
+     * worker is the index of the calling thread, from 0 to GetThreadCount()-1.
+     * context is the job object passed to Run.
+     */
+    using Job = void (*)(void *context, unsigned worker, std::size_t begin, std::size_t end);
     /**
      * @brief Constructor
+     */
+    ThreadPool() = default;
+    /**
+     * @brief Copy constructor
+     *
+     * @param[in]   other   Pool to take the number of threads from.
+     */
+    ThreadPool(const ThreadPool &other):
+        m_ThreadCount{other.m_ThreadCount}
+    {
+    }
+    /**
+     * @brief Assignment operator
+     *
+     * @param[in]   other   Pool to take the number of threads from.
+     * @return              This pool.
+     */
+    ThreadPool & operator=(const ThreadPool &other)
+    {
+        if(this != &other)
+        {
+            SetThreadCount(other.m_ThreadCount);
+        }
+        return *this;
+    }
+    /**
+     * @brief Destructor
+     */
+    ~ThreadPool()
+    {
+        Stop();
+    }
+    /**
+     * @brief Set number of threads.
      *
-     * @param[in]   message     Message of exception.
-     * @param[in]   fileName    File name where exception occured.
-     * @param[in]   line        Line where exception occured.
+     * @param[in]   threadCount     Number of threads including the calling one, 0 for one thread per hardware core.
      */
-    GlickoException(const std::string &message, const std::string &fileName, int line):
-        std::runtime_error{message},
-        m_FileName{fileName},
-        m_Line{line}
+    void SetThreadCount(unsigned threadCount)
     {
+        if(threadCount == 0)
+        {
+            threadCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+        Stop();
+        m_ThreadCount = threadCount;
     }
     /**
-     * @brief Get file name.
+     * @brief Get number of threads.
      *
-     * @return File name.
+     * @return  Number of threads including the calling one.
      */
-    std::string GetFileName() const
+    unsigned GetThreadCount() const
     {
-        return m_FileName;
+        return m_ThreadCount;
     }
     /**
-     * @brief Get line number.
+     * @brief Run a job and wait until all items are done.
      *
-     * @return Line number.
+     * Does not allocate memory once the threads are started.
+     * @param[in]   count   Number of items.
+     * @param[in]   job     Job to run, callable as job(worker, begin, end).
      */
-    int GetLine() const
+    template <typename JOB> void Run(std::size_t count, JOB &job)
     {
-        return m_Line;
+        if(m_Workers.size() + 1 < m_ThreadCount)
+        {
+            Start();
+        }
+        {
+            std::lock_guard<std::mutex> lock{m_Mutex};
+            m_Job = [](void *context, unsigned worker, std::size_t begin, std::size_t end)
+            {
+                (*static_cast<JOB *>(context))(worker, begin, end);
+            };
+            m_Context = &job;
+            m_Count = count;
+            m_Next = 0;
+            m_Busy = m_Workers.size();
+            ++m_Generation;
+        }
+        m_WakeUp.notify_all();
+        Work(0);
+        std::unique_lock<std::mutex> lock{m_Mutex};
+        m_Done.wait(lock, [this]{ return m_Busy == 0; });
+        m_Job = nullptr;
     }
 private:
-    std::string m_FileName; ///< File name where exception occured.
-    int         m_Line;     ///< Line in which exception occured.
+    static constexpr std::size_t CHUNK_SIZE = 256;  ///< Number of items handed out at once.
+    unsigned                    m_ThreadCount{1};   ///< Number of threads including the calling one.
+    std::vector<std::thread>    m_Workers;          ///< Worker threads.
+    std::mutex                  m_Mutex;            ///< Protects the job data.
+    std::condition_variable     m_WakeUp;           ///< Signals a new job or stop to the workers.
+    std::condition_variable     m_Done;             ///< Signals that all workers are done.
+    Job                         m_Job{nullptr};     ///< Current job.
+    void *                      m_Context{nullptr}; ///< Context of current job.
+    std::size_t                 m_Count{0};         ///< Number of items of current job.
+    std::atomic<std::size_t>    m_Next{0};          ///< Next item to hand out.
+    std::size_t                 m_Busy{0};          ///< Number of workers still running current job.
+    std::uint64_t               m_Generation{0};    ///< Job counter.
+    bool                        m_Stop{false};      ///< Stop request for the workers.
+    /**
+     * @brief Start worker threads.
+     */
+    void Start()
+    {
+        Stop();
+        for(unsigned i = 1; i < m_ThreadCount; ++i)
+        {
+            m_Workers.emplace_back([this, i, generation = m_Generation]{ WorkerLoop(i, generation); });
+        }
+    }
+    /**
+     * @brief Stop worker threads.
+     */
+    void Stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock{m_Mutex};
+            m_Stop = true;
+        }
+        m_WakeUp.notify_all();
+        for(auto & worker : m_Workers)
+        {
+            worker.join();
+        }
+        m_Workers.clear();
+        m_Stop = false;
+    }
+    /**
+     * @brief Main loop of a worker thread.
+     *
+     * @param[in]   worker      Index of this worker.
+     * @param[in]   generation  Last job already seen by this worker.
+     */
+    void WorkerLoop(unsigned worker, std::uint64_t generation)
+    {
+        std::unique_lock<std::mutex> lock{m_Mutex};
+        for(;;)
+        {
+            m_WakeUp.wait(lock, [&]{ return m_Stop || m_Generation != generation; });
+            if(m_Stop)
+            {
+                return;
+            }
+            generation = m_Generation;
+            lock.unlock();
+            Work(worker);
+            lock.lock();
+            if(--m_Busy == 0)
+            {
+                m_Done.notify_one();
+            }
+        }
+    }
+    /**
+     * @brief Process chunks of the current job until all are handed out.
+     *
+     * @param[in]   worker  Index of the calling thread.
+     */
+    void Work(unsigned worker)
+    {
+        for(;;)
+        {
+            std::size_t begin = m_Next.fetch_add(CHUNK_SIZE);
+            if(begin >= m_Count)
+            {
+                return;
+            }
+            m_Job(m_Context, worker, begin, std::min(begin + CHUNK_SIZE, m_Count));
+        }
+    }
 };
 
 
 /**
- * @brief Game result
+ * @brief Sharded append buffers for items added from many threads.
+ *
+ * Each thread appends to the shard chosen by its thread slot, so producers on
+ * different threads rarely contend for the same lock. Copying creates shards
+ * with the same items.
  */
-enum class GameResult
+template <typename ITEM> class ShardedBuffer
 {
-    Player1,    ///< Player 1 has won.
-    Draw,       ///< Draw.
-    Player2     ///< player 2 has won.
+public:
+    /**
+     * @brief Constructor.
+     *
+     * @param[in]   shardCount  Number of shards, 0 for one per hardware core.
+     */
+    explicit ShardedBuffer(unsigned shardCount = 0)
+    {
+        SetShardCount(shardCount);
+    }
+    /**
+     * @brief Copy constructor.
+     *
+     * @param[in]   other   Buffer to copy.
+     */
+    ShardedBuffer(const ShardedBuffer &other)
+    {
+        SetShardCount(other.m_ShardCount);
+        for(unsigned i = 0; i < m_ShardCount; ++i)
+        {
+            std::lock_guard<std::mutex> lock{other.m_Shards[i].mutex};
+            m_Shards[i].items = other.m_Shards[i].items;
+        }
+    }
+    /**
+     * @brief Assignment operator.
+     *
+     * @param[in]   other   Buffer to copy.
+     * @return              This buffer.
+     */
+    ShardedBuffer & operator=(const ShardedBuffer &other)
+    {
+        if(this != &other)
+        {
+            ShardedBuffer copy{other};
+            std::swap(m_Shards, copy.m_Shards);
+            std::swap(m_ShardCount, copy.m_ShardCount);
+        }
+        return *this;
+    }
+    /**
+     * @brief Set number of shards.
+     *
+     * Items in the buffer are deleted.
+     * @attention Must not be called while other threads add items.
+     * @param[in]   shardCount  Number of shards, 0 for one per hardware core.
+     */
+    void SetShardCount(unsigned shardCount)
+    {
+        if(shardCount == 0)
+        {
+            shardCount = std::max(1u, std::thread::hardware_concurrency());
+        }
+        m_Shards.reset(new Shard[shardCount]);
+        m_ShardCount = shardCount;
+    }
+    /**
+     * @brief Get number of shards.
+     *
+     * @return  Number of shards.
+     */
+    unsigned GetShardCount() const
+    {
+        return m_ShardCount;
+    }
+    /**
+     * @brief Add an item.
+     *
+     * May be called from any thread.
+     * @param[in]   args    Constructor arguments of the item.
+     */
+    template <typename... ARGS> void Add(ARGS &&... args)
+    {
+        Shard & shard = m_Shards[ThreadSlot() % m_ShardCount];
+        std::lock_guard<std::mutex> lock{shard.mutex};
+        shard.items.emplace_back(std::forward<ARGS>(args)...);
+    }
+    /**
+     * @brief Move all items to the end of a vector.
+     *
+     * If the target is empty and smaller than a shard, the vectors are swapped and
+     * the shard continues with the old buffer of the target, else the items are
+     * moved and the shard keeps its capacity. Items added concurrently end up either
+     * in this call or in the next one.
+     * @param[in,out]   target  Vector to append to.
+     */
+    void MoveTo(std::vector<ITEM> &target)
+    {
+        for(unsigned i = 0; i < m_ShardCount; ++i)
+        {
+            Shard & shard = m_Shards[i];
+            std::lock_guard<std::mutex> lock{shard.mutex};
+            if(target.empty() && target.capacity() < shard.items.size())
+            {
+                target.swap(shard.items);
+            }
+            else
+            {
+                target.insert(target.end(), std::make_move_iterator(shard.items.begin()), std::make_move_iterator(shard.items.end()));
+                shard.items.clear();
+            }
+        }
+    }
+    /**
+     * @brief Delete all items.
+     *
+     * Shards keep their capacity.
+     */
+    void Clear()
+    {
+        for(unsigned i = 0; i < m_ShardCount; ++i)
+        {
+            Shard & shard = m_Shards[i];
+            std::lock_guard<std::mutex> lock{shard.mutex};
+            shard.items.clear();
+        }
+    }
+private:
+    /**
+     * @brief One shard, on its own cache line.
+     */
+    struct alignas(64) Shard
+    {
+        mutable std::mutex  mutex;  ///< Protects items.
+        std::vector<ITEM>   items;  ///< Items added to this shard.
+    };
+    std::unique_ptr<Shard[]>    m_Shards;           ///< The shards.
+    unsigned                    m_ShardCount{0};    ///< Number of shards.
+    /**
+     * @brief Get slot of the calling thread.
+     *
+     * @return  Slot number, assigned round-robin on first use.
+     */
+    static unsigned ThreadSlot()
+    {
+        static std::atomic<unsigned> nextSlot{0};
+        thread_local unsigned slot = nextSlot++;
+        return slot;
+    }
 };
 
 
@@ -108,9 +418,14 @@ enum class GameResult
  * @brief The glicko system.
  *
  * It handles players, games and computation stuff.
+ * @tparam  IDTYPE  Type of the player IDs.
+ * @tparam  TRAITS  Compile-time configuration, see BasicTraits.
  */
-template <typename IDTYPE> class Glicko
+template <typename IDTYPE, typename TRAITS = DefaultTraits> class Glicko
 {
+public:
+    using value_type = typename TRAITS::value_type;     ///< Floating-point type of the player table.
+    using index_type = typename TRAITS::template index_type<IDTYPE>;   ///< Index of the players.
 
 private:
     /**
@@ -126,9 +441,9 @@ private:
          * @param[in]   player2ID   ID of player 2.
          * @param[in]   result      Game result.
          */
-        Game(const IDTYPE &player1ID, const IDTYPE &player2ID, GameResult result):
-            m_Player1{player1ID},
-            m_Player2{player2ID},
+        Game(IDTYPE player1ID, IDTYPE player2ID, GameResult result):
+            m_Player1{std::move(player1ID)},
+            m_Player2{std::move(player2ID)},
             m_Result{result}
         {
         }
@@ -137,7 +452,7 @@ private:
          *
          * @return ID of player 1.
          */
-        IDTYPE GetPlayer1ID() const
+        const IDTYPE & GetPlayer1ID() const
         {
             return m_Player1;
         }
@@ -146,7 +461,7 @@ private:
          *
          * @return ID of player 2.
          */
-        IDTYPE GetPlayer2ID() const
+        const IDTYPE & GetPlayer2ID() const
         {
             return m_Player2;
         }
@@ -168,122 +483,346 @@ private:
 
 
     /**
-     * @brief Helper struct for games.
+     * @brief Team of a ranked game, its players are a range of m_RankedIDs.
+     */
+    struct RankedTeam
+    {
+        std::size_t     begin;  ///< First player.
+        std::size_t     end;    ///< One past the last player.
+        unsigned        rank;   ///< Rank of the team, lower is better.
+    };
+    /**
+     * @brief Ranked game, its teams are a range of m_RankedTeams.
+     */
+    struct RankedGame
+    {
+        std::size_t     begin;  ///< First team.
+        std::size_t     end;    ///< One past the last team.
+    };
+
+
+    /**
+     * @brief Data of one thread in a rating period.
+     *
+     * Holds the opponents of the current player, gathered into contiguous arrays for the kernel.
      */
-    struct GameHelper
+    struct WorkerData
     {
-        double  mu;     ///< @todo comment
-        double  phi;    ///< @todo comment
-        double  g;      ///< @todo comment
-        double  E;      ///< @todo comment
-        double  s;      ///< @todo comment
+        std::vector<value_type> mu;     ///< Opponents' ratings.
+        std::vector<value_type> phi;    ///< Opponents' rating deviations.
+        std::vector<value_type> s;      ///< Player's scores.
+        SolverStatistics        solverStatistics;   ///< Statistics of the volatility solver.
+        std::array<std::uint64_t, PeriodStatistics::ITERATION_BUCKETS> iterations{};  ///< Solves by number of iterations (statistics only).
+        /**
+         * @brief Make room for a number of games.
+         *
+         * @param[in]   count   Number of games.
+         */
+        void Reserve(std::size_t count)
+        {
+            if(mu.size() < count)
+            {
+                mu.resize(count);
+                phi.resize(count);
+                s.resize(count);
+            }
+        }
     };
 
 
     /**
-     * @brief Class describing one player.
+     * @brief Structure-of-arrays store of all players.
      *
-     * It has a rating, a rating deviation and a rating volatility.
-     * As a "current" value and a "new" value. The "new" value will be
-     * taken when AdoptNewValues is called.
+     * A player is identified by its index. Each value is kept in its own contiguous
+     * array. The new values of a rating period are computed per active player,
+     * see m_NewRating, so the table holds no second copy of the values.
      * @attention Values in glicko2 scale!
      */
-    class Player
+    struct PlayerTable
     {
-    public:
+        std::vector<value_type> rating;         ///< Players' current ratings.
+        std::vector<value_type> deviation;      ///< Players' current rating deviations.
+        std::vector<value_type> volatility;     ///< Players' current rating volatilities.
+        std::vector<std::uint32_t> period;      ///< Rating period up to which the players' values are valid (streaming mode).
+        std::vector<std::uint8_t> removed;      ///< Tombstone of removed players, 1 if removed.
         /**
-         * @brief Constructor.
+         * @brief Get number of players.
+         *
+         * @return  Number of players.
+         */
+        std::size_t Size() const
+        {
+            return rating.size();
+        }
+        /**
+         * @brief Reserve memory for players.
+         *
+         * @param[in]   count   Number of players.
+         */
+        void Reserve(std::size_t count)
+        {
+            rating.reserve(count);
+            deviation.reserve(count);
+            volatility.reserve(count);
+            period.reserve(count);
+            removed.reserve(count);
+        }
+        /**
+         * @brief Remove players from the end.
+         *
+         * @param[in]   count   New number of players.
+         */
+        void Resize(std::size_t count)
+        {
+            rating.resize(count);
+            deviation.resize(count);
+            volatility.resize(count);
+            period.resize(count);
+            removed.resize(count);
+        }
+        /**
+         * @brief Add a player.
          *
          * @param[in]   initialRating       Initial rating.
          * @param[in]   initialDeviation    Initial rating deviation.
          * @param[in]   initialVolatility   Initial rating volatility.
+         * @param[in]   currentPeriod       Current rating period.
+         * @return                          Index of the new player.
+         */
+        std::size_t Add(value_type initialRating, value_type initialDeviation, value_type initialVolatility, std::uint32_t currentPeriod)
+        {
+            rating.push_back(initialRating);
+            deviation.push_back(initialDeviation);
+            volatility.push_back(initialVolatility);
+            period.push_back(currentPeriod);
+            removed.push_back(0);
+            return rating.size() - 1;
+        }
+        /**
+         * @brief Move a player to the slot of a removed player.
+         *
+         * @param[in]   from    Index of the player, a removed slot afterwards.
+         * @param[in]   to      Index of a removed slot.
          */
-        Player(double initialRating, double initialDeviation, double initialVolatility):
-            m_Rating{initialRating},
-            m_Deviation{initialDeviation},
-            m_Volatility{initialVolatility},
-            m_NewRating{initialRating},
-            m_NewDeviation{initialDeviation},
-            m_NewVolatility{initialVolatility}
+        void Move(std::size_t from, std::size_t to)
         {
+            rating[to] = rating[from];
+            deviation[to] = deviation[from];
+            volatility[to] = volatility[from];
+            period[to] = period[from];
+            removed[to] = 0;
+            removed[from] = 1;
         }
+    };
+
+
+public:
+    /**
+     * @brief A game, used by AddGames.
+     */
+    struct GameRecord
+    {
+        IDTYPE      player1;    ///< ID of player 1.
+        IDTYPE      player2;    ///< ID of player 2.
+        GameResult  result;     ///< Game result.
+    };
+    /**
+     * @brief A player with initial values, used by CreatePlayers.
+     */
+    struct PlayerRecord
+    {
+        IDTYPE      id;         ///< ID of the player.
+        double      rating;     ///< Initial rating.
+        double      deviation;  ///< Initial rating deviation.
+        double      volatility; ///< Initial rating volatility.
+    };
+    /**
+     * @brief Rating, rating deviation and rating volatility of one player.
+     */
+    struct Rating
+    {
+        double      rating;     ///< Rating.
+        double      deviation;  ///< Rating deviation.
+        double      volatility; ///< Rating volatility.
+    };
+    /**
+     * @brief Values of one player in glicko2 scale, as held by the player table.
+     *
+     * Copies a player into another engine without rounding, see GetPlayerState.
+     */
+    struct PlayerState
+    {
+        double      mu;         ///< Rating.
+        double      phi;        ///< Current rating deviation.
+        double      sigma;      ///< Rating volatility.
+    };
+    /**
+     * @brief Ratings of a group of players in contiguous arrays, used by Predict.
+     *
+     * Filled by GetPlayerBatch. Values in glicko2 scale.
+     */
+    struct PlayerBatch
+    {
+        std::vector<double> mu;     ///< Ratings.
+        std::vector<double> phi;    ///< Rating deviations.
         /**
-         * @brief Get rating.
+         * @brief Get number of players.
          *
-         * @return  Current rating.
+         * @return  Number of players.
          */
-        double GetRating() const
+        std::size_t Size() const
         {
-            return m_Rating;
+            return mu.size();
         }
+    };
+    /**
+     * @brief A player in the leaderboard.
+     */
+    struct LeaderboardEntry
+    {
+        IDTYPE      id;         ///< ID of the player.
+        std::size_t rank;       ///< Rank, 1 for the best player.
+        Rating      rating;     ///< Rating, rating deviation and rating volatility.
+    };
+    /**
+     * @brief Change of a player's values in a rating period.
+     */
+    struct RatingChange
+    {
+        IDTYPE      id;         ///< ID of the player.
+        Rating      before;     ///< Values before the rating period.
+        Rating      after;      ///< Values after the rating period.
+    };
+    /**
+     * @brief Minimum changes reported by the change feed.
+     *
+     * A player is reported when any value changes by more than its threshold.
+     */
+    struct ChangeThresholds
+    {
+        double      rating{0};      ///< Rating threshold (glicko scale).
+        double      deviation{0};   ///< Rating deviation threshold (glicko scale).
+        double      volatility{0};  ///< Rating volatility threshold.
+    };
+    /**
+     * @brief Immutable table of all ratings after one rating period.
+     *
+     * Published by the engine with PublishRatings and read through GetRatingTable.
+     * A table never changes, so any number of threads may read it while the engine
+     * computes the next rating period.
+     */
+    class RatingTable
+    {
+    public:
         /**
-         * @brief Get deviation.
+         * @brief Constructor.
          *
-         * @return  Current deviation.
+         * @param[in]   index       Index of each player in ratings.
+         * @param[in]   ids         ID of each player in ratings, read by backends with index::UsesIDs.
+         * @param[in]   ratings     Ratings of all players.
+         * @param[in]   period      Number of rating periods computed.
+         * @param[in]   tau         Tau system constant, used by Preview.
+         * @param[in]   settings    Settings of the volatility solver, used by Preview.
+         * @param[in]   kernel      Kernel, used by Preview.
          */
-        double GetDeviation() const
+        RatingTable(std::shared_ptr<const index_type> index, std::shared_ptr<const std::vector<IDTYPE>> ids,
+                    std::vector<Rating> ratings, std::uint32_t period,
+                    double tau, const SolverSettings &settings, kernel::BasicFunction<value_type> kernel):
+            m_Index{std::move(index)},
+            m_IDs{std::move(ids)},
+            m_Ratings{std::move(ratings)},
+            m_Period{period},
+            m_Tau{tau},
+            m_SolverSettings{settings},
+            m_KernelFunction{kernel}
         {
-            return m_Deviation;
         }
         /**
-         * @brief Get volatility.
+         * @brief Get ratings of one player.
          *
-         * @return  Current volatility.
+         * @throws glicko::GlickoException when player with this ID does not exist.
+         * @param[in]   playerID    ID of the player.
+         * @return                  Rating, rating deviation and rating volatility.
          */
-        double GetVolatility() const
+        Rating Get(const IDTYPE &playerID) const
         {
-            return m_Volatility;
+            Rating rating;
+            if(!Find(playerID, rating))
+            {
+                GLTHROW("Player with this ID does not exist.");
+            }
+            return rating;
         }
         /**
-         * @brief Set new rating.
+         * @brief Find ratings of one player.
          *
-         * Rating will be adopted when AdoptNewValues is called.
-         * @param[in]   rating      New rating.
+         * @param[in]   playerID    ID of the player.
+         * @param[out]  rating      Rating, rating deviation and rating volatility.
+         * @return                  false if player with this ID does not exist.
          */
-        void SetNewRating(double rating)
+        bool Find(const IDTYPE &playerID, Rating &rating) const
         {
-            m_NewRating = rating;
+            std::size_t player = index::Find(*m_Index, playerID, *m_IDs);
+            if(player == index::NOT_FOUND)
+            {
+                return false;
+            }
+            rating = m_Ratings[player];
+            return true;
         }
         /**
-         * @brief Set deviation.
+         * @brief Get number of players.
          *
-         * Rating will be adopted when AdoptNewValues is called.
-         * @param[in]   deviation       New deviation.
+         * @return  Number of players.
          */
-        void SetNewDeviation(double deviation)
+        std::size_t Size() const
         {
-            m_NewDeviation = deviation;
+            return m_Index->Size();
         }
         /**
-         * @brief Set volatility.
+         * @brief Get rating period of this table.
          *
-         * Rating will be adopted when AdoptNewValues is called.
-         * @param[in]   volatility      New volatility.
+         * @return  Number of rating periods computed before this table was published.
          */
-        void SetNewVolatility(double volatility)
+        std::uint32_t GetPeriod() const
         {
-            m_NewVolatility = volatility;
+            return m_Period;
         }
         /**
-         * @brief AdoptNewValues
+         * @brief Preview new ratings for hypothetical games.
+         *
+         * Same as Glicko::Preview, but on the published ratings, so it may run while the
+         * engine computes the next rating period. Values are converted back from glicko
+         * scale and may differ from Glicko::Preview in the last bits.
+         * @throws glicko::GlickoException when a player with this ID does not exist.
+         * @param[in]   games   The hypothetical games.
+         * @return              Values of each player of the games before and after them.
          */
-        void AdoptNewValues()
+        std::vector<RatingChange> Preview(const std::vector<GameRecord> &games) const
         {
-            m_Rating = m_NewRating;
-            m_Deviation = m_NewDeviation;
-            m_Volatility = m_NewVolatility;
+            return ComputePreview(games, [this](const IDTYPE &playerID, PreviewPlayer &player)
+            {
+                player.index = index::Find(*m_Index, playerID, *m_IDs);
+                if(player.index == index::NOT_FOUND)
+                {
+                    return false;
+                }
+                player.before = m_Ratings[player.index];
+                player.mu = (player.before.rating - TRAITS::INITIAL_RATING)*INVERSE_SCALE;
+                player.phi = player.before.deviation*INVERSE_SCALE;
+                player.sigma = player.before.volatility;
+                return true;
+            }, m_Tau, m_SolverSettings, m_KernelFunction);
         }
     private:
-        double      m_Rating{0};            ///< Player's current rating.
-        double      m_Deviation{0};         ///< Player's current rating deviation.
-        double      m_Volatility{0};        ///< Player's current rating volatility.
-        double      m_NewRating{0};         ///< Player's new rating.
-        double      m_NewDeviation{0};      ///< Player's new rating deviation.
-        double      m_NewVolatility{0};     ///< Player's new rating volatility.
+        std::shared_ptr<const index_type>   m_Index;    ///< Index of each player in m_Ratings.
+        std::shared_ptr<const std::vector<IDTYPE>> m_IDs;   ///< ID of each player in m_Ratings.
+        std::vector<Rating>                 m_Ratings;  ///< Ratings of all players.
+        std::uint32_t                       m_Period;   ///< Number of computed rating periods.
+        double                              m_Tau;      ///< Tau system constant.
+        SolverSettings                      m_SolverSettings;   ///< Settings of the volatility solver.
+        kernel::BasicFunction<value_type>   m_KernelFunction;   ///< Kernel of the engine.
     };
-
-
-public:
     /**
      * @brief Constructor.
      *
@@ -292,7 +831,11 @@ public:
      */
     Glicko(double initialVolatility, double tau):
         m_DefaultVolatility{initialVolatility},
-        m_Tau{tau}
+        m_Tau{tau},
+        m_PublishedIndex{std::make_shared<const index_type>()},
+        m_PublishedIDs{std::make_shared<const std::vector<IDTYPE>>()},
+        m_Published{std::make_shared<const RatingTable>(m_PublishedIndex, m_PublishedIDs, std::vector<Rating>{}, 0,
+                                                        m_Tau, m_SolverSettings, m_KernelFunction)}
     {
     }
     static std::string GetVersion()
@@ -308,13 +851,7 @@ public:
      */
     void CreatePlayer(const IDTYPE &playerID)
     {
-        // check if player with this ID already exists
-        if(m_Players.find(playerID) != m_Players.end())
-        {
-            GLTHROW("Player with this ID already exists.");
-        }
-        // create player
-        m_Players.insert({playerID, {0, config::INITIAL_DEVIATION/config::GLICO_CONSTANT, m_DefaultVolatility}});
+        InsertPlayer(playerID, 0, INITIAL_PHI, m_DefaultVolatility);
     }
     /**
      * @brief Create a new player.
@@ -328,32 +865,161 @@ public:
      */
     void CreatePlayer(const IDTYPE &playerID, double initialRating, double initialDeviation, double initialVolatility)
     {
-        // check if player with this ID already exists
-        if(m_Players.find(playerID) != m_Players.end())
-        {
-            GLTHROW("Player with this ID already exists.");
-        }
-        // create player
-        m_Players.insert({playerID, {(initialRating-config::INITIAL_RATING)/config::GLICO_CONSTANT,
-                                     initialDeviation/config::GLICO_CONSTANT, initialVolatility}});
+        InsertPlayer(playerID, (initialRating-TRAITS::INITIAL_RATING)*INVERSE_SCALE,
+                     initialDeviation*INVERSE_SCALE, initialVolatility);
     }
     /**
-     * @brief Remove a player.
+     * @brief Create a new player with values in glicko2 scale.
      *
-     * @throws glicko::GlickoException when player with this ID does not exist.
+     * With a state from GetPlayerState of an engine with the same TRAITS, the
+     * player has exactly the values of the other engine.
+     * @throws glicko::GlickoException when player with this ID already exists.
+     * @param[in]   playerID    ID of the player.
+     * @param[in]   state       Rating, current rating deviation and rating volatility (glicko2 scale).
+     */
+    void CreatePlayer(const IDTYPE &playerID, const PlayerState &state)
+    {
+        InsertPlayer(playerID, state.mu, state.phi, state.sigma);
+    }
+    /**
+     * @brief Create many players.
+     *
+     * The range contains either IDs (players get the default values) or PlayerRecord
+     * entries (values as for CreatePlayer). All IDs are checked in one pass over the
+     * index; if one of them already exists (or occurs twice), no player is created.
+     * Use std::move_iterator to move the IDs out of the range.
+     * @throws glicko::GlickoException when a player with one of the IDs already exists.
+     * @param[in]   first   First ID or PlayerRecord.
+     * @param[in]   last    One past the last ID or PlayerRecord.
+     */
+    template <typename ITERATOR> void CreatePlayers(ITERATOR first, ITERATOR last)
+    {
+        using Category = typename std::iterator_traits<ITERATOR>::iterator_category;
+        using Value = typename std::iterator_traits<ITERATOR>::value_type;
+        constexpr bool WITH_VALUES = std::is_same<Value, PlayerRecord>::value;
+        std::size_t oldCount = m_Table.Size();
+        if constexpr(std::is_base_of<std::forward_iterator_tag, Category>::value)
+        {
+            std::size_t count = oldCount + static_cast<std::size_t>(std::distance(first, last));
+            m_PlayerIDs.reserve(count);
+            m_Table.Reserve(count);
+            m_Index.Reserve(count);
+        }
+        // insert IDs into the index, remember them for rollback
+        ++m_IndexVersion;
+        for(; first != last; ++first)
+        {
+            auto && entry = *first;
+            const IDTYPE * id = nullptr;
+            if constexpr(WITH_VALUES)
+            {
+                id = &entry.id;
+            }
+            else
+            {
+                id = &entry;
+            }
+            if(!index::Insert(m_Index, *id, m_PlayerIDs.size(), m_PlayerIDs))
+            {
+                // roll back
+                for(std::size_t i = oldCount; i < m_PlayerIDs.size(); ++i)
+                {
+                    index::Erase(m_Index, m_PlayerIDs[i], m_PlayerIDs);
+                }
+                m_PlayerIDs.resize(oldCount);
+                m_Table.Resize(oldCount);
+                GLTHROW("Player with this ID already exists.");
+            }
+            if constexpr(WITH_VALUES)
+            {
+                m_Table.Add((entry.rating-TRAITS::INITIAL_RATING)*INVERSE_SCALE,
+                            entry.deviation*INVERSE_SCALE, entry.volatility, m_Period);
+                m_PlayerIDs.push_back(std::forward<decltype(entry)>(entry).id);
+            }
+            else
+            {
+                m_Table.Add(0, INITIAL_PHI, m_DefaultVolatility, m_Period);
+                m_PlayerIDs.push_back(std::forward<decltype(entry)>(entry));
+            }
+        }
+    }
+    /**
+     * @brief Remove a player.
+     *
+     * The player's slot in the player table is marked as removed in O(1) (plus
+     * the index lookup, and O(players) when the leaderboard is enabled). Games
+     * of the player not yet computed are skipped like games of unknown players.
+     * The slots are reclaimed by Compact.
+     * @throws glicko::GlickoException when player with this ID does not exist.
      * @param[in]   playerID    ID of the player.
      */
     void RemovePlayer(const IDTYPE &playerID)
     {
-        auto it = m_Players.find(playerID);
-        // check if player with this ID already exists
-        if(it == m_Players.end())
+        std::size_t player = FindPlayer(playerID);
+        index::Erase(m_Index, playerID, m_PlayerIDs);
+        ++m_IndexVersion;
+        m_Table.removed[player] = 1;
+        ++m_RemovedCount;
+        if(m_LeaderboardEnabled)
         {
-            GLTHROW("Player with this ID does not exist.");
+            m_Leaderboard.Remove(player);
+        }
+    }
+    /**
+     * @brief Reclaim the slots of removed players, a few at a time.
+     *
+     * Players are moved down over the removed slots in index order, one slot per
+     * step, and the table is shortened once the end is reached. Call it with a
+     * small number of steps between other work to compact without a pause;
+     * it may be interleaved with all other calls except ComputeRatings from
+     * another thread. The memory of the table is kept for new players.
+     * @param[in]   steps   Maximum number of slots to process.
+     * @return              Number of removed slots left.
+     */
+    std::size_t Compact(std::size_t steps)
+    {
+        for(; steps > 0 && m_RemovedCount > 0; --steps)
+        {
+            if(m_CompactRead == m_Table.Size())
+            {
+                // end of the table, drop the removed slots behind the last player
+                m_RemovedCount -= m_Table.Size() - m_CompactWrite;
+                m_Table.Resize(m_CompactWrite);
+                m_PlayerIDs.erase(m_PlayerIDs.begin() + m_CompactWrite, m_PlayerIDs.end());
+                m_CompactRead = 0;
+                m_CompactWrite = 0;
+                continue;
+            }
+            if(!m_Table.removed[m_CompactRead])
+            {
+                if(m_CompactRead != m_CompactWrite)
+                {
+                    MovePlayer(m_CompactRead, m_CompactWrite);
+                }
+                ++m_CompactWrite;
+            }
+            ++m_CompactRead;
         }
-        // remove player
-        delete *it;
-        m_Players.remove(playerID);
+        return m_RemovedCount;
+    }
+    /**
+     * @brief Get number of players.
+     *
+     * @return  Number of players, without removed ones.
+     */
+    std::size_t GetPlayerCount() const
+    {
+        return m_Table.Size() - m_RemovedCount;
+    }
+    /**
+     * @brief Check if a player exists.
+     *
+     * @param[in]   playerID    ID of the player.
+     * @return                  true if a player with this ID exists.
+     */
+    bool HasPlayer(const IDTYPE &playerID) const
+    {
+        return index::Find(m_Index, playerID, m_PlayerIDs) != NO_PLAYER;
     }
     /**
      * @brief Get rating for one player.
@@ -362,15 +1028,9 @@ public:
      * @param[in]   playerID    ID of the player.
      * @return                  Player rating.
      */
-    double GetRating(const IDTYPE &playerID)
+    double GetRating(const IDTYPE &playerID) const
     {
-        auto it = m_Players.find(playerID);
-        // check if player with this ID already exists
-        if(it == m_Players.end())
-        {
-            GLTHROW("Player with this ID does not exist.");
-        }
-        return config::GLICO_CONSTANT * it->second.GetRating() + config::INITIAL_RATING;
+        return ToRating(m_Table.rating[FindPlayer(playerID)]);
     }
     /**
      * @brief Get rating deviation for one player.
@@ -379,15 +1039,9 @@ public:
      * @param[in]   playerID    ID of the player.
      * @return                  Player rating deviation.
      */
-    double GetDeviation(const IDTYPE &playerID)
+    double GetDeviation(const IDTYPE &playerID) const
     {
-        auto it = m_Players.find(playerID);
-        // check if player with this ID already exists
-        if(it == m_Players.end())
-        {
-            GLTHROW("Player with this ID does not exist.");
-        }
-        return config::GLICO_CONSTANT * it->second.GetDeviation();
+        return TRAITS::GLICO_CONSTANT * CurrentDeviation(FindPlayer(playerID));
     }
     /**
      * @brief Get rating volatility for one player.
@@ -396,15 +1050,21 @@ public:
      * @param[in]   playerID    ID of the player.
      * @return                  Player rating volatility.
      */
-    double GetVolatility(const IDTYPE &playerID)
+    double GetVolatility(const IDTYPE &playerID) const
     {
-        auto it = m_Players.find(playerID);
-        // check if player with this ID already exists
-        if(it == m_Players.end())
-        {
-            GLTHROW("Player with this ID does not exist.");
-        }
-        return it->second.GetVolatility();
+        return m_Table.volatility[FindPlayer(playerID)];
+    }
+    /**
+     * @brief Get values of one player in glicko2 scale.
+     *
+     * @throws glicko::GlickoException when player with this ID does not exist.
+     * @param[in]   playerID    ID of the player.
+     * @return                  Rating, current rating deviation and rating volatility (glicko2 scale).
+     */
+    PlayerState GetPlayerState(const IDTYPE &playerID) const
+    {
+        std::size_t player = FindPlayer(playerID);
+        return {m_Table.rating[player], CurrentDeviation(player), m_Table.volatility[player]};
     }
     /**
      * @brief Add a game.
@@ -415,164 +1075,1882 @@ public:
      */
     void AddGame(const IDTYPE &playerID1, const IDTYPE &playerID2, GameResult result)
     {
-        m_Games.push_back({playerID1, playerID2, result});
+        m_Games.emplace_back(playerID1, playerID2, result);
+    }
+    /**
+     * @brief Add a game, moving the player IDs.
+     *
+     * @param[in]   playerID1   ID of player 1.
+     * @param[in]   playerID2   ID of player 2.
+     * @param[in]   result      game result.
+     */
+    void AddGame(IDTYPE &&playerID1, IDTYPE &&playerID2, GameResult result)
+    {
+        m_Games.emplace_back(std::move(playerID1), std::move(playerID2), result);
+    }
+    /**
+     * @brief Add a game from any thread.
+     *
+     * Thread-safe, also while ComputeRatings is running. Games are collected in
+     * per-thread shards and merged at the start of ComputeRatings; games added after
+     * the merge belong to the next rating period.
+     * @param[in]   playerID1   ID of player 1.
+     * @param[in]   playerID2   ID of player 2.
+     * @param[in]   result      game result.
+     */
+    void AddGameConcurrent(IDTYPE playerID1, IDTYPE playerID2, GameResult result)
+    {
+        m_ConcurrentGames.Add(std::move(playerID1), std::move(playerID2), result);
+    }
+    /**
+     * @brief Set number of shards used by AddGameConcurrent.
+     *
+     * Games added by AddGameConcurrent and not yet computed are deleted.
+     * @attention Must not be called while other threads add games.
+     * @param[in]   shardCount  Number of shards, 0 for one per hardware core.
+     */
+    void SetIngestionShards(unsigned shardCount)
+    {
+        m_ConcurrentGames.SetShardCount(shardCount);
+    }
+    /**
+     * @brief Add many games.
+     *
+     * Storage is reserved up front for forward iterators. Use std::move_iterator
+     * (or std::make_move_iterator) to move the IDs out of the records.
+     * @param[in]   first   First GameRecord.
+     * @param[in]   last    One past the last GameRecord.
+     */
+    template <typename ITERATOR> void AddGames(ITERATOR first, ITERATOR last)
+    {
+        using Category = typename std::iterator_traits<ITERATOR>::iterator_category;
+        if constexpr(std::is_base_of<std::forward_iterator_tag, Category>::value)
+        {
+            m_Games.reserve(m_Games.size() + static_cast<std::size_t>(std::distance(first, last)));
+        }
+        for(; first != last; ++first)
+        {
+            auto && record = *first;
+            m_Games.emplace_back(std::forward<decltype(record)>(record).player1,
+                                 std::forward<decltype(record)>(record).player2, record.result);
+        }
+    }
+    /**
+     * @brief Add a game between two teams.
+     *
+     * Each player plays one game against the other team as a composite
+     * opponent, with the mean rating and the root mean square rating deviation
+     * of its players (values before the rating period). A team of one player
+     * is the player itself, so a 1 vs 1 team game equals AddGame.
+     * @throws glicko::GlickoException when a team is empty.
+     * @param[in]   team1   IDs of the players of team 1.
+     * @param[in]   team2   IDs of the players of team 2.
+     * @param[in]   result  Game result, GameResult::Player1 if team 1 has won.
+     */
+    void AddTeamGame(const std::vector<IDTYPE> &team1, const std::vector<IDTYPE> &team2, GameResult result)
+    {
+        if(team1.empty() || team2.empty())
+        {
+            GLTHROW("Teams must not be empty.");
+        }
+        m_RankedGames.push_back({m_RankedTeams.size(), m_RankedTeams.size() + 2});
+        AddRankedTeam(team1.begin(), team1.end(), (result == GameResult::Player2) ? 1 : 0);
+        AddRankedTeam(team2.begin(), team2.end(), (result == GameResult::Player1) ? 1 : 0);
+    }
+    /**
+     * @brief Add a free-for-all game.
+     *
+     * Decomposed into games of each player against each other player: won
+     * against worse ranked players, drawn against equally ranked ones and lost
+     * against better ranked ones. The games are computed directly, without
+     * adding n*(n-1)/2 games; the results are the same as adding them with
+     * AddGame in the order (0, 1), (0, 2), ..., (1, 2), ...
+     * @throws glicko::GlickoException when there are less than two players or the number of ranks differs.
+     * @param[in]   players     IDs of the players.
+     * @param[in]   ranks       Rank of each player, 0 for the winner, equal ranks for ties.
+     */
+    void AddFreeForAllGame(const std::vector<IDTYPE> &players, const std::vector<unsigned> &ranks)
+    {
+        if(players.size() < 2 || players.size() != ranks.size())
+        {
+            GLTHROW("A free-for-all game needs at least two players with one rank each.");
+        }
+        m_RankedGames.push_back({m_RankedTeams.size(), m_RankedTeams.size() + players.size()});
+        for(std::size_t i = 0; i < players.size(); ++i)
+        {
+            AddRankedTeam(players.begin() + i, players.begin() + i + 1, ranks[i]);
+        }
+    }
+    /**
+     * @brief Add a game of several ranked teams.
+     *
+     * Each player plays one game against each other team as a composite
+     * opponent (see AddTeamGame): won against worse ranked teams, drawn against
+     * equally ranked ones and lost against better ranked ones.
+     * @throws glicko::GlickoException when there are less than two teams, a team is empty or the number of ranks differs.
+     * @param[in]   teams   IDs of the players of each team.
+     * @param[in]   ranks   Rank of each team, 0 for the winner, equal ranks for ties.
+     */
+    void AddRankedGame(const std::vector<std::vector<IDTYPE>> &teams, const std::vector<unsigned> &ranks)
+    {
+        if(teams.size() < 2 || teams.size() != ranks.size())
+        {
+            GLTHROW("A ranked game needs at least two teams with one rank each.");
+        }
+        for(const auto & team : teams)
+        {
+            if(team.empty())
+            {
+                GLTHROW("Teams must not be empty.");
+            }
+        }
+        m_RankedGames.push_back({m_RankedTeams.size(), m_RankedTeams.size() + teams.size()});
+        for(std::size_t i = 0; i < teams.size(); ++i)
+        {
+            AddRankedTeam(teams[i].begin(), teams[i].end(), ranks[i]);
+        }
+    }
+    /**
+     * @brief Set settings of the volatility solver.
+     *
+     * @param[in]   settings    Solver settings.
+     */
+    void SetSolverSettings(const SolverSettings &settings)
+    {
+        m_SolverSettings = settings;
+    }
+    /**
+     * @brief Get settings of the volatility solver.
+     *
+     * @return  Solver settings.
+     */
+    const SolverSettings & GetSolverSettings() const
+    {
+        return m_SolverSettings;
+    }
+    /**
+     * @brief Get statistics of the volatility solver.
+     *
+     * @return  Number of solves, iterations and failed solves in the last rating period.
+     */
+    const SolverStatistics & GetSolverStatistics() const
+    {
+        return m_SolverStatistics;
+    }
+    /**
+     * @brief Get statistics of the last rating period.
+     *
+     * Only available when TRAITS::STATISTICS is set.
+     * @return  Statistics, all zero before the first rating period.
+     */
+    const PeriodStatistics & GetPeriodStatistics() const
+    {
+        static_assert(TRAITS::STATISTICS, "Statistics are disabled in the traits of this Glicko.");
+        return m_PeriodStatistics;
+    }
+    /**
+     * @brief Reserve memory for players and games.
+     *
+     * Rating periods with at most this many players and games do not allocate
+     * memory. Buffers also keep their size from earlier rating periods.
+     * @param[in]   playerCount     Number of players.
+     * @param[in]   gameCount       Number of games per rating period.
+     */
+    void Reserve(std::size_t playerCount, std::size_t gameCount)
+    {
+        m_Index.Reserve(playerCount);
+        m_PlayerIDs.reserve(playerCount);
+        m_Table.Reserve(playerCount);
+        m_GameOffsets.reserve(playerCount + 1);
+        m_Games.reserve(gameCount);
+        m_GamePlayers.reserve(2*gameCount);
+        m_GameOpponents.reserve(2*gameCount);
+        m_GameScores.reserve(2*gameCount);
+    }
+    /**
+     * @brief Freeze the player index into a perfect hash table.
+     *
+     * Call after a bulk load of players. Needs an index_type with Freeze, e.g.
+     * index::PerfectHashIndex. Players created later are kept in a regular hash
+     * table until the next call.
+     * @return  true if the perfect hash table was built.
+     */
+    bool FreezeIndex()
+    {
+        ++m_IndexVersion;
+        return m_Index.Freeze();
     }
     /**
      * @brief Compute new player ratings.
      *
-     * Ratings for all players are updated.
+     * Ratings for all players are updated. The games are resolved to player indices
+     * once and grouped by player, then all players are processed in one linear
+     * sweep over the player table, so a rating period costs O(players + games).
+     * Once the buffers have grown to the size of the rating period (see Reserve),
+     * no memory is allocated.
      * @attention List of played games is deleted after computing new ratings.
      */
     void ComputeRatings()
     {
-        // iterate through players
-        for(auto it = m_Players.begin(); it != m_Players.end(); ++it)
+        std::chrono::steady_clock::time_point phaseStart;
+        BeginPeriod(phaseStart);
+        m_ConcurrentGames.MoveTo(m_Games);
+        EndPhase(Phase::Merge, phaseStart);
+        std::size_t maxGameCount = BuildGameIndex();
+        EndPhase(Phase::Index, phaseStart);
+        ComputePeriod(maxGameCount, m_Games.size() + m_RankedGames.size(), false, phaseStart);
+        m_Games.clear();
+        m_RankedIDs.clear();
+        m_RankedTeams.clear();
+        m_RankedGames.clear();
+    }
+    /**
+     * @brief Compute new player ratings from games read in chunks.
+     *
+     * For game logs larger than the memory: the games are read chunk by chunk and
+     * only the sums of the scalar kernel are kept for each active player, so the
+     * memory needed depends on the number of players, not on the number of games.
+     * The current values of the players are the state before the rating period.
+     * The results are the same as adding all games and calling ComputeRatings()
+     * with Kernel::Scalar. Games added with AddGame, AddTeamGame etc. are not part
+     * of this rating period, they stay for the next ComputeRatings().
+     * @throws Exceptions of the reader, e.g. for a truncated log. The rating period
+     *         is then not computed and the players keep their values.
+     * @tparam      READER      Source of games with bool Read(std::vector<gamelog::Record<IDTYPE>> &games, std::size_t maxCount),
+     *                          e.g. gamelog::Reader.
+     * @param[in]   reader      Source of the games.
+     * @param[in]   chunkSize   Maximum number of games held in memory.
+     */
+    template <typename READER>
+    void ComputeRatings(READER &reader, std::size_t chunkSize = 65536)
+    {
+        std::chrono::steady_clock::time_point phaseStart;
+        BeginPeriod(phaseStart);
+        if(m_ActiveSlot.size() < m_Table.Size())
         {
-            IDTYPE playerID = it->first;
-            Player & player = it->second;
-            std::list<GameHelper> playedGames = CreateGameHelperList(playerID, player.GetRating());
-            // compute new ratings for player
-            if(!playedGames.empty())
+            m_ActiveSlot.resize(m_Table.Size(), NO_PLAYER);
+        }
+        m_GameOffsets.assign(1, 0);
+        m_LogSumV.clear();
+        m_LogSumDelta.clear();
+        std::size_t gameCount = 0;
+        std::vector<gamelog::Record<IDTYPE>> games;
+        try
+        {
+            while(reader.Read(games, chunkSize))
             {
-                // player has played some games
-                double v = 0;
-                double delta = 0;
-                for(auto & it : playedGames)
-                {
-                    v += it.g*it.g*it.E*(1-it.E);
-                    delta += it.g*(it.s-it.E);
-                }
-                v = 1/v;
-                delta = v*delta;
-                // start iteration
-                double sigma = player.GetVolatility();
-                double phi = player.GetDeviation();
-                double a = log(sigma*sigma);
-                double A = a;
-                double B = 0;
-                constexpr double EPSILON = 0.000001;
-                if(delta*delta > phi*phi + v)
+                gameCount += games.size();
+                for(const auto & game : games)
                 {
-                    B = log(delta*delta - phi*phi - v);
-                }
-                else
-                {
-                    // iterate
-                    double k = 1;
-                    while(f(a - k*m_Tau, delta, phi, v, a) < 0)
-                    {
-                        k++;
-                    }
-                    B = a - k*m_Tau;
-                }
-                double fA = f(A, delta, phi, v, a);
-                double fB = f(B, delta, phi, v, a);
-                while(fabs(B-A) > EPSILON)
-                {
-                    double C = A + (A - B)*fA/(fB-fA);
-                    double fC = f(C, delta, phi, v, a);
-                    if(fB*fC < 0)
+                    std::size_t player1 = index::Find(m_Index, game.player1, m_PlayerIDs);
+                    std::size_t player2 = index::Find(m_Index, game.player2, m_PlayerIDs);
+                    if(player1 == NO_PLAYER || player2 == NO_PLAYER)
                     {
-                        A = B;
-                        fA = fB;
+                        // games of unknown players are skipped
+                        if constexpr(TRAITS::STATISTICS)
+                        {
+                            ++m_PeriodStatistics.unmatchedGames;
+                        }
+                        continue;
                     }
-                    else
+                    AccumulateGame(player1, player2, (game.result == GameResult::Player1) ? 1 : ((game.result == GameResult::Draw) ? 0.5 : 0));
+                    if(player2 != player1)
                     {
-                        fA = fA/2;
+                        AccumulateGame(player2, player1, (game.result == GameResult::Player2) ? 1 : ((game.result == GameResult::Draw) ? 0.5 : 0));
                     }
-                    B = C;
-                    fB = fC;
                 }
-                double newSigma = exp(A/2);
-                double phiStarSquare = phi*phi + newSigma*newSigma;
-                double newPhi = 1/sqrt(1/phiStarSquare + 1/v);
-                double newMu = player.GetRating() + newPhi*newPhi*delta/v;
-                player.SetNewRating(newMu);
-                player.SetNewDeviation(newPhi);
-                player.SetNewVolatility(newSigma);
-            }
-            else
-            {
-                // player has not played any games
-                double phi = player.GetDeviation();
-                double sigma = player.GetVolatility();
-                player.SetNewDeviation(sqrt(phi*phi + sigma*sigma));
             }
         }
-        // adopt new ratings for each player
-        for(auto & player : m_Players)
+        catch(...)
         {
-            player.second.AdoptNewValues();
+            // drop the partial period, the players stay unchanged
+            ClearActivePlayers();
+            m_LogSumV.clear();
+            m_LogSumDelta.clear();
+            throw;
         }
-        // cleanup games list
-        m_Games.clear();
+        EndPhase(Phase::Index, phaseStart);
+        ComputePeriod(0, gameCount, true, phaseStart);
     }
-protected:
-private:
-    std::map<IDTYPE, Player>    m_Players;                          ///< The players.
-    std::list<Game>             m_Games;                            ///< The games played.
-    double                      m_DefaultVolatility{0};             ///< Default rating volatility when creating a new player.
-    double                      m_Tau{0};                           ///< Tau system constant.
     /**
-     * @brief Create and fill list of game helper structs.
+     * @brief Compute rating periods without games in one step.
      *
-     * @param[in]   playerID        Player ID.
-     * @param[in]   playerRating    Rating for player.
-     * @return                      The list of game helper structs
+     * The deviation of every player grows to sqrt(phi^2 + count*sigma^2), ratings and
+     * volatilities stay. Costs O(players) once, O(1) in streaming mode, whatever the
+     * count. The results are those of count calls of ComputeRatings() without games,
+     * up to the last bits of the deviations. Games added and not yet computed stay
+     * for the next ComputeRatings().
+     * @param[in]   count   Number of rating periods.
      */
-    std::list<GameHelper> CreateGameHelperList(const IDTYPE playerID, double playerRating)
+    void ComputeIdlePeriods(std::uint64_t count)
     {
-        std::list<GameHelper> result;
-        // search for played games and add according results
-        for(auto & game : m_Games)
+        if(count == 0)
+        {
+            return;
+        }
+        std::chrono::steady_clock::time_point phaseStart;
+        BeginPeriod(phaseStart);
+        // periods are counted modulo 2^32, longer runs are applied to every player
+        bool eager = !m_Streaming || count > std::numeric_limits<std::uint32_t>::max()/2;
+        std::uint32_t period = static_cast<std::uint32_t>(m_Period + count);
+        if(m_ChangeFeedEnabled)
         {
-            const Player * opponent{nullptr};
-            double s = 0;
-            if(game.GetPlayer1ID() == playerID)
+            // in streaming mode only players with games are reported
+            if(m_Streaming)
             {
-                // we are the first player
-                auto it = m_Players.find(game.GetPlayer2ID());
-                if(it != m_Players.end())
-                {
-                    opponent = &(it->second);
-                    s = (game.GetResult() == GameResult::Player1) ? 1 : ((game.GetResult() == GameResult::Draw) ? 0.5 : 0);
-                }
+                m_Changes.clear();
             }
-            else if(game.GetPlayer2ID() == playerID)
+            else
             {
-                // we are the second player
-                auto it = m_Players.find(game.GetPlayer1ID());
-                if(it != m_Players.end())
+                CollectChanges(static_cast<double>(count));
+            }
+        }
+        if(eager)
+        {
+            for(std::size_t i = 0; i < m_Table.Size(); ++i)
+            {
+                m_Table.deviation[i] = IdleDeviation(i, static_cast<double>(count));
+                if(m_Streaming)
                 {
-                    opponent = &(it->second);
-                    s = (game.GetResult() == GameResult::Player2) ? 1 : ((game.GetResult() == GameResult::Draw) ? 0.5 : 0);
+                    m_Table.period[i] = period;
                 }
             }
-            if(opponent)
+        }
+        EndPhase(Phase::Compute, phaseStart);
+        if(m_LeaderboardEnabled)
+        {
+            UpdateLeaderboard({});
+        }
+        m_Period = period;
+        EndPhase(Phase::Adopt, phaseStart);
+        if(m_AutoPublish)
+        {
+            PublishRatings();
+            EndPhase(Phase::Publish, phaseStart);
+        }
+        if constexpr(TRAITS::STATISTICS)
+        {
+            m_PeriodStatistics.idlePlayers = m_Table.Size() - m_RemovedCount;
+        }
+    }
+    /**
+     * @brief Enable or disable streaming mode.
+     *
+     * In streaming mode ComputeRatings only processes players who played games
+     * in the rating period, so its cost depends on the activity, not on the
+     * number of players. The deviation growth of idle players is applied lazily
+     * from the number of missed rating periods, when they are read or play again.
+     * As sqrt(phi^2 + n*sigma^2) is used instead of n single steps, deviations
+     * may differ from the normal mode in the last bits.
+     * @param[in]   streaming   true to enable streaming mode.
+     */
+    void SetStreaming(bool streaming)
+    {
+        if(streaming == m_Streaming)
+        {
+            return;
+        }
+        for(std::size_t i = 0; i < m_Table.Size(); ++i)
+        {
+            if(m_Streaming)
             {
-                double mu = opponent->GetRating();
-                double phi = opponent->GetDeviation();
-                double g = 1/sqrt(1+3*phi*phi/M_PI/M_PI);
-                double E = 1/(1+exp(-g*(playerRating-mu)));
-                result.push_back({mu, phi, g, E, s});
+                // leaving streaming mode: apply pending deviation growth
+                m_Table.deviation[i] = CurrentDeviation(i);
             }
+            m_Table.period[i] = m_Period;
+        }
+        m_Streaming = streaming;
+    }
+    /**
+     * @brief Check if streaming mode is enabled.
+     *
+     * @return  true if streaming mode is enabled.
+     */
+    bool IsStreaming() const
+    {
+        return m_Streaming;
+    }
+    /**
+     * @brief Enable or disable the leaderboard.
+     *
+     * The leaderboard orders all players by rating and is updated at the end of
+     * each rating period. Players created later are ranked in the next rating
+     * period, or at once by calling SetLeaderboard(true) again.
+     * @param[in]   enable  true to enable.
+     */
+    void SetLeaderboard(bool enable)
+    {
+        m_LeaderboardEnabled = enable;
+        if(enable)
+        {
+            UpdateLeaderboard({});
+        }
+        else
+        {
+            m_Leaderboard.Clear();
         }
-        return result;
     }
     /**
-     * @brief f function.
+     * @brief Get the best players.
+     *
+     * @throws glicko::GlickoException when the leaderboard is disabled.
+     * @param[in]   count   Maximum number of players.
+     * @return              Players, best first.
+     */
+    std::vector<LeaderboardEntry> GetTopPlayers(std::size_t count) const
+    {
+        CheckLeaderboard();
+        return GetLeaderboardEntries(0, std::min(count, m_Leaderboard.Size()));
+    }
+    /**
+     * @brief Get rank of a player.
+     *
+     * Players with equal ratings get consecutive ranks in order of creation.
+     * @throws glicko::GlickoException when the leaderboard is disabled or the player is not ranked.
+     * @param[in]   playerID    ID of the player.
+     * @return                  Rank, 1 for the best player.
+     */
+    std::size_t GetRank(const IDTYPE &playerID) const
+    {
+        return FindRankPosition(playerID) + 1;
+    }
+    /**
+     * @brief Get percentile of a player.
+     *
+     * @throws glicko::GlickoException when the leaderboard is disabled or the player is not ranked.
+     * @param[in]   playerID    ID of the player.
+     * @return                  Percentage of ranked players with a lower rating.
+     */
+    double GetPercentile(const IDTYPE &playerID) const
+    {
+        std::size_t position = FindRankPosition(playerID);
+        std::size_t below = m_Leaderboard.CountBelow(m_Leaderboard.GetRating(position));
+        return 100.0*below/m_Leaderboard.Size();
+    }
+    /**
+     * @brief Get players within a rating window.
+     *
+     * @throws glicko::GlickoException when the leaderboard is disabled.
+     * @param[in]   minRating   Lowest rating.
+     * @param[in]   maxRating   Highest rating.
+     * @return                  Players with minRating <= rating <= maxRating, best first.
+     */
+    std::vector<LeaderboardEntry> GetPlayersInRange(double minRating, double maxRating) const
+    {
+        CheckLeaderboard();
+        auto range = m_Leaderboard.GetRange(minRating, maxRating);
+        return GetLeaderboardEntries(range.first, range.second);
+    }
+    /**
+     * @brief Get expected score of a game.
      *
-     * @todo comment
-     * @param[in]   x       @todo comment
-     * @param[in]   delta   @todo comment
-     * @param[in]   phi     @todo comment
-     * @param[in]   v       @todo comment
-     * @param[in]   a       @todo comment
-     * @return
+     * Uses the rating deviations of both players.
+     * @throws glicko::GlickoException when a player with this ID does not exist.
+     * @param[in]   playerID1   ID of player 1.
+     * @param[in]   playerID2   ID of player 2.
+     * @return                  Expected score of player 1, between 0 and 1.
      */
-    double f(double x, double delta, double phi, double v, double a)
+    double GetExpectedScore(const IDTYPE &playerID1, const IDTYPE &playerID2) const
     {
-        return exp(x)*(delta*delta - phi*phi - v - exp(x))/2/(phi*phi + v + exp(x))/(phi*phi + v + exp(x)) - (x - a)/m_Tau/m_Tau;
+        double expected = 0;
+        double quality = 0;
+        PredictPair(playerID1, playerID2, expected, quality);
+        return expected;
+    }
+    /**
+     * @brief Get match quality of a game.
+     *
+     * @throws glicko::GlickoException when a player with this ID does not exist.
+     * @param[in]   playerID1   ID of player 1.
+     * @param[in]   playerID2   ID of player 2.
+     * @return                  4E(1-E) for the expected score E, 1 for an even game.
+     */
+    double GetMatchQuality(const IDTYPE &playerID1, const IDTYPE &playerID2) const
+    {
+        double expected = 0;
+        double quality = 0;
+        PredictPair(playerID1, playerID2, expected, quality);
+        return quality;
+    }
+    /**
+     * @brief Preview new ratings for hypothetical games.
+     *
+     * Computes the players of the games as if the games were the only games of the next
+     * rating period, e.g. to show the rating after a win, draw or loss. Only the players of
+     * the games are touched and nothing is changed, so any number of previews may run
+     * concurrently with other const calls. The values are the same as after adding the games
+     * and calling ComputeRatings. Cost grows with the square of the number of games.
+     * @throws glicko::GlickoException when a player with this ID does not exist.
+     * @param[in]   games   The hypothetical games.
+     * @return              Values of each player of the games before and after them,
+     *                      in the order of first appearance.
+     */
+    std::vector<RatingChange> Preview(const std::vector<GameRecord> &games) const
+    {
+        return ComputePreview(games, [this](const IDTYPE &playerID, PreviewPlayer &player)
+        {
+            player.index = index::Find(m_Index, playerID, m_PlayerIDs);
+            if(player.index == NO_PLAYER)
+            {
+                return false;
+            }
+            double phi = CurrentDeviation(player.index);
+            player.mu = m_Table.rating[player.index];
+            player.phi = static_cast<value_type>(phi);
+            player.sigma = m_Table.volatility[player.index];
+            player.before = {ToRating(player.mu), TRAITS::GLICO_CONSTANT * phi, player.sigma};
+            return true;
+        }, m_Tau, m_SolverSettings, m_KernelFunction);
+    }
+    /**
+     * @brief Gather ratings of players for Predict.
+     *
+     * Look up the players once and predict many games with the batch.
+     * @throws glicko::GlickoException when a player with this ID does not exist.
+     * @param[in]   first   Iterator to the first player ID.
+     * @param[in]   last    Iterator past the last player ID.
+     * @param[out]  batch   The players' ratings, in the order of the IDs.
+     */
+    template <typename ITERATOR>
+    void GetPlayerBatch(ITERATOR first, ITERATOR last, PlayerBatch &batch) const
+    {
+        batch.mu.clear();
+        batch.phi.clear();
+        for(; first != last; ++first)
+        {
+            std::size_t player = FindPlayer(*first);
+            batch.mu.push_back(m_Table.rating[player]);
+            batch.phi.push_back(CurrentDeviation(player));
+        }
+    }
+    /**
+     * @brief Predict games of one player against a batch of candidates.
+     *
+     * Uses the kernel set by SetKernel.
+     * @throws glicko::GlickoException when player with this ID does not exist.
+     * @param[in]   playerID    ID of the player.
+     * @param[in]   candidates  The candidates.
+     * @param[out]  expected    Expected score of the player against each candidate.
+     * @param[out]  quality     Match quality of each pairing.
+     */
+    void Predict(const IDTYPE &playerID, const PlayerBatch &candidates, std::vector<double> &expected, std::vector<double> &quality) const
+    {
+        std::size_t player = FindPlayer(playerID);
+        expected.resize(candidates.Size());
+        quality.resize(candidates.Size());
+        m_PredictionFunction(m_Table.rating[player], CurrentDeviation(player), candidates.mu.data(), candidates.phi.data(),
+                             candidates.Size(), expected.data(), quality.data());
+    }
+    /**
+     * @brief Predict games of each player against each candidate.
+     *
+     * Uses the kernel set by SetKernel.
+     * @param[in]   players     The players (rows).
+     * @param[in]   candidates  The candidates (columns).
+     * @param[out]  expected    Expected scores of the players, row-major players.Size() x candidates.Size() matrix.
+     * @param[out]  quality     Match qualities, same layout.
+     */
+    void Predict(const PlayerBatch &players, const PlayerBatch &candidates, std::vector<double> &expected, std::vector<double> &quality) const
+    {
+        std::size_t columns = candidates.Size();
+        expected.resize(players.Size()*columns);
+        quality.resize(players.Size()*columns);
+        for(std::size_t i = 0; i < players.Size(); ++i)
+        {
+            m_PredictionFunction(players.mu[i], players.phi[i], candidates.mu.data(), candidates.phi.data(),
+                                 columns, expected.data() + i*columns, quality.data() + i*columns);
+        }
+    }
+    /**
+     * @brief Publish the current ratings for concurrent readers.
+     *
+     * Builds a new immutable RatingTable (glicko scale) and replaces the published one
+     * atomically. Readers holding the old table keep it until they release it.
+     * Costs O(players); the ID index, and the player IDs it reads, are only copied
+     * when players were added.
+     */
+    void PublishRatings()
+    {
+        if(m_PublishedIndexVersion != m_IndexVersion || m_PublishedIndex->Size() != m_Index.Size())
+        {
+            m_PublishedIndex = std::make_shared<const index_type>(m_Index);
+            if constexpr(index::UsesIDs<index_type>::value)
+            {
+                m_PublishedIDs = std::make_shared<const std::vector<IDTYPE>>(m_PlayerIDs);
+            }
+            m_PublishedIndexVersion = m_IndexVersion;
+        }
+        std::vector<Rating> ratings(m_Table.Size());
+        for(std::size_t i = 0; i < ratings.size(); ++i)
+        {
+            ratings[i] = {ToRating(m_Table.rating[i]), TRAITS::GLICO_CONSTANT * CurrentDeviation(i), m_Table.volatility[i]};
+        }
+        std::atomic_store(&m_Published, std::make_shared<const RatingTable>(m_PublishedIndex, m_PublishedIDs, std::move(ratings), m_Period,
+                                                                         m_Tau, m_SolverSettings, m_KernelFunction));
+    }
+    /**
+     * @brief Get the last published rating table.
+     *
+     * May be called from any thread, also while the engine is computing a rating period.
+     * @return  The table, empty if nothing was published yet.
+     */
+    std::shared_ptr<const RatingTable> GetRatingTable() const
+    {
+        return std::atomic_load(&m_Published);
+    }
+    /**
+     * @brief Enable or disable publishing after each rating period.
+     *
+     * @param[in]   publish     true to call PublishRatings at the end of ComputeRatings.
+     */
+    void SetAutoPublish(bool publish)
+    {
+        m_AutoPublish = publish;
+    }
+    /**
+     * @brief Enable or disable the change feed.
+     *
+     * When enabled, ComputeRatings collects the players whose values changed by
+     * more than the thresholds, with their values before and after the rating
+     * period, in the adopt phase. Downstream caches can then be updated in
+     * O(changed) through GetChanges. In normal mode the deviation of every idle
+     * player grows each period, use a deviation threshold to report active
+     * players only. In streaming mode only players with games are reported, the
+     * deviation of idle players grows by sqrt(phi^2 + sigma^2) per period without
+     * being reported. Thresholds are per period, smaller changes over several
+     * periods are not reported.
+     * @param[in]   enable      true to enable the change feed.
+     * @param[in]   thresholds  Minimum reported changes.
+     */
+    void SetChangeFeed(bool enable, const ChangeThresholds &thresholds = {})
+    {
+        m_ChangeFeedEnabled = enable;
+        m_ChangeThresholds = thresholds;
+        m_Changes.clear();
+    }
+    /**
+     * @brief Get the changes of the last rating period.
+     *
+     * Players are in index order, in streaming mode in the order of their first game.
+     * @return  Changes, empty when the change feed is disabled.
+     */
+    const std::vector<RatingChange> & GetChanges() const
+    {
+        return m_Changes;
+    }
+    /**
+     * @brief Save player table to a snapshot file.
+     *
+     * The snapshot contains IDs, ratings, rating deviations and rating volatilities
+     * (glicko2 scale) of all players, the default volatility and tau. Values are saved
+     * in double precision for any value_type. Games not yet computed are not saved.
+     * IDs must be trivially copyable or std::string.
+     * @throws glicko::GlickoException when the file cannot be written.
+     * @param[in]   fileName    Name of the snapshot file.
+     */
+    void SaveSnapshot(const std::string &fileName) const
+    {
+        using Codec = snapshot::IdCodec<IDTYPE>;
+        std::ofstream out{fileName, std::ios::binary | std::ios::trunc};
+        if(!out)
+        {
+            GLTHROW("Cannot create file " + fileName + ".");
+        }
+        snapshot::Header header{};
+        std::memcpy(header.magic, snapshot::MAGIC, sizeof(header.magic));
+        header.version = snapshot::VERSION;
+        header.byteOrder = snapshot::BYTE_ORDER_MARK;
+        header.idKind = Codec::KIND;
+        header.idSize = Codec::SIZE;
+        header.playerCount = m_Table.Size() - m_RemovedCount;
+        header.defaultVolatility = m_DefaultVolatility;
+        header.tau = m_Tau;
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        std::vector<value_type> buffer;
+        WriteValues(out, LivePlayers(m_Table.rating, buffer));
+        if(m_Streaming)
+        {
+            // apply pending deviation growth
+            std::vector<double> deviation(m_Table.Size());
+            for(std::size_t i = 0; i < m_Table.Size(); ++i)
+            {
+                deviation[i] = CurrentDeviation(i);
+            }
+            std::vector<double> deviationBuffer;
+            WriteValues(out, LivePlayers(deviation, deviationBuffer));
+        }
+        else
+        {
+            WriteValues(out, LivePlayers(m_Table.deviation, buffer));
+        }
+        WriteValues(out, LivePlayers(m_Table.volatility, buffer));
+        std::vector<IDTYPE> idBuffer;
+        header.idBytes = Codec::Write(out, LivePlayers(m_PlayerIDs, idBuffer));
+        // header again, now with the size of the ID section
+        out.seekp(0);
+        out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+        if(!out.flush())
+        {
+            GLTHROW("Cannot write file " + fileName + ".");
+        }
+    }
+    /**
+     * @brief Load player table from a snapshot file.
+     *
+     * Replaces all players, the default volatility and tau. Games not yet computed
+     * are deleted. The file is mapped into memory and the value arrays are copied
+     * in bulk. This is not a zero-copy load: the IDs are decoded and the index is
+     * rebuilt, so loading costs O(players). On error the current state is kept.
+     * @throws glicko::GlickoException when the file cannot be read or is not a valid snapshot.
+     * @param[in]   fileName    Name of the snapshot file.
+     */
+    void LoadSnapshot(const std::string &fileName)
+    {
+        using Codec = snapshot::IdCodec<IDTYPE>;
+        snapshot::MappedFile file{fileName};
+        snapshot::Header header;
+        if(file.GetSize() < sizeof(header))
+        {
+            GLTHROW("Invalid snapshot file " + fileName + ".");
+        }
+        std::memcpy(&header, file.GetData(), sizeof(header));
+        if(std::memcmp(header.magic, snapshot::MAGIC, sizeof(header.magic)) != 0 || header.byteOrder != snapshot::BYTE_ORDER_MARK)
+        {
+            GLTHROW("Invalid snapshot file " + fileName + ".");
+        }
+        if(header.version != snapshot::VERSION)
+        {
+            GLTHROW("Unsupported snapshot version in " + fileName + ".");
+        }
+        if(header.idKind != Codec::KIND || header.idSize != Codec::SIZE)
+        {
+            GLTHROW("Snapshot " + fileName + " has a different ID type.");
+        }
+        // sizes from the file, checked without sums that can wrap
+        std::uint64_t count = header.playerCount;
+        std::uint64_t available = file.GetSize() - sizeof(header);
+        if(count > available/sizeof(double)/3 || header.idBytes != available - 3*count*sizeof(double))
+        {
+            GLTHROW("Invalid snapshot file " + fileName + ".");
+        }
+        std::uint64_t valueBytes = count*sizeof(double);
+        const char * values = file.GetData() + sizeof(header);
+        // read IDs and build the index
+        std::vector<IDTYPE> playerIDs;
+        if(!Codec::Read(values + 3*valueBytes, header.idBytes, count, playerIDs))
+        {
+            GLTHROW("Invalid snapshot file " + fileName + ".");
+        }
+        index_type newIndex;
+        newIndex.Reserve(count);
+        for(std::size_t i = 0; i < count; ++i)
+        {
+            if(!index::Insert(newIndex, playerIDs[i], i, playerIDs))
+            {
+                GLTHROW("Duplicate player ID in snapshot " + fileName + ".");
+            }
+        }
+        // copy value arrays
+        PlayerTable table;
+        table.rating.resize(count);
+        table.deviation.resize(count);
+        table.volatility.resize(count);
+        ReadValues(values, table.rating);
+        ReadValues(values + valueBytes, table.deviation);
+        ReadValues(values + 2*valueBytes, table.volatility);
+        table.period.assign(count, 0);
+        table.removed.assign(count, 0);
+        // replace state
+        std::swap(m_Index, newIndex);
+        ++m_IndexVersion;
+        m_PlayerIDs.swap(playerIDs);
+        m_Table = std::move(table);
+        m_DefaultVolatility = header.defaultVolatility;
+        m_Tau = header.tau;
+        m_Period = 0;
+        m_RemovedCount = 0;
+        m_CompactRead = 0;
+        m_CompactWrite = 0;
+        m_Games.clear();
+        m_ConcurrentGames.Clear();
+        m_RankedIDs.clear();
+        m_RankedTeams.clear();
+        m_RankedGames.clear();
+        // the active slots are sized by the next rating period, not at startup
+        m_ActiveSlot.clear();
+        if(m_LeaderboardEnabled)
+        {
+            m_Leaderboard.Clear();
+            UpdateLeaderboard({});
+        }
+    }
+    /**
+     * @brief Set number of threads used by ComputeRatings.
+     *
+     * The results do not depend on the number of threads.
+     * @param[in]   threadCount     Number of threads, 0 for one thread per hardware core.
+     */
+    void SetThreadCount(unsigned threadCount)
+    {
+        m_ThreadPool.SetThreadCount(threadCount);
+    }
+    /**
+     * @brief Get number of threads used by ComputeRatings.
+     *
+     * @return  Number of threads.
+     */
+    unsigned GetThreadCount() const
+    {
+        return m_ThreadPool.GetThreadCount();
+    }
+    /**
+     * @brief Set kernel used by ComputeRatings.
+     *
+     * The vector kernels differ from Kernel::Scalar (the default) in the last bits.
+     * Kernels not supported by the CPU fall back to Kernel::Scalar. The vector kernels
+     * are double precision only, with a float value_type Kernel::Scalar is always used
+     * by ComputeRatings. Predict uses the vector kernels with any value_type.
+     * @param[in]   kernel  The kernel.
+     */
+    void SetKernel(Kernel kernel)
+    {
+        m_Kernel = kernel;
+        m_KernelFunction = kernel::Select<value_type>(kernel);
+        m_PredictionFunction = kernel::SelectPrediction(kernel);
+    }
+    /**
+     * @brief Get kernel used by ComputeRatings.
+     *
+     * @return  The kernel as set by SetKernel.
+     */
+    Kernel GetKernel() const
+    {
+        return m_Kernel;
+    }
+protected:
+private:
+    /**
+     * @brief Player of a preview; mu, phi and sigma in glicko2 scale as used by the computation.
+     */
+    struct PreviewPlayer
+    {
+        IDTYPE          id;     ///< ID of the player.
+        std::size_t     index;  ///< Player index.
+        Rating          before; ///< Values as reported before the games (glicko scale).
+        value_type      mu;     ///< Rating.
+        value_type      phi;    ///< Rating deviation.
+        value_type      sigma;  ///< Rating volatility.
+    };
+    static constexpr std::size_t NO_PLAYER = index::NOT_FOUND;              ///< Index for unknown players.
+    static constexpr double INVERSE_SCALE = 1/TRAITS::GLICO_CONSTANT;       ///< Conversion from glicko to glicko2 ratings.
+    static constexpr double INITIAL_PHI = TRAITS::INITIAL_DEVIATION/TRAITS::GLICO_CONSTANT; ///< Initial rating deviation (glicko2 scale).
+    index_type                      m_Index;                    ///< Index of each player in the player table.
+    std::vector<IDTYPE>             m_PlayerIDs;                ///< ID of each player in the player table.
+    PlayerTable                     m_Table;                    ///< The players.
+    std::size_t                     m_RemovedCount{0};          ///< Number of removed slots in m_Table.
+    std::size_t                     m_CompactRead{0};           ///< Next slot to look at by Compact.
+    std::size_t                     m_CompactWrite{0};          ///< Next slot to fill by Compact.
+    std::vector<Game>               m_Games;                    ///< The games played.
+    ShardedBuffer<Game>             m_ConcurrentGames;          ///< Games added by AddGameConcurrent.
+    std::vector<std::size_t>        m_ActivePlayers;            ///< Players with games in the current rating period.
+    std::vector<std::size_t>        m_ActiveSlot;               ///< Slot of each player in m_ActivePlayers, NO_PLAYER if idle.
+    std::vector<std::size_t>        m_GameOffsets;              ///< Start of each active player's games in m_GameOpponents/m_GameScores.
+    std::vector<std::size_t>        m_GameOpponents;            ///< Opponent column for each game of each player: player index, or player count plus composite opponent.
+    std::vector<value_type>         m_GameScores;               ///< Score for each game of each player.
+    std::vector<std::size_t>        m_GamePlayers;              ///< Resolved player indices of each game (two per game).
+    std::vector<IDTYPE>             m_RankedIDs;                ///< Player IDs of the teams of ranked games.
+    std::vector<RankedTeam>         m_RankedTeams;              ///< Teams of ranked games.
+    std::vector<RankedGame>         m_RankedGames;              ///< Team and free-for-all games.
+    std::vector<std::size_t>        m_RankedPlayers;            ///< Resolved player indices of m_RankedIDs.
+    std::vector<std::size_t>        m_TeamColumns;              ///< Opponent column of each team, NO_PLAYER if the game is skipped.
+    std::vector<std::size_t>        m_CompositeTeams;           ///< Team of each composite opponent.
+    std::vector<value_type>         m_CompositeMu;              ///< Rating of each composite opponent (glicko2 scale).
+    std::vector<value_type>         m_CompositePhi;             ///< Rating deviation of each composite opponent (glicko2 scale).
+    std::vector<value_type>         m_LogSumV;                  ///< Kernel sum g^2*E*(1-E) of each active player for games read in chunks.
+    std::vector<value_type>         m_LogSumDelta;              ///< Kernel sum g*(s-E) of each active player for games read in chunks.
+    std::vector<value_type>         m_NewRating;                ///< New rating of each active player.
+    std::vector<value_type>         m_NewDeviation;             ///< New rating deviation of each active player.
+    std::vector<value_type>         m_NewVolatility;            ///< New rating volatility of each active player.
+    double                          m_DefaultVolatility{0};     ///< Default rating volatility when creating a new player.
+    double                          m_Tau{0};                   ///< Tau system constant.
+    std::uint32_t                   m_Period{0};                ///< Number of computed rating periods.
+    bool                            m_Streaming{false};         ///< Streaming mode.
+    std::uint64_t                   m_IndexVersion{0};          ///< Incremented on each change of m_Index.
+    std::uint64_t                   m_PublishedIndexVersion{0}; ///< Index version of m_PublishedIndex.
+    std::shared_ptr<const index_type> m_PublishedIndex;         ///< Copy of m_Index used by published tables.
+    std::shared_ptr<const std::vector<IDTYPE>> m_PublishedIDs;  ///< Copy of m_PlayerIDs used by published tables, if the index reads it.
+    std::shared_ptr<const RatingTable> m_Published;             ///< Last published rating table.
+    bool                            m_AutoPublish{false};       ///< Publish after each rating period.
+    ThreadPool                      m_ThreadPool;               ///< Threads used by ComputeRatings.
+    std::vector<WorkerData>         m_WorkerData;               ///< Data of each thread.
+    Kernel                          m_Kernel{Kernel::Scalar};   ///< Kernel used by ComputeRatings.
+    kernel::BasicFunction<value_type> m_KernelFunction{kernel::Select<value_type>(Kernel::Scalar)};  ///< Function of m_Kernel.
+    kernel::PredictionFunction      m_PredictionFunction{kernel::SelectPrediction(Kernel::Scalar)};  ///< Prediction function of m_Kernel.
+    SolverSettings                  m_SolverSettings;           ///< Settings of the volatility solver.
+    SolverStatistics                m_SolverStatistics;         ///< Statistics of the volatility solver in the last rating period.
+    Leaderboard                     m_Leaderboard;              ///< Players ordered by rating.
+    bool                            m_LeaderboardEnabled{false};///< Update m_Leaderboard after each rating period.
+    PeriodStatistics                m_PeriodStatistics;         ///< Statistics of the last rating period (TRAITS::STATISTICS only).
+    bool                            m_ChangeFeedEnabled{false}; ///< Collect m_Changes in each rating period.
+    ChangeThresholds                m_ChangeThresholds;         ///< Minimum changes reported in m_Changes.
+    std::vector<RatingChange>       m_Changes;                  ///< Changes of the last rating period.
+    std::vector<double>             m_DeviationBefore;          ///< Deviation of each active player before the rating period (streaming mode, change feed only).
+    /**
+     * @brief Insert a new player.
+     *
+     * @throws glicko::GlickoException when player with this ID already exists.
+     * @param[in]   playerID    ID of the player.
+     * @param[in]   rating      Rating (glicko2 scale).
+     * @param[in]   deviation   Rating deviation (glicko2 scale).
+     * @param[in]   volatility  Rating volatility.
+     */
+    void InsertPlayer(const IDTYPE &playerID, double rating, double deviation, double volatility)
+    {
+        // check if player with this ID already exists
+        if(!index::Insert(m_Index, playerID, m_Table.Size(), m_PlayerIDs))
+        {
+            GLTHROW("Player with this ID already exists.");
+        }
+        ++m_IndexVersion;
+        // create player
+        m_PlayerIDs.push_back(playerID);
+        m_Table.Add(rating, deviation, volatility, m_Period);
+    }
+    /**
+     * @brief Find index of a player.
+     *
+     * @throws glicko::GlickoException when player with this ID does not exist.
+     * @param[in]   playerID    ID of the player.
+     * @return                  Index of the player.
+     */
+    std::size_t FindPlayer(const IDTYPE &playerID) const
+    {
+        std::size_t player = index::Find(m_Index, playerID, m_PlayerIDs);
+        // check if player with this ID already exists
+        if(player == NO_PLAYER)
+        {
+            GLTHROW("Player with this ID does not exist.");
+        }
+        return player;
+    }
+    /**
+     * @brief Move a player to the slot of a removed player.
+     *
+     * @param[in]   from    Index of the player.
+     * @param[in]   to      Index of a removed slot, no other players between from and to.
+     */
+    void MovePlayer(std::size_t from, std::size_t to)
+    {
+        m_Table.Move(from, to);
+        // erase before the move, the index may look the ID up at from
+        index::Erase(m_Index, m_PlayerIDs[from], m_PlayerIDs);
+        m_PlayerIDs[to] = std::move(m_PlayerIDs[from]);
+        index::Insert(m_Index, m_PlayerIDs[to], to, m_PlayerIDs);
+        ++m_IndexVersion;
+        if(m_LeaderboardEnabled)
+        {
+            m_Leaderboard.Move(from, to);
+        }
+    }
+    /**
+     * @brief Update the leaderboard, removed players are not ranked.
+     *
+     * @param[in]   changed     Players whose ratings changed.
+     */
+    void UpdateLeaderboard(const std::vector<std::size_t> &changed)
+    {
+        m_Leaderboard.Update(m_Table.rating, changed, [this](std::size_t player)
+        {
+            return !m_Table.removed[player];
+        }, &ToRating);
+    }
+    /**
+     * @brief Convert a rating to glicko scale.
+     *
+     * @param[in]   mu  Rating (glicko2 scale).
+     * @return          Rating (glicko scale).
+     */
+    static double ToRating(value_type mu)
+    {
+        return TRAITS::GLICO_CONSTANT * mu + TRAITS::INITIAL_RATING;
+    }
+    /**
+     * @brief Predict one game.
+     *
+     * @throws glicko::GlickoException when a player with this ID does not exist.
+     * @param[in]   playerID1   ID of player 1.
+     * @param[in]   playerID2   ID of player 2.
+     * @param[out]  expected    Expected score of player 1.
+     * @param[out]  quality     Match quality.
+     */
+    void PredictPair(const IDTYPE &playerID1, const IDTYPE &playerID2, double &expected, double &quality) const
+    {
+        std::size_t player1 = FindPlayer(playerID1);
+        std::size_t player2 = FindPlayer(playerID2);
+        double mu2 = m_Table.rating[player2];
+        double phi2 = CurrentDeviation(player2);
+        kernel::PredictScalar(m_Table.rating[player1], CurrentDeviation(player1), &mu2, &phi2, 1, &expected, &quality);
+    }
+    /**
+     * @brief Check that the leaderboard is enabled.
+     *
+     * @throws glicko::GlickoException when the leaderboard is disabled.
+     */
+    void CheckLeaderboard() const
+    {
+        if(!m_LeaderboardEnabled)
+        {
+            GLTHROW("Leaderboard is disabled.");
+        }
+    }
+    /**
+     * @brief Find leaderboard position of a player.
+     *
+     * @throws glicko::GlickoException when the leaderboard is disabled or the player does not exist or is not ranked.
+     * @param[in]   playerID    ID of the player.
+     * @return                  Position, 0 for the best player.
+     */
+    std::size_t FindRankPosition(const IDTYPE &playerID) const
+    {
+        CheckLeaderboard();
+        std::size_t position = m_Leaderboard.GetPosition(FindPlayer(playerID));
+        if(position == Leaderboard::NO_RANK)
+        {
+            GLTHROW("Player is not ranked yet.");
+        }
+        return position;
+    }
+    /**
+     * @brief Get leaderboard entries of a range of positions.
+     *
+     * @param[in]   begin   First position.
+     * @param[in]   end     One past the last position.
+     * @return              Entries, best first.
+     */
+    std::vector<LeaderboardEntry> GetLeaderboardEntries(std::size_t begin, std::size_t end) const
+    {
+        std::vector<LeaderboardEntry> entries;
+        entries.reserve(end - begin);
+        for(std::size_t position = begin; position < end; ++position)
+        {
+            std::size_t player = m_Leaderboard.GetPlayer(position);
+            entries.push_back({m_PlayerIDs[player], position + 1,
+                               {ToRating(m_Table.rating[player]), TRAITS::GLICO_CONSTANT * CurrentDeviation(player), m_Table.volatility[player]}});
+        }
+        return entries;
+    }
+    /**
+     * @brief Resolve games to player indices and group them by active player.
+     *
+     * Every player with at least one game gets a slot in m_ActivePlayers. Games of
+     * each player keep the order in which they were added. Games with unknown players
+     * are skipped. Cost depends on the number of games only, buffers keep their
+     * capacity between rating periods.
+     * @return  Maximum number of games of one player.
+     */
+    std::size_t BuildGameIndex()
+    {
+        if(m_ActiveSlot.size() < m_Table.Size())
+        {
+            m_ActiveSlot.resize(m_Table.Size(), NO_PLAYER);
+        }
+        // resolve player IDs once per game and count games of each active player
+        m_GamePlayers.resize(2*m_Games.size());
+        m_GameOffsets.assign(1, 0);
+        for(std::size_t i = 0; i < m_Games.size(); ++i)
+        {
+            std::size_t player1 = index::Find(m_Index, m_Games[i].GetPlayer1ID(), m_PlayerIDs);
+            std::size_t player2 = index::Find(m_Index, m_Games[i].GetPlayer2ID(), m_PlayerIDs);
+            if(player1 == NO_PLAYER || player2 == NO_PLAYER)
+            {
+                // games of unknown players are skipped
+                player1 = NO_PLAYER;
+                player2 = NO_PLAYER;
+                if constexpr(TRAITS::STATISTICS)
+                {
+                    ++m_PeriodStatistics.unmatchedGames;
+                }
+            }
+            else
+            {
+                ++m_GameOffsets[ActivateSlot(player1) + 1];
+                if(player2 != player1)
+                {
+                    ++m_GameOffsets[ActivateSlot(player2) + 1];
+                }
+            }
+            m_GamePlayers[2*i] = player1;
+            m_GamePlayers[2*i + 1] = player2;
+        }
+        CountRankedGames();
+        std::size_t activeCount = m_ActivePlayers.size();
+        std::size_t maxGameCount = 0;
+        for(std::size_t i = 0; i < activeCount; ++i)
+        {
+            maxGameCount = std::max(maxGameCount, m_GameOffsets[i + 1]);
+            m_GameOffsets[i + 1] += m_GameOffsets[i];
+        }
+        // fill opponents and scores, using the offsets as insert positions
+        m_GameOpponents.resize(m_GameOffsets[activeCount]);
+        m_GameScores.resize(m_GameOffsets[activeCount]);
+        for(std::size_t i = 0; i < m_Games.size(); ++i)
+        {
+            std::size_t player1 = m_GamePlayers[2*i];
+            std::size_t player2 = m_GamePlayers[2*i + 1];
+            if(player1 == NO_PLAYER)
+            {
+                continue;
+            }
+            GameResult result = m_Games[i].GetResult();
+            // we are the first player
+            std::size_t pos = m_GameOffsets[m_ActiveSlot[player1]]++;
+            m_GameOpponents[pos] = player2;
+            m_GameScores[pos] = (result == GameResult::Player1) ? 1 : ((result == GameResult::Draw) ? 0.5 : 0);
+            if(player2 != player1)
+            {
+                // we are the second player
+                pos = m_GameOffsets[m_ActiveSlot[player2]]++;
+                m_GameOpponents[pos] = player1;
+                m_GameScores[pos] = (result == GameResult::Player2) ? 1 : ((result == GameResult::Draw) ? 0.5 : 0);
+            }
+        }
+        FillRankedGames();
+        // insert positions are now the end of each player's games, shift them back
+        for(std::size_t i = activeCount; i > 0; --i)
+        {
+            m_GameOffsets[i] = m_GameOffsets[i - 1];
+        }
+        m_GameOffsets[0] = 0;
+        return maxGameCount;
+    }
+    /**
+     * @brief Add a team to the last ranked game.
+     *
+     * @param[in]   first   First player ID.
+     * @param[in]   last    One past the last player ID.
+     * @param[in]   rank    Rank of the team.
+     */
+    template <typename ITERATOR> void AddRankedTeam(ITERATOR first, ITERATOR last, unsigned rank)
+    {
+        std::size_t begin = m_RankedIDs.size();
+        m_RankedIDs.insert(m_RankedIDs.end(), first, last);
+        m_RankedTeams.push_back({begin, m_RankedIDs.size(), rank});
+    }
+    /**
+     * @brief Resolve the players of ranked games and count their games.
+     *
+     * A team of one player is the player's own column, larger teams get a
+     * composite opponent. Each player has one game against each other team.
+     */
+    void CountRankedGames()
+    {
+        m_RankedPlayers.resize(m_RankedIDs.size());
+        m_TeamColumns.resize(m_RankedTeams.size());
+        m_CompositeTeams.clear();
+        for(const auto & game : m_RankedGames)
+        {
+            bool known = true;
+            for(std::size_t i = m_RankedTeams[game.begin].begin; i < m_RankedTeams[game.end - 1].end; ++i)
+            {
+                m_RankedPlayers[i] = index::Find(m_Index, m_RankedIDs[i], m_PlayerIDs);
+                known = known && (m_RankedPlayers[i] != NO_PLAYER);
+            }
+            if(!known)
+            {
+                // games of unknown players are skipped
+                m_TeamColumns[game.begin] = NO_PLAYER;
+                if constexpr(TRAITS::STATISTICS)
+                {
+                    ++m_PeriodStatistics.unmatchedGames;
+                }
+                continue;
+            }
+            std::size_t opponentCount = game.end - game.begin - 1;
+            for(std::size_t t = game.begin; t < game.end; ++t)
+            {
+                const RankedTeam & team = m_RankedTeams[t];
+                if(team.end - team.begin == 1)
+                {
+                    m_TeamColumns[t] = m_RankedPlayers[team.begin];
+                }
+                else
+                {
+                    m_TeamColumns[t] = m_Table.Size() + m_CompositeTeams.size();
+                    m_CompositeTeams.push_back(t);
+                }
+                for(std::size_t i = team.begin; i < team.end; ++i)
+                {
+                    m_GameOffsets[ActivateSlot(m_RankedPlayers[i]) + 1] += opponentCount;
+                }
+            }
+        }
+    }
+    /**
+     * @brief Fill opponents and scores of ranked games.
+     *
+     * m_GameOffsets are the insert positions of the active players.
+     */
+    void FillRankedGames()
+    {
+        for(const auto & game : m_RankedGames)
+        {
+            if(m_TeamColumns[game.begin] == NO_PLAYER)
+            {
+                continue;
+            }
+            for(std::size_t t = game.begin; t < game.end; ++t)
+            {
+                const RankedTeam & team = m_RankedTeams[t];
+                for(std::size_t i = team.begin; i < team.end; ++i)
+                {
+                    std::size_t slot = m_ActiveSlot[m_RankedPlayers[i]];
+                    for(std::size_t u = game.begin; u < game.end; ++u)
+                    {
+                        if(u == t)
+                        {
+                            continue;
+                        }
+                        unsigned rank = m_RankedTeams[u].rank;
+                        std::size_t pos = m_GameOffsets[slot]++;
+                        m_GameOpponents[pos] = m_TeamColumns[u];
+                        m_GameScores[pos] = (team.rank < rank) ? 1 : ((team.rank == rank) ? 0.5 : 0);
+                    }
+                }
+            }
+        }
+    }
+    /**
+     * @brief Compute rating and rating deviation of the composite opponents.
+     *
+     * Mean rating and root mean square rating deviation of the team's players,
+     * after their deviations have been brought up to date.
+     */
+    void ComputeComposites()
+    {
+        m_CompositeMu.resize(m_CompositeTeams.size());
+        m_CompositePhi.resize(m_CompositeTeams.size());
+        for(std::size_t c = 0; c < m_CompositeTeams.size(); ++c)
+        {
+            const RankedTeam & team = m_RankedTeams[m_CompositeTeams[c]];
+            double sumMu = 0;
+            double sumPhiSquare = 0;
+            for(std::size_t i = team.begin; i < team.end; ++i)
+            {
+                std::size_t player = m_RankedPlayers[i];
+                double phi = m_Table.deviation[player];
+                sumMu += m_Table.rating[player];
+                sumPhiSquare += phi*phi;
+            }
+            double count = static_cast<double>(team.end - team.begin);
+            m_CompositeMu[c] = static_cast<value_type>(sumMu/count);
+            m_CompositePhi[c] = static_cast<value_type>(sqrt(sumPhiSquare/count));
+        }
+    }
+    /**
+     * @brief Get slot of an active player, assigning a new one on the first game.
+     *
+     * @param[in]   player  Player index.
+     * @return              Slot of the player in m_ActivePlayers.
+     */
+    std::size_t ActivateSlot(std::size_t player)
+    {
+        if(m_ActiveSlot[player] == NO_PLAYER)
+        {
+            m_ActiveSlot[player] = m_ActivePlayers.size();
+            m_ActivePlayers.push_back(player);
+            m_GameOffsets.push_back(0);
+        }
+        return m_ActiveSlot[player];
+    }
+    /**
+     * @brief Deactivate all active players.
+     */
+    void ClearActivePlayers()
+    {
+        for(std::size_t player : m_ActivePlayers)
+        {
+            m_ActiveSlot[player] = NO_PLAYER;
+        }
+        m_ActivePlayers.clear();
+    }
+    /**
+     * @brief Get current rating deviation of a player.
+     *
+     * In streaming mode the deviation growth of missed rating periods is added.
+     * @param[in]   player  Player index.
+     * @return              Rating deviation (glicko2 scale).
+     */
+    double CurrentDeviation(std::size_t player) const
+    {
+        double phi = m_Table.deviation[player];
+        if(m_Streaming && m_Table.period[player] != m_Period)
+        {
+            double sigma = m_Table.volatility[player];
+            phi = sqrt(phi*phi + (m_Period - m_Table.period[player])*sigma*sigma);
+        }
+        return phi;
+    }
+    /**
+     * @brief Get rating deviation of a player after rating periods without games.
+     *
+     * @param[in]   player      Player index.
+     * @param[in]   periods     Number of rating periods.
+     * @return                  Rating deviation (glicko2 scale).
+     */
+    value_type IdleDeviation(std::size_t player, double periods) const
+    {
+        double phi = CurrentDeviation(player);
+        double sigma = m_Table.volatility[player];
+        return static_cast<value_type>(sqrt(phi*phi + periods*sigma*sigma));
+    }
+    /**
+     * @brief Adopt the new values of an active player.
+     *
+     * @param[in]   slot    Slot of the player in m_ActivePlayers.
+     */
+    void AdoptNewValues(std::size_t slot)
+    {
+        std::size_t player = m_ActivePlayers[slot];
+        m_Table.rating[player] = m_NewRating[slot];
+        m_Table.deviation[player] = m_NewDeviation[slot];
+        m_Table.volatility[player] = m_NewVolatility[slot];
+    }
+    /**
+     * @brief Adopt the new values of a range of players, idle players get the deviation growth of one rating period.
+     *
+     * @param[in]   begin   First player index.
+     * @param[in]   end     One past the last player index.
+     */
+    void AdoptPlayers(std::size_t begin, std::size_t end)
+    {
+        for(std::size_t i = begin; i < end; ++i)
+        {
+            if(m_ActiveSlot[i] != NO_PLAYER)
+            {
+                AdoptNewValues(m_ActiveSlot[i]);
+            }
+            else
+            {
+                m_Table.deviation[i] = IdleDeviation(i, 1);
+            }
+        }
+    }
+    /**
+     * @brief End a phase of the rating period.
+     *
+     * Adds the time since the start of the phase to the statistics. Does nothing
+     * when statistics are disabled.
+     * @param[in]       phase   The phase.
+     * @param[in,out]   start   Start of the phase, set to the start of the next phase.
+     */
+    void EndPhase(Phase phase, std::chrono::steady_clock::time_point &start)
+    {
+        if constexpr(TRAITS::STATISTICS)
+        {
+            auto now = std::chrono::steady_clock::now();
+            m_PeriodStatistics.seconds[static_cast<std::size_t>(phase)] += std::chrono::duration<double>(now - start).count();
+            start = now;
+        }
+        else
+        {
+            static_cast<void>(phase);
+            static_cast<void>(start);
+        }
+    }
+    /**
+     * @brief Begin a rating period.
+     *
+     * Resets the statistics. Does nothing when statistics are disabled.
+     * @param[out]  phaseStart  Start of the first phase.
+     */
+    void BeginPeriod(std::chrono::steady_clock::time_point &phaseStart)
+    {
+        if constexpr(TRAITS::STATISTICS)
+        {
+            m_PeriodStatistics = {};
+            m_PeriodStatistics.period = m_Period;
+            phaseStart = std::chrono::steady_clock::now();
+        }
+        else
+        {
+            static_cast<void>(phaseStart);
+        }
+    }
+    /**
+     * @brief Compute and adopt new values once the games of the rating period are known.
+     *
+     * The active players and either the game index or the kernel sums of games
+     * read in chunks must be set up.
+     * @param[in]       maxGameCount    Maximum number of games of a player in the game index.
+     * @param[in]       gameCount       Number of games in the rating period, including unmatched ones.
+     * @param[in]       logged          true if the kernel sums of games read in chunks are used.
+     * @param[in,out]   phaseStart      Start of the current phase.
+     */
+    void ComputePeriod(std::size_t maxGameCount, std::size_t gameCount, bool logged,
+                       std::chrono::steady_clock::time_point &phaseStart)
+    {
+        // size opponent buffers once for the player with most games
+        m_WorkerData.resize(m_ThreadPool.GetThreadCount());
+        for(auto & worker : m_WorkerData)
+        {
+            worker.Reserve(maxGameCount);
+            worker.solverStatistics = {};
+            worker.iterations = {};
+        }
+        if(m_Streaming)
+        {
+            // bring active players up to date, their opponents are active too
+            m_DeviationBefore.clear();
+            for(std::size_t player : m_ActivePlayers)
+            {
+                double phi = CurrentDeviation(player);
+                if(m_ChangeFeedEnabled)
+                {
+                    m_DeviationBefore.push_back(phi);
+                }
+                m_Table.deviation[player] = phi;
+                m_Table.period[player] = m_Period;
+            }
+        }
+        if(!logged)
+        {
+            ComputeComposites();
+        }
+        // compute new values of the active players; they only read current values of their opponents
+        std::size_t count = m_ActivePlayers.size();
+        m_NewRating.resize(count);
+        m_NewDeviation.resize(count);
+        m_NewVolatility.resize(count);
+        if(m_ThreadPool.GetThreadCount() > 1)
+        {
+            auto job = [this, logged](unsigned worker, std::size_t begin, std::size_t end)
+            {
+                if(logged)
+                {
+                    ComputeLoggedPlayers(m_WorkerData[worker], begin, end);
+                }
+                else
+                {
+                    ComputePlayers(m_WorkerData[worker], begin, end);
+                }
+            };
+            m_ThreadPool.Run(count, job);
+        }
+        else if(logged)
+        {
+            ComputeLoggedPlayers(m_WorkerData[0], 0, count);
+        }
+        else
+        {
+            ComputePlayers(m_WorkerData[0], 0, count);
+        }
+        m_SolverStatistics = {};
+        for(const auto & worker : m_WorkerData)
+        {
+            m_SolverStatistics += worker.solverStatistics;
+        }
+        EndPhase(Phase::Compute, phaseStart);
+        if(m_ChangeFeedEnabled)
+        {
+            CollectChanges(1);
+        }
+        // adopt new ratings
+        if(m_Streaming)
+        {
+            for(std::size_t slot = 0; slot < count; ++slot)
+            {
+                AdoptNewValues(slot);
+                m_Table.period[m_ActivePlayers[slot]] = m_Period + 1;
+            }
+        }
+        else if(m_ThreadPool.GetThreadCount() > 1)
+        {
+            auto job = [this](unsigned worker, std::size_t begin, std::size_t end)
+            {
+                static_cast<void>(worker);
+                AdoptPlayers(begin, end);
+            };
+            m_ThreadPool.Run(m_Table.Size(), job);
+        }
+        else
+        {
+            AdoptPlayers(0, m_Table.Size());
+        }
+        if(m_LeaderboardEnabled)
+        {
+            // only active players changed their ratings
+            UpdateLeaderboard(m_ActivePlayers);
+        }
+        ++m_Period;
+        EndPhase(Phase::Adopt, phaseStart);
+        if(m_AutoPublish)
+        {
+            PublishRatings();
+            EndPhase(Phase::Publish, phaseStart);
+        }
+        if constexpr(TRAITS::STATISTICS)
+        {
+            m_PeriodStatistics.activePlayers = m_ActivePlayers.size();
+            m_PeriodStatistics.idlePlayers = m_Table.Size() - m_RemovedCount - m_ActivePlayers.size();
+            m_PeriodStatistics.games = gameCount - m_PeriodStatistics.unmatchedGames;
+            m_PeriodStatistics.solver = m_SolverStatistics;
+            for(const auto & worker : m_WorkerData)
+            {
+                for(std::size_t i = 0; i < worker.iterations.size(); ++i)
+                {
+                    m_PeriodStatistics.iterations[i] += worker.iterations[i];
+                }
+            }
+        }
+        ClearActivePlayers();
+    }
+    /**
+     * @brief Collect the changes of the rating period before adopting the new values.
+     *
+     * @param[in]   idlePeriods     Number of rating periods of the deviation growth of idle players.
+     */
+    void CollectChanges(double idlePeriods)
+    {
+        m_Changes.clear();
+        auto collect = [this](std::size_t player, double phi, value_type newMu, value_type newPhi, value_type newSigma)
+        {
+            Rating before{ToRating(m_Table.rating[player]), TRAITS::GLICO_CONSTANT * phi, m_Table.volatility[player]};
+            Rating after{ToRating(newMu), TRAITS::GLICO_CONSTANT * newPhi, newSigma};
+            if(std::abs(after.rating - before.rating) > m_ChangeThresholds.rating
+               || std::abs(after.deviation - before.deviation) > m_ChangeThresholds.deviation
+               || std::abs(after.volatility - before.volatility) > m_ChangeThresholds.volatility)
+            {
+                m_Changes.push_back({m_PlayerIDs[player], before, after});
+            }
+        };
+        if(m_Streaming)
+        {
+            // deviations before the deviation growth was stored in value_type
+            for(std::size_t k = 0; k < m_ActivePlayers.size(); ++k)
+            {
+                collect(m_ActivePlayers[k], m_DeviationBefore[k], m_NewRating[k], m_NewDeviation[k], m_NewVolatility[k]);
+            }
+        }
+        else
+        {
+            for(std::size_t player = 0; player < m_Table.Size(); ++player)
+            {
+                if(m_Table.removed[player])
+                {
+                    continue;
+                }
+                std::size_t slot = (player < m_ActiveSlot.size()) ? m_ActiveSlot[player] : NO_PLAYER;
+                if(slot != NO_PLAYER)
+                {
+                    collect(player, m_Table.deviation[player], m_NewRating[slot], m_NewDeviation[slot], m_NewVolatility[slot]);
+                }
+                else
+                {
+                    collect(player, m_Table.deviation[player], m_Table.rating[player], IdleDeviation(player, idlePeriods),
+                            m_Table.volatility[player]);
+                }
+            }
+        }
+    }
+    /**
+     * @brief Compute new values for a range of active players.
+     *
+     * @param[in]   worker      Data of the calling thread.
+     * @param[in]   begin       First slot in m_ActivePlayers.
+     * @param[in]   end         One past the last slot in m_ActivePlayers.
+     */
+    void ComputePlayers(WorkerData &worker, std::size_t begin, std::size_t end)
+    {
+        VolatilitySolver solver{m_Tau, m_SolverSettings};
+        for(std::size_t slot = begin; slot < end; ++slot)
+        {
+            std::size_t i = m_ActivePlayers[slot];
+            std::size_t gameCount = GatherOpponents(slot, worker);
+            value_type v = 0;
+            value_type delta = 0;
+            if(gameCount > 0)
+            {
+                m_KernelFunction(m_Table.rating[i], worker.mu.data(), worker.phi.data(), worker.s.data(), gameCount, v, delta);
+            }
+            UpdatePlayer(slot, gameCount > 0, v, delta, solver, worker);
+        }
+    }
+    /**
+     * @brief Compute new values for a range of players from the sums of games read in chunks.
+     *
+     * @copydetails ComputePlayers
+     */
+    void ComputeLoggedPlayers(WorkerData &worker, std::size_t begin, std::size_t end)
+    {
+        VolatilitySolver solver{m_Tau, m_SolverSettings};
+        for(std::size_t slot = begin; slot < end; ++slot)
+        {
+            // same as the end of the scalar kernel
+            value_type v = 1/m_LogSumV[slot];
+            value_type delta = v*m_LogSumDelta[slot];
+            UpdatePlayer(slot, true, v, delta, solver, worker);
+        }
+    }
+    /**
+     * @brief Compute new values of an active player.
+     *
+     * @param[in]       slot        Slot of the player in m_ActivePlayers.
+     * @param[in]       played      true if the player has played games in the rating period.
+     * @param[in]       v           Estimated variance of the rating from the games.
+     * @param[in]       delta       Estimated improvement of the rating from the games.
+     * @param[in]       solver      Volatility solver.
+     * @param[in,out]   worker      Data of the thread.
+     */
+    void UpdatePlayer(std::size_t slot, bool played, value_type v, value_type delta, const VolatilitySolver &solver, WorkerData &worker)
+    {
+        std::size_t i = m_ActivePlayers[slot];
+        value_type mu = m_Table.rating[i];
+        double phi = m_Table.deviation[i];
+        double sigma = m_Table.volatility[i];
+        // compute new ratings for player
+        if(played)
+        {
+            std::uint64_t iterations = worker.solverStatistics.iterations;
+            double newMu = 0;
+            double newPhi = 0;
+            double newSigma = 0;
+            SolvePlayer(mu, phi, sigma, v, delta, solver, worker.solverStatistics, newMu, newPhi, newSigma);
+            if constexpr(TRAITS::STATISTICS)
+            {
+                iterations = worker.solverStatistics.iterations - iterations;
+                ++worker.iterations[std::min<std::uint64_t>(iterations, worker.iterations.size() - 1)];
+            }
+            m_NewRating[slot] = newMu;
+            m_NewDeviation[slot] = newPhi;
+            m_NewVolatility[slot] = newSigma;
+        }
+        else
+        {
+            // player has not played any games
+            m_NewRating[slot] = mu;
+            m_NewDeviation[slot] = sqrt(phi*phi + sigma*sigma);
+            m_NewVolatility[slot] = sigma;
+        }
+    }
+    /**
+     * @brief Compute new values of a player who has played games.
+     *
+     * @param[in]       mu          Rating (glicko2 scale).
+     * @param[in]       phi         Rating deviation (glicko2 scale).
+     * @param[in]       sigma       Rating volatility.
+     * @param[in]       v           Estimated variance of the rating from the games.
+     * @param[in]       delta       Estimated improvement of the rating from the games.
+     * @param[in]       solver      Volatility solver.
+     * @param[in,out]   statistics  Statistics of the solver.
+     * @param[out]      newMu       New rating (glicko2 scale).
+     * @param[out]      newPhi      New rating deviation (glicko2 scale).
+     * @param[out]      newSigma    New rating volatility.
+     */
+    static void SolvePlayer(value_type mu, double phi, double sigma, value_type v, value_type delta, const VolatilitySolver &solver,
+                            SolverStatistics &statistics, double &newMu, double &newPhi, double &newSigma)
+    {
+        // the solver works in double precision
+        newSigma = solver.Solve(sigma, phi, v, delta, statistics);
+        double phiStarSquare = phi*phi + newSigma*newSigma;
+        newPhi = 1/sqrt(1/phiStarSquare + 1/v);
+        newMu = mu + newPhi*newPhi*delta/v;
+    }
+    /**
+     * @brief Compute new values of the players of hypothetical games.
+     *
+     * The players and their opponents are gathered in a small overlay, so the rating
+     * table is only read through find.
+     * @tparam      FIND            Function bool(const IDTYPE &, PreviewPlayer &), false for unknown IDs.
+     * @param[in]   games           The hypothetical games.
+     * @param[in]   find            Finds the current values of a player.
+     * @param[in]   tau             Tau system constant.
+     * @param[in]   settings        Settings of the volatility solver.
+     * @param[in]   kernelFunction  Kernel.
+     * @return                      Values of each player before and after the games.
+     */
+    template <typename FIND>
+    static std::vector<RatingChange> ComputePreview(const std::vector<GameRecord> &games, FIND find, double tau,
+                                                    const SolverSettings &settings, kernel::BasicFunction<value_type> kernelFunction)
+    {
+        // resolve both players of each game to a slot of the overlay
+        std::vector<PreviewPlayer> players;
+        std::vector<std::size_t> slots(2*games.size());
+        for(std::size_t i = 0; i < slots.size(); ++i)
+        {
+            const IDTYPE & playerID = (i % 2 == 0) ? games[i/2].player1 : games[i/2].player2;
+            PreviewPlayer player;
+            if(!find(playerID, player))
+            {
+                GLTHROW("Player with this ID does not exist.");
+            }
+            std::size_t slot = 0;
+            while(slot < players.size() && players[slot].index != player.index)
+            {
+                ++slot;
+            }
+            if(slot == players.size())
+            {
+                player.id = playerID;
+                players.push_back(player);
+            }
+            slots[i] = slot;
+        }
+        // opponents in the same order as BuildGameIndex
+        std::vector<value_type> mu;
+        std::vector<value_type> phi;
+        std::vector<value_type> s;
+        VolatilitySolver solver{tau, settings};
+        SolverStatistics statistics;
+        std::vector<RatingChange> changes;
+        changes.reserve(players.size());
+        for(std::size_t slot = 0; slot < players.size(); ++slot)
+        {
+            mu.clear();
+            phi.clear();
+            s.clear();
+            for(std::size_t i = 0; i < games.size(); ++i)
+            {
+                GameResult result = games[i].result;
+                if(slots[2*i] == slot)
+                {
+                    mu.push_back(players[slots[2*i + 1]].mu);
+                    phi.push_back(players[slots[2*i + 1]].phi);
+                    s.push_back((result == GameResult::Player1) ? 1 : ((result == GameResult::Draw) ? 0.5 : 0));
+                }
+                else if(slots[2*i + 1] == slot)
+                {
+                    mu.push_back(players[slots[2*i]].mu);
+                    phi.push_back(players[slots[2*i]].phi);
+                    s.push_back((result == GameResult::Player2) ? 1 : ((result == GameResult::Draw) ? 0.5 : 0));
+                }
+            }
+            const PreviewPlayer & player = players[slot];
+            value_type v = 0;
+            value_type delta = 0;
+            kernelFunction(player.mu, mu.data(), phi.data(), s.data(), mu.size(), v, delta);
+            double newMu = 0;
+            double newPhi = 0;
+            double newSigma = 0;
+            SolvePlayer(player.mu, player.phi, player.sigma, v, delta, solver, statistics, newMu, newPhi, newSigma);
+            changes.push_back({player.id, player.before,
+                               {ToRating(static_cast<value_type>(newMu)), TRAITS::GLICO_CONSTANT * static_cast<value_type>(newPhi),
+                                static_cast<value_type>(newSigma)}});
+        }
+        return changes;
+    }
+    /**
+     * @brief Add a game read in chunks to the kernel sums of a player.
+     *
+     * @param[in]   player      Player index.
+     * @param[in]   opponent    Index of the opponent.
+     * @param[in]   score       Score of the player.
+     */
+    void AccumulateGame(std::size_t player, std::size_t opponent, value_type score)
+    {
+        std::size_t slot = ActivateSlot(player);
+        if(slot == m_LogSumV.size())
+        {
+            m_LogSumV.push_back(0);
+            m_LogSumDelta.push_back(0);
+        }
+        // the opponent's deviation as brought up to date in streaming mode
+        kernel::AccumulateScalar<value_type>(m_Table.rating[player], m_Table.rating[opponent],
+                                             static_cast<value_type>(CurrentDeviation(opponent)), score,
+                                             m_LogSumV[slot], m_LogSumDelta[slot]);
+    }
+    /**
+     * @brief Write values to a snapshot in double precision.
+     *
+     * @param[in]   out     Output stream.
+     * @param[in]   values  Values to write.
+     */
+    template <typename VALUE>
+    static void WriteValues(std::ostream &out, const std::vector<VALUE> &values)
+    {
+        if constexpr(std::is_same<VALUE, double>::value)
+        {
+            out.write(reinterpret_cast<const char *>(values.data()), values.size()*sizeof(double));
+        }
+        else
+        {
+            std::vector<double> converted(values.begin(), values.end());
+            out.write(reinterpret_cast<const char *>(converted.data()), converted.size()*sizeof(double));
+        }
+    }
+    /**
+     * @brief Get values of the players without removed ones.
+     *
+     * @param[in]   values  Values of all slots of the player table.
+     * @param[out]  buffer  Buffer for the values if players have been removed.
+     * @return              values or buffer.
+     */
+    template <typename VALUE>
+    const std::vector<VALUE> & LivePlayers(const std::vector<VALUE> &values, std::vector<VALUE> &buffer) const
+    {
+        if(m_RemovedCount == 0)
+        {
+            return values;
+        }
+        buffer.clear();
+        buffer.reserve(values.size() - m_RemovedCount);
+        for(std::size_t i = 0; i < values.size(); ++i)
+        {
+            if(!m_Table.removed[i])
+            {
+                buffer.push_back(values[i]);
+            }
+        }
+        return buffer;
+    }
+    /**
+     * @brief Read double precision values from a snapshot.
+     *
+     * @param[in]   data    Values in the snapshot, need not be aligned.
+     * @param[out]  values  Values, already sized.
+     */
+    static void ReadValues(const char *data, std::vector<value_type> &values)
+    {
+        if constexpr(std::is_same<value_type, double>::value)
+        {
+            std::memcpy(values.data(), data, values.size()*sizeof(double));
+        }
+        else
+        {
+            for(std::size_t i = 0; i < values.size(); ++i)
+            {
+                double value;
+                std::memcpy(&value, data + i*sizeof(double), sizeof(double));
+                values[i] = static_cast<value_type>(value);
+            }
+        }
+    }
+    /**
+     * @brief Gather opponents of a player into contiguous arrays.
+     *
+     * @param[in]   slot        Slot of the player in m_ActivePlayers.
+     * @param[out]  opponents   Buffer to fill.
+     * @return                  Number of games played by the player.
+     */
+    std::size_t GatherOpponents(std::size_t slot, WorkerData &opponents) const
+    {
+        std::size_t begin = m_GameOffsets[slot];
+        std::size_t count = m_GameOffsets[slot + 1] - begin;
+        for(std::size_t i = 0; i < count; ++i)
+        {
+            std::size_t opponent = m_GameOpponents[begin + i];
+            if(opponent < m_Table.Size())
+            {
+                opponents.mu[i] = m_Table.rating[opponent];
+                opponents.phi[i] = m_Table.deviation[opponent];
+            }
+            else
+            {
+                opponents.mu[i] = m_CompositeMu[opponent - m_Table.Size()];
+                opponents.phi[i] = m_CompositePhi[opponent - m_Table.Size()];
+            }
+            opponents.s[i] = m_GameScores[begin + i];
+        }
+        return count;
     }
 };
 
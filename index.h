@@ -0,0 +1,1044 @@
+/******************************************************************************//**
+ * @file
+ * @brief Index backends mapping player IDs to player indices
+ *
+ * @copyright Copyright (C) by Doru Julian Bugariu
+ * julian@bugariu.eu
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the
+ * Free Software Foundation
+ * 51 Franklin Street, Fifth Floor
+ * Boston, MA 02110-1301, USA
+ * http://www.fsf.org/about/contact.html
+ *********************************************************************************/
+
+#ifndef GLICKO_INDEX_H
+#define GLICKO_INDEX_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "exception.h"
+
+namespace glicko
+{
+
+/**
+ * @brief Index backends mapping player IDs to player indices.
+ *
+ * All backends have the same interface:
+ * - Find(id): index of the player, NOT_FOUND if unknown
+ * - Insert(id, value): false if the ID is already in the index
+ * - Erase(id), Reserve(count), Size(), Clear()
+ *
+ * SlotIndex also gets the vector of player IDs in Find, Insert and Erase; the
+ * functions Find, Insert and Erase of this namespace call any backend.
+ * Select a backend with the index_type of the traits of Glicko.
+ */
+namespace index
+{
+
+constexpr std::size_t NOT_FOUND = static_cast<std::size_t>(-1);    ///< Result of Find for unknown IDs.
+
+/**
+ * @brief Mix the bits of a hash value.
+ *
+ * Finalizer of splitmix64. std::hash of integers is the identity on common
+ * standard libraries, this spreads such hashes over all bits.
+ * @param[in]   hash    Hash value.
+ * @return              Mixed hash value.
+ */
+inline std::uint64_t Mix(std::uint64_t hash)
+{
+    hash ^= hash >> 30;
+    hash *= 0xbf58476d1ce4e5b9ull;
+    hash ^= hash >> 27;
+    hash *= 0x94d049bb133111ebull;
+    hash ^= hash >> 31;
+    return hash;
+}
+
+
+/**
+ * @brief Index in an ordered map.
+ *
+ * O(log n) comparisons per lookup. Works for every IDTYPE with operator<.
+ */
+template <typename IDTYPE>
+class OrderedIndex
+{
+public:
+    /**
+     * @brief Find a player.
+     *
+     * @param[in]   id  ID of the player.
+     * @return          Index of the player, NOT_FOUND if the ID is unknown.
+     */
+    std::size_t Find(const IDTYPE &id) const
+    {
+        auto it = m_Map.find(id);
+        return (it != m_Map.end()) ? it->second : NOT_FOUND;
+    }
+    /**
+     * @brief Insert a player.
+     *
+     * Inserting IDs in ascending order costs amortized O(1).
+     * @param[in]   id      ID of the player.
+     * @param[in]   value   Index of the player.
+     * @return              false if the ID is already in the index.
+     */
+    bool Insert(const IDTYPE &id, std::size_t value)
+    {
+        std::size_t size = m_Map.size();
+        m_Map.emplace_hint(m_Map.end(), id, value);
+        return m_Map.size() != size;
+    }
+    /**
+     * @brief Remove a player.
+     *
+     * @param[in]   id  ID of the player.
+     */
+    void Erase(const IDTYPE &id)
+    {
+        m_Map.erase(id);
+    }
+    /**
+     * @brief Reserve memory for players.
+     *
+     * @param[in]   count   Number of players.
+     */
+    void Reserve(std::size_t count)
+    {
+        static_cast<void>(count);
+    }
+    /**
+     * @brief Get number of players.
+     *
+     * @return  Number of players.
+     */
+    std::size_t Size() const
+    {
+        return m_Map.size();
+    }
+    /**
+     * @brief Remove all players.
+     */
+    void Clear()
+    {
+        m_Map.clear();
+    }
+private:
+    std::map<IDTYPE, std::size_t>   m_Map;  ///< Index of each player.
+};
+
+
+/**
+ * @brief Index in an open-addressing hash table.
+ *
+ * Linear probing with a load factor of at most 1/2, so a lookup usually
+ * touches one cache line. Erasing shifts the following entries back, no
+ * tombstones are left. Works for every IDTYPE with HASH and operator==.
+ */
+template <typename IDTYPE, typename HASH = std::hash<IDTYPE>>
+class HashIndex
+{
+public:
+    /**
+     * @copydoc OrderedIndex::Find
+     */
+    std::size_t Find(const IDTYPE &id) const
+    {
+        if(m_Size == 0)
+        {
+            return NOT_FOUND;
+        }
+        std::size_t mask = m_Slots.size() - 1;
+        for(std::size_t pos = Home(id); ; pos = (pos + 1) & mask)
+        {
+            const Slot & slot = m_Slots[pos];
+            if(slot.value == NOT_FOUND || slot.id == id)
+            {
+                return slot.value;
+            }
+        }
+    }
+    /**
+     * @brief Insert a player.
+     *
+     * @param[in]   id      ID of the player.
+     * @param[in]   value   Index of the player.
+     * @return              false if the ID is already in the index.
+     */
+    bool Insert(const IDTYPE &id, std::size_t value)
+    {
+        if(2*(m_Size + 1) > m_Slots.size())
+        {
+            Rehash(std::max<std::size_t>(16, 2*m_Slots.size()));
+        }
+        std::size_t mask = m_Slots.size() - 1;
+        std::size_t pos = Home(id);
+        for(; m_Slots[pos].value != NOT_FOUND; pos = (pos + 1) & mask)
+        {
+            if(m_Slots[pos].id == id)
+            {
+                return false;
+            }
+        }
+        m_Slots[pos].id = id;
+        m_Slots[pos].value = value;
+        ++m_Size;
+        return true;
+    }
+    /**
+     * @copydoc OrderedIndex::Erase
+     */
+    void Erase(const IDTYPE &id)
+    {
+        if(m_Size == 0)
+        {
+            return;
+        }
+        std::size_t mask = m_Slots.size() - 1;
+        std::size_t pos = Home(id);
+        for(; m_Slots[pos].value != NOT_FOUND; pos = (pos + 1) & mask)
+        {
+            if(m_Slots[pos].id == id)
+            {
+                break;
+            }
+        }
+        if(m_Slots[pos].value == NOT_FOUND)
+        {
+            return;
+        }
+        // shift back following entries which may not stay behind the hole
+        for(std::size_t next = (pos + 1) & mask; m_Slots[next].value != NOT_FOUND; next = (next + 1) & mask)
+        {
+            std::size_t home = Home(m_Slots[next].id);
+            if(((next - home) & mask) >= ((next - pos) & mask))
+            {
+                m_Slots[pos] = std::move(m_Slots[next]);
+                pos = next;
+            }
+        }
+        m_Slots[pos] = Slot{};
+        --m_Size;
+    }
+    /**
+     * @copydoc OrderedIndex::Reserve
+     */
+    void Reserve(std::size_t count)
+    {
+        std::size_t capacity = 16;
+        while(capacity < 2*count)
+        {
+            capacity *= 2;
+        }
+        if(capacity > m_Slots.size())
+        {
+            Rehash(capacity);
+        }
+    }
+    /**
+     * @copydoc OrderedIndex::Size
+     */
+    std::size_t Size() const
+    {
+        return m_Size;
+    }
+    /**
+     * @copydoc OrderedIndex::Clear
+     */
+    void Clear()
+    {
+        m_Slots.clear();
+        m_Size = 0;
+    }
+    /**
+     * @brief Call a function for each player.
+     *
+     * @param[in]   function    Called with ID and index of each player.
+     */
+    template <typename FUNCTION>
+    void ForEach(FUNCTION function) const
+    {
+        for(const Slot & slot : m_Slots)
+        {
+            if(slot.value != NOT_FOUND)
+            {
+                function(slot.id, slot.value);
+            }
+        }
+    }
+private:
+    /**
+     * @brief Slot of the hash table.
+     */
+    struct Slot
+    {
+        IDTYPE          id{};               ///< ID of the player.
+        std::size_t     value{NOT_FOUND};   ///< Index of the player, NOT_FOUND if the slot is empty.
+    };
+    std::vector<Slot>   m_Slots;    ///< The hash table, size is a power of 2.
+    std::size_t         m_Size{0};  ///< Number of players.
+    HASH                m_Hash;     ///< Hash function.
+    /**
+     * @brief Get home slot of an ID.
+     *
+     * @param[in]   id  ID of the player.
+     * @return          Slot where probing starts.
+     */
+    std::size_t Home(const IDTYPE &id) const
+    {
+        return static_cast<std::size_t>(Mix(m_Hash(id))) & (m_Slots.size() - 1);
+    }
+    /**
+     * @brief Move all players into a table of another size.
+     *
+     * @param[in]   capacity    New number of slots, a power of 2.
+     */
+    void Rehash(std::size_t capacity)
+    {
+        std::vector<Slot> slots(capacity);
+        slots.swap(m_Slots);
+        std::size_t mask = capacity - 1;
+        for(Slot & slot : slots)
+        {
+            if(slot.value != NOT_FOUND)
+            {
+                std::size_t pos = Home(slot.id);
+                while(m_Slots[pos].value != NOT_FOUND)
+                {
+                    pos = (pos + 1) & mask;
+                }
+                m_Slots[pos] = std::move(slot);
+            }
+        }
+    }
+};
+
+
+/**
+ * @brief Index in a hash table of player indices, the IDs stay in the engine.
+ *
+ * A slot holds the index of the player and 32 bits of the hash of its ID, 8
+ * bytes instead of an ID and an index. The ID is only read from the vector of
+ * player IDs of the engine when the hash bits match, so the IDs are not stored
+ * twice. Linear probing with a load factor of at most 3/4; erasing shifts the
+ * following entries back like HashIndex. At most 2^31 players.
+ * Unlike the other backends, Find, Insert and Erase get the ID of each player
+ * index; use the functions Find, Insert and Erase of this namespace to call any
+ * backend. Works for every IDTYPE with HASH and operator==.
+ */
+template <typename IDTYPE, typename HASH = std::hash<IDTYPE>>
+class SlotIndex
+{
+public:
+    /**
+     * @brief Find a player.
+     *
+     * @param[in]   id      ID of the player.
+     * @param[in]   ids     ID of each player index.
+     * @return              Index of the player, NOT_FOUND if the ID is unknown.
+     */
+    std::size_t Find(const IDTYPE &id, const std::vector<IDTYPE> &ids) const
+    {
+        if(m_Size == 0)
+        {
+            return NOT_FOUND;
+        }
+        std::size_t pos = Probe(id, ids);
+        return (m_Slots[pos].value != EMPTY) ? m_Slots[pos].value : NOT_FOUND;
+    }
+    /**
+     * @brief Insert a player.
+     *
+     * ids[value] may be added after the call, but before the next call.
+     * @throws glicko::GlickoException when value does not fit into 31 bits.
+     * @param[in]   id      ID of the player.
+     * @param[in]   value   Index of the player.
+     * @param[in]   ids     ID of each player index.
+     * @return              false if the ID is already in the index.
+     */
+    bool Insert(const IDTYPE &id, std::size_t value, const std::vector<IDTYPE> &ids)
+    {
+        if(value >= MAX_SIZE)
+        {
+            GLTHROW("Too many players for SlotIndex.");
+        }
+        if(4*(m_Size + 1) > 3*m_Slots.size())
+        {
+            Rehash(std::max<std::size_t>(16, 2*m_Slots.size()));
+        }
+        std::size_t pos = Probe(id, ids);
+        if(m_Slots[pos].value != EMPTY)
+        {
+            return false;
+        }
+        m_Slots[pos].value = static_cast<std::uint32_t>(value);
+        m_Slots[pos].hash = Hash(id);
+        ++m_Size;
+        return true;
+    }
+    /**
+     * @brief Remove a player.
+     *
+     * @param[in]   id      ID of the player.
+     * @param[in]   ids     ID of each player index.
+     */
+    void Erase(const IDTYPE &id, const std::vector<IDTYPE> &ids)
+    {
+        if(m_Size == 0)
+        {
+            return;
+        }
+        std::size_t mask = m_Slots.size() - 1;
+        std::size_t pos = Probe(id, ids);
+        if(m_Slots[pos].value == EMPTY)
+        {
+            return;
+        }
+        // shift back following entries which may not stay behind the hole
+        for(std::size_t next = (pos + 1) & mask; m_Slots[next].value != EMPTY; next = (next + 1) & mask)
+        {
+            std::size_t home = m_Slots[next].hash & mask;
+            if(((next - home) & mask) >= ((next - pos) & mask))
+            {
+                m_Slots[pos] = m_Slots[next];
+                pos = next;
+            }
+        }
+        m_Slots[pos] = Slot{};
+        --m_Size;
+    }
+    /**
+     * @copydoc OrderedIndex::Reserve
+     */
+    void Reserve(std::size_t count)
+    {
+        std::size_t capacity = 16;
+        while(3*capacity < 4*count)
+        {
+            capacity *= 2;
+        }
+        if(capacity > m_Slots.size())
+        {
+            Rehash(capacity);
+        }
+    }
+    /**
+     * @copydoc OrderedIndex::Size
+     */
+    std::size_t Size() const
+    {
+        return m_Size;
+    }
+    /**
+     * @copydoc OrderedIndex::Clear
+     */
+    void Clear()
+    {
+        m_Slots.clear();
+        m_Size = 0;
+    }
+private:
+    static constexpr std::uint32_t EMPTY = static_cast<std::uint32_t>(-1);  ///< Value of an empty slot.
+    static constexpr std::size_t MAX_SIZE = std::size_t{1} << 31;           ///< Limit of the player indices, 2^32 slots at most.
+    /**
+     * @brief Slot of the hash table.
+     */
+    struct Slot
+    {
+        std::uint32_t   value{EMPTY};   ///< Index of the player, EMPTY if the slot is empty.
+        std::uint32_t   hash{0};        ///< Low 32 bits of the mixed hash of the ID, the home slot is taken from them.
+    };
+    std::vector<Slot>   m_Slots;    ///< The hash table, size is a power of 2.
+    std::size_t         m_Size{0};  ///< Number of players.
+    HASH                m_Hash;     ///< Hash function.
+    /**
+     * @brief Get hash bits of an ID.
+     *
+     * @param[in]   id  ID of the player.
+     * @return          Low 32 bits of the mixed hash.
+     */
+    std::uint32_t Hash(const IDTYPE &id) const
+    {
+        return static_cast<std::uint32_t>(Mix(m_Hash(id)));
+    }
+    /**
+     * @brief Find the slot of an ID.
+     *
+     * @param[in]   id      ID of the player.
+     * @param[in]   ids     ID of each player index.
+     * @return              Slot of the ID, or the empty slot where it would be inserted.
+     */
+    std::size_t Probe(const IDTYPE &id, const std::vector<IDTYPE> &ids) const
+    {
+        std::uint32_t hash = Hash(id);
+        std::size_t mask = m_Slots.size() - 1;
+        for(std::size_t pos = hash & mask; ; pos = (pos + 1) & mask)
+        {
+            const Slot & slot = m_Slots[pos];
+            if(slot.value == EMPTY || (slot.hash == hash && ids[slot.value] == id))
+            {
+                return pos;
+            }
+        }
+    }
+    /**
+     * @brief Move all players into a table of another size.
+     *
+     * Only the hash bits are needed, the IDs are not read.
+     * @param[in]   capacity    New number of slots, a power of 2.
+     */
+    void Rehash(std::size_t capacity)
+    {
+        std::vector<Slot> slots(capacity);
+        slots.swap(m_Slots);
+        std::size_t mask = capacity - 1;
+        for(const Slot & slot : slots)
+        {
+            if(slot.value != EMPTY)
+            {
+                std::size_t pos = slot.hash & mask;
+                while(m_Slots[pos].value != EMPTY)
+                {
+                    pos = (pos + 1) & mask;
+                }
+                m_Slots[pos] = slot;
+            }
+        }
+    }
+};
+
+
+/**
+ * @brief Index in a vector indexed by the ID, for dense non-negative integer IDs.
+ *
+ * A lookup is one array access. Memory is proportional to the largest ID.
+ */
+template <typename IDTYPE>
+class DenseIndex
+{
+    static_assert(std::is_integral<IDTYPE>::value, "DenseIndex needs an integer IDTYPE.");
+public:
+    /**
+     * @copydoc OrderedIndex::Find
+     */
+    std::size_t Find(const IDTYPE &id) const
+    {
+        auto key = static_cast<std::make_unsigned_t<IDTYPE>>(id);
+        return (!IsNegative(id) && key < m_Values.size()) ? m_Values[key] : NOT_FOUND;
+    }
+    /**
+     * @brief Insert a player.
+     *
+     * @throws glicko::GlickoException when the ID is negative.
+     * @param[in]   id      ID of the player.
+     * @param[in]   value   Index of the player.
+     * @return              false if the ID is already in the index.
+     */
+    bool Insert(const IDTYPE &id, std::size_t value)
+    {
+        if(IsNegative(id))
+        {
+            GLTHROW("Negative player IDs are not supported by DenseIndex.");
+        }
+        auto key = static_cast<std::make_unsigned_t<IDTYPE>>(id);
+        if(key >= m_Values.size())
+        {
+            m_Values.resize(std::max<std::size_t>(static_cast<std::size_t>(key) + 1, 2*m_Values.size()), NOT_FOUND);
+        }
+        if(m_Values[key] != NOT_FOUND)
+        {
+            return false;
+        }
+        m_Values[key] = value;
+        ++m_Size;
+        return true;
+    }
+    /**
+     * @copydoc OrderedIndex::Erase
+     */
+    void Erase(const IDTYPE &id)
+    {
+        auto key = static_cast<std::make_unsigned_t<IDTYPE>>(id);
+        if(!IsNegative(id) && key < m_Values.size() && m_Values[key] != NOT_FOUND)
+        {
+            m_Values[key] = NOT_FOUND;
+            --m_Size;
+        }
+    }
+    /**
+     * @brief Reserve memory for players.
+     *
+     * Assumes the IDs are about 0 to count-1.
+     * @param[in]   count   Number of players.
+     */
+    void Reserve(std::size_t count)
+    {
+        m_Values.reserve(count);
+    }
+    /**
+     * @copydoc OrderedIndex::Size
+     */
+    std::size_t Size() const
+    {
+        return m_Size;
+    }
+    /**
+     * @copydoc OrderedIndex::Clear
+     */
+    void Clear()
+    {
+        m_Values.clear();
+        m_Size = 0;
+    }
+private:
+    std::vector<std::size_t>    m_Values;   ///< Index of each player by ID, NOT_FOUND if unknown.
+    std::size_t                 m_Size{0};  ///< Number of players.
+    /**
+     * @brief Check for a negative ID.
+     *
+     * @param[in]   id  ID of the player.
+     * @return          true if the ID is negative.
+     */
+    static bool IsNegative(const IDTYPE &id)
+    {
+        if constexpr(std::is_signed<IDTYPE>::value)
+        {
+            return id < 0;
+        }
+        else
+        {
+            static_cast<void>(id);
+            return false;
+        }
+    }
+};
+
+
+/**
+ * @brief Index which can be frozen into a perfect hash table.
+ *
+ * Until Freeze is called, and for players inserted afterwards, this is a
+ * HashIndex. Freeze builds a table without collisions (hash and displace):
+ * the IDs are hashed into buckets of about 4, and each bucket gets a pilot
+ * value which places all of its IDs in free slots. A lookup then is one pilot
+ * load and one slot compare; the table uses about 1.15 slots per player.
+ */
+template <typename IDTYPE, typename HASH = std::hash<IDTYPE>>
+class PerfectHashIndex
+{
+public:
+    /**
+     * @copydoc OrderedIndex::Find
+     */
+    std::size_t Find(const IDTYPE &id) const
+    {
+        if(!m_Slots.empty())
+        {
+            // an ID with a slot is never in the overflow table
+            const Slot & slot = m_Slots[Position(Hash(id))];
+            if(slot.id == id)
+            {
+                return slot.value;
+            }
+        }
+        return m_Overflow.Find(id);
+    }
+    /**
+     * @copydoc HashIndex::Insert
+     */
+    bool Insert(const IDTYPE &id, std::size_t value)
+    {
+        if(!m_Slots.empty())
+        {
+            Slot & slot = m_Slots[Position(Hash(id))];
+            if(slot.id == id)
+            {
+                if(slot.value != NOT_FOUND)
+                {
+                    return false;
+                }
+                // free slot, or slot of an erased player with this ID
+                slot.value = value;
+                ++m_FrozenSize;
+                return true;
+            }
+        }
+        return m_Overflow.Insert(id, value);
+    }
+    /**
+     * @copydoc OrderedIndex::Erase
+     */
+    void Erase(const IDTYPE &id)
+    {
+        if(!m_Slots.empty())
+        {
+            Slot & slot = m_Slots[Position(Hash(id))];
+            if(slot.id == id)
+            {
+                if(slot.value != NOT_FOUND)
+                {
+                    slot.value = NOT_FOUND;
+                    --m_FrozenSize;
+                }
+                return;
+            }
+        }
+        m_Overflow.Erase(id);
+    }
+    /**
+     * @copydoc OrderedIndex::Reserve
+     */
+    void Reserve(std::size_t count)
+    {
+        m_Overflow.Reserve(count > m_FrozenSize ? count - m_FrozenSize : 0);
+    }
+    /**
+     * @copydoc OrderedIndex::Size
+     */
+    std::size_t Size() const
+    {
+        return m_FrozenSize + m_Overflow.Size();
+    }
+    /**
+     * @copydoc OrderedIndex::Clear
+     */
+    void Clear()
+    {
+        m_Pilots.clear();
+        m_Slots.clear();
+        m_FrozenSize = 0;
+        m_Overflow.Clear();
+    }
+    /**
+     * @brief Build the perfect hash table of all players.
+     *
+     * If no perfect hash is found (only possible for IDs with equal HASH values),
+     * the players stay in the hash table.
+     * @return  true if the perfect hash table was built.
+     */
+    bool Freeze()
+    {
+        std::vector<IDTYPE> ids;
+        std::vector<std::size_t> values;
+        ids.reserve(Size());
+        values.reserve(Size());
+        for(const Slot & slot : m_Slots)
+        {
+            if(slot.value != NOT_FOUND)
+            {
+                ids.push_back(slot.id);
+                values.push_back(slot.value);
+            }
+        }
+        m_Overflow.ForEach([&](const IDTYPE &id, std::size_t value)
+        {
+            ids.push_back(id);
+            values.push_back(value);
+        });
+        if(ids.empty() || ids.size() > UINT32_MAX/2)
+        {
+            return false;
+        }
+        for(std::uint64_t seed = 1; seed <= MAX_SEEDS; ++seed)
+        {
+            if(Build(ids, values, seed))
+            {
+                m_Overflow.Clear();
+                return true;
+            }
+        }
+        // keep all players in the hash table
+        m_Overflow.Clear();
+        m_Overflow.Reserve(ids.size());
+        for(std::size_t i = 0; i < ids.size(); ++i)
+        {
+            m_Overflow.Insert(ids[i], values[i]);
+        }
+        return false;
+    }
+private:
+    static constexpr std::uint64_t MAX_SEEDS = 8;           ///< Number of seeds tried by Freeze.
+    static constexpr std::uint32_t MAX_PILOT = 1u << 20;    ///< Largest pilot tried for one bucket.
+    /**
+     * @brief Slot of the perfect hash table.
+     */
+    struct Slot
+    {
+        IDTYPE          id{};               ///< ID of the player.
+        std::size_t     value{NOT_FOUND};   ///< Index of the player, NOT_FOUND if the slot is empty.
+    };
+    std::vector<std::uint32_t>  m_Pilots;           ///< Pilot of each bucket.
+    std::vector<Slot>           m_Slots;            ///< The perfect hash table.
+    std::size_t                 m_FrozenSize{0};    ///< Number of players in m_Slots.
+    std::uint64_t               m_Seed{0};          ///< Seed of the hash function.
+    HashIndex<IDTYPE, HASH>     m_Overflow;         ///< Players not in m_Slots.
+    HASH                        m_Hash;             ///< Hash function.
+    /**
+     * @brief Hash an ID.
+     *
+     * @param[in]   id  ID of the player.
+     * @return          64 bit hash value.
+     */
+    std::uint64_t Hash(const IDTYPE &id) const
+    {
+        return Mix(static_cast<std::uint64_t>(m_Hash(id)) ^ m_Seed);
+    }
+    /**
+     * @brief Get bucket of a hash value.
+     *
+     * @param[in]   hash    Hash value.
+     * @return              Bucket.
+     */
+    std::size_t Bucket(std::uint64_t hash) const
+    {
+        return static_cast<std::size_t>(((hash >> 32)*m_Pilots.size()) >> 32);
+    }
+    /**
+     * @brief Get slot of a hash value with a pilot.
+     *
+     * @param[in]   hash    Hash value.
+     * @param[in]   pilot   Pilot of the bucket.
+     * @return              Slot.
+     */
+    std::size_t Place(std::uint64_t hash, std::uint32_t pilot) const
+    {
+        std::uint64_t mixed = Mix(hash ^ (pilot*0x9e3779b97f4a7c15ull));
+        return static_cast<std::size_t>(((mixed & 0xffffffffull)*m_Slots.size()) >> 32);
+    }
+    /**
+     * @brief Get slot of a hash value.
+     *
+     * @param[in]   hash    Hash value.
+     * @return              Slot.
+     */
+    std::size_t Position(std::uint64_t hash) const
+    {
+        return Place(hash, m_Pilots[Bucket(hash)]);
+    }
+    /**
+     * @brief Build the perfect hash table with one seed.
+     *
+     * @param[in]   ids     IDs of all players.
+     * @param[in]   values  Index of each player.
+     * @param[in]   seed    Seed of the hash function.
+     * @return              false if a bucket could not be placed.
+     */
+    bool Build(const std::vector<IDTYPE> &ids, const std::vector<std::size_t> &values, std::uint64_t seed)
+    {
+        std::size_t count = ids.size();
+        m_Seed = seed*0x9e3779b97f4a7c15ull;
+        m_Pilots.assign((count + 3)/4, 0);
+        m_Slots.assign(count + count/8 + 1, Slot{});
+        // group IDs by bucket
+        std::vector<std::uint64_t> hashes(count);
+        std::vector<std::size_t> bucketStart(m_Pilots.size() + 1, 0);
+        for(std::size_t i = 0; i < count; ++i)
+        {
+            hashes[i] = Hash(ids[i]);
+            ++bucketStart[Bucket(hashes[i]) + 1];
+        }
+        for(std::size_t b = 0; b < m_Pilots.size(); ++b)
+        {
+            bucketStart[b + 1] += bucketStart[b];
+        }
+        std::vector<std::size_t> members(count);
+        std::vector<std::size_t> fill(bucketStart.begin(), bucketStart.end() - 1);
+        for(std::size_t i = 0; i < count; ++i)
+        {
+            members[fill[Bucket(hashes[i])]++] = i;
+        }
+        // place large buckets first
+        std::vector<std::size_t> buckets(m_Pilots.size());
+        for(std::size_t b = 0; b < buckets.size(); ++b)
+        {
+            buckets[b] = b;
+        }
+        std::stable_sort(buckets.begin(), buckets.end(), [&bucketStart](std::size_t b1, std::size_t b2)
+        {
+            return bucketStart[b1 + 1] - bucketStart[b1] > bucketStart[b2 + 1] - bucketStart[b2];
+        });
+        std::vector<bool> taken(m_Slots.size(), false);
+        std::vector<std::size_t> positions;
+        for(std::size_t b : buckets)
+        {
+            std::size_t begin = bucketStart[b];
+            std::size_t end = bucketStart[b + 1];
+            if(begin == end)
+            {
+                break;
+            }
+            std::uint32_t pilot = 0;
+            for(; pilot < MAX_PILOT; ++pilot)
+            {
+                positions.clear();
+                bool free = true;
+                for(std::size_t k = begin; k < end && free; ++k)
+                {
+                    std::size_t pos = Place(hashes[members[k]], pilot);
+                    free = !taken[pos] && std::find(positions.begin(), positions.end(), pos) == positions.end();
+                    positions.push_back(pos);
+                }
+                if(free)
+                {
+                    break;
+                }
+            }
+            if(pilot == MAX_PILOT)
+            {
+                m_Pilots.clear();
+                m_Slots.clear();
+                m_FrozenSize = 0;
+                return false;
+            }
+            m_Pilots[b] = pilot;
+            for(std::size_t k = begin; k < end; ++k)
+            {
+                std::size_t pos = positions[k - begin];
+                taken[pos] = true;
+                m_Slots[pos].id = ids[members[k]];
+                m_Slots[pos].value = values[members[k]];
+            }
+        }
+        m_FrozenSize = count;
+        return true;
+    }
+};
+
+/**
+ * @brief Check if a backend looks IDs up in the vector of player IDs.
+ *
+ * @tparam  INDEX   The backend.
+ */
+template <typename INDEX>
+struct UsesIDs : std::false_type
+{
+};
+
+
+/**
+ * @brief SlotIndex looks IDs up in the vector of player IDs.
+ */
+template <typename IDTYPE, typename HASH>
+struct UsesIDs<SlotIndex<IDTYPE, HASH>> : std::true_type
+{
+};
+
+
+/**
+ * @brief Find a player in any backend.
+ *
+ * @param[in]   index   The index.
+ * @param[in]   id      ID of the player.
+ * @param[in]   ids     ID of each player index, only read by backends with UsesIDs.
+ * @return              Index of the player, NOT_FOUND if the ID is unknown.
+ */
+template <typename INDEX, typename IDTYPE>
+std::size_t Find(const INDEX &index, const IDTYPE &id, const std::vector<IDTYPE> &ids)
+{
+    if constexpr(UsesIDs<INDEX>::value)
+    {
+        return index.Find(id, ids);
+    }
+    else
+    {
+        static_cast<void>(ids);
+        return index.Find(id);
+    }
+}
+
+
+/**
+ * @brief Insert a player into any backend.
+ *
+ * @param[in]   index   The index.
+ * @param[in]   id      ID of the player.
+ * @param[in]   value   Index of the player.
+ * @param[in]   ids     ID of each player index, only read by backends with UsesIDs.
+ * @return              false if the ID is already in the index.
+ */
+template <typename INDEX, typename IDTYPE>
+bool Insert(INDEX &index, const IDTYPE &id, std::size_t value, const std::vector<IDTYPE> &ids)
+{
+    if constexpr(UsesIDs<INDEX>::value)
+    {
+        return index.Insert(id, value, ids);
+    }
+    else
+    {
+        static_cast<void>(ids);
+        return index.Insert(id, value);
+    }
+}
+
+
+/**
+ * @brief Remove a player from any backend.
+ *
+ * @param[in]   index   The index.
+ * @param[in]   id      ID of the player.
+ * @param[in]   ids     ID of each player index, only read by backends with UsesIDs.
+ */
+template <typename INDEX, typename IDTYPE>
+void Erase(INDEX &index, const IDTYPE &id, const std::vector<IDTYPE> &ids)
+{
+    if constexpr(UsesIDs<INDEX>::value)
+    {
+        index.Erase(id, ids);
+    }
+    else
+    {
+        static_cast<void>(ids);
+        index.Erase(id);
+    }
+}
+
+
+/**
+ * @brief Default backend: SlotIndex if std::hash supports the IDTYPE, OrderedIndex otherwise.
+ */
+template <typename IDTYPE, typename = void>
+struct Default
+{
+    using type = OrderedIndex<IDTYPE>;  ///< The backend.
+};
+
+
+/**
+ * @brief Default backend for IDs with std::hash.
+ */
+template <typename IDTYPE>
+struct Default<IDTYPE, std::void_t<decltype(std::hash<IDTYPE>{}(std::declval<const IDTYPE &>()))>>
+{
+    using type = SlotIndex<IDTYPE>;     ///< The backend.
+};
+
+
+template <typename IDTYPE> using DefaultIndex = typename Default<IDTYPE>::type;  ///< Default backend of the traits.
+
+
+} // namespace index
+
+} // namespace glicko
+
+#endif // GLICKO_INDEX_H
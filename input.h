@@ -0,0 +1,261 @@
+/******************************************************************************//**
+ * @file
+ * @brief Zero-copy parsing of player and game files
+ *
+ * @copyright Copyright (C) by Doru Julian Bugariu
+ * julian@bugariu.eu
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the
+ * Free Software Foundation
+ * 51 Franklin Street, Fifth Floor
+ * Boston, MA 02110-1301, USA
+ * http://www.fsf.org/about/contact.html
+ *********************************************************************************/
+
+
+#ifndef GLICKO_INPUT_H
+#define GLICKO_INPUT_H
+
+#include <charconv>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include "exception.h"
+#include "glicko.h"
+#include "index.h"
+
+namespace glicko
+{
+
+namespace input
+{
+
+/**
+ * @brief Scanner of comma separated lines.
+ *
+ * Empty lines and lines starting with '#' are skipped, blanks around fields are
+ * removed and quoting is not supported. Lines and fields are views into the data.
+ */
+class CsvReader
+{
+public:
+    /**
+     * @brief Constructor.
+     *
+     * @param[in]   data        Contents of the file.
+     * @param[in]   fileName    Name of the file, used in messages.
+     */
+    CsvReader(std::string_view data, const std::string &fileName):
+        m_FileName{fileName},
+        m_Data{data}
+    {
+    }
+    /**
+     * @brief Advance to the next line.
+     *
+     * @return  false at the end of the data.
+     */
+    bool NextLine()
+    {
+        while(m_Position < m_Data.size())
+        {
+            std::size_t end = m_Data.find('\n', m_Position);
+            if(end == std::string_view::npos)
+            {
+                end = m_Data.size();
+            }
+            std::string_view line = Trim(m_Data.substr(m_Position, end - m_Position));
+            m_Position = end + 1;
+            ++m_LineNumber;
+            if(!line.empty() && line[0] != '#')
+            {
+                m_Line = line;
+                m_MoreFields = true;
+                return true;
+            }
+        }
+        return false;
+    }
+    /**
+     * @brief Get the next field of the current line.
+     *
+     * @param[out]  field   The field.
+     * @return              false if the line has no more fields.
+     */
+    bool NextField(std::string_view &field)
+    {
+        if(!m_MoreFields)
+        {
+            return false;
+        }
+        std::size_t end = m_Line.find(',');
+        if(end == std::string_view::npos)
+        {
+            field = Trim(m_Line);
+            m_MoreFields = false;
+        }
+        else
+        {
+            field = Trim(m_Line.substr(0, end));
+            m_Line.remove_prefix(end + 1);
+        }
+        return true;
+    }
+    /**
+     * @brief Get number of the current line.
+     *
+     * @return  Line number, starting with 1.
+     */
+    std::size_t GetLineNumber() const
+    {
+        return m_LineNumber;
+    }
+    /**
+     * @brief Throw an error in the current line.
+     *
+     * @throws glicko::GlickoException always, with file name and line number in the message.
+     * @param[in]   message     The error.
+     */
+    [[noreturn]] void Fail(const std::string &message) const
+    {
+        GLTHROW(m_FileName + ":" + std::to_string(m_LineNumber) + ": " + message);
+    }
+private:
+    /**
+     * @brief Remove blanks and carriage returns around text.
+     *
+     * @param[in]   text    The text.
+     * @return              The text without surrounding blanks.
+     */
+    static std::string_view Trim(std::string_view text)
+    {
+        while(!text.empty() && (text.front() == ' ' || text.front() == '\t'))
+        {
+            text.remove_prefix(1);
+        }
+        while(!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r'))
+        {
+            text.remove_suffix(1);
+        }
+        return text;
+    }
+    std::string         m_FileName;             ///< Name of the file.
+    std::string_view    m_Data;                 ///< Contents of the file.
+    std::size_t         m_Position{0};          ///< Start of the next line.
+    std::size_t         m_LineNumber{0};        ///< Number of the current line.
+    std::string_view    m_Line;                 ///< Unread fields of the current line.
+    bool                m_MoreFields{false};    ///< m_Line has fields left.
+};
+
+
+/**
+ * @brief Parse a number.
+ *
+ * @param[in]   text    The text, without blanks.
+ * @param[out]  value   The number.
+ * @return              false if the text is no number.
+ */
+inline bool ParseNumber(std::string_view text, double &value)
+{
+    const char * end = text.data() + text.size();
+    auto parsed = std::from_chars(text.data(), end, value);
+    return parsed.ec == std::errc{} && parsed.ptr == end && !text.empty();
+}
+
+
+/**
+ * @brief Parse a game result.
+ *
+ * Accepts the score of player 1 (1, 0.5, 0) and the notation 1-0, 1/2-1/2, 0-1.
+ * @param[in]   text    The text, without blanks.
+ * @param[out]  result  The result.
+ * @return              false if the text is no result.
+ */
+inline bool ParseResult(std::string_view text, GameResult &result)
+{
+    if(text == "1" || text == "1-0")
+    {
+        result = GameResult::Player1;
+    }
+    else if(text == "0" || text == "0-1")
+    {
+        result = GameResult::Player2;
+    }
+    else if(text == "0.5" || text == "1/2" || text == "1/2-1/2")
+    {
+        result = GameResult::Draw;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+
+/**
+ * @brief Map of player names to dense IDs 0, 1, 2, ...
+ *
+ * Only views are stored, the names must outlive the interner.
+ */
+class Interner
+{
+public:
+    /**
+     * @brief Get the ID of a name, add the name if it is new.
+     *
+     * @throws glicko::GlickoException when there are more names than IDs.
+     * @param[in]   name    The name.
+     * @param[out]  added   true if the name was new.
+     * @return              The ID.
+     */
+    std::uint32_t Intern(std::string_view name, bool &added)
+    {
+        std::size_t id = m_Index.Find(name);
+        added = (id == index::NOT_FOUND);
+        if(added)
+        {
+            if(m_Names.size() == std::numeric_limits<std::uint32_t>::max())
+            {
+                GLTHROW("Too many player names.");
+            }
+            id = m_Names.size();
+            m_Index.Insert(name, id);
+            m_Names.push_back(name);
+        }
+        return static_cast<std::uint32_t>(id);
+    }
+    /**
+     * @brief Get all names.
+     *
+     * @return  The name of each ID.
+     */
+    const std::vector<std::string_view> & GetNames() const
+    {
+        return m_Names;
+    }
+private:
+    index::HashIndex<std::string_view>  m_Index;    ///< ID of each name.
+    std::vector<std::string_view>       m_Names;    ///< Name of each ID.
+};
+
+} // namespace input
+
+} // namespace glicko
+
+#endif // GLICKO_INPUT_H
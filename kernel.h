@@ -0,0 +1,452 @@
+/******************************************************************************//**
+ * @file
+ * @brief Batch kernels for the glicko2 rating update
+ *
+ * @copyright Copyright (C) by Doru Julian Bugariu
+ * julian@bugariu.eu
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the
+ * Free Software Foundation
+ * 51 Franklin Street, Fifth Floor
+ * Boston, MA 02110-1301, USA
+ * http://www.fsf.org/about/contact.html
+ *********************************************************************************/
+
+#ifndef GLICKO_KERNEL_H
+#define GLICKO_KERNEL_H
+
+#include <cmath>
+#include <cstddef>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define GLICKO_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace glicko
+{
+
+/**
+ * @brief Kernel used for the inner loop of a rating period.
+ */
+enum class Kernel
+{
+    Scalar,     ///< Portable scalar code.
+    AVX2,       ///< AVX2/FMA code, 4 games at once.
+    AVX512,     ///< AVX-512 code, 8 games at once.
+    Auto        ///< Best kernel supported by the CPU.
+};
+
+namespace kernel
+{
+
+/**
+ * @brief 3/pi^2, factor of phi^2 in g(phi).
+ */
+template <typename VALUE> constexpr VALUE G_FACTOR = static_cast<VALUE>(3/M_PI/M_PI);
+
+/**
+ * @brief Signature of a kernel computing v and delta for one player.
+ *
+ * @param[in]   mu          Rating of the player (glicko2 scale).
+ * @param[in]   oppMu       Ratings of the opponents (glicko2 scale).
+ * @param[in]   oppPhi      Rating deviations of the opponents (glicko2 scale).
+ * @param[in]   scores      Score of the player in each game.
+ * @param[in]   count       Number of games, must be > 0.
+ * @param[out]  v           Estimated variance of the player's rating.
+ * @param[out]  delta       Estimated improvement in rating.
+ */
+template <typename VALUE>
+using BasicFunction = void (*)(VALUE mu, const VALUE *oppMu, const VALUE *oppPhi, const VALUE *scores,
+                               std::size_t count, VALUE &v, VALUE &delta);
+
+using Function = BasicFunction<double>;     ///< Kernel in double precision.
+
+/**
+ * @brief Add one game to the sums of the scalar kernel.
+ *
+ * Games added one by one in the same order give the same sums as ComputeScalar.
+ * @param[in]       mu          Rating of the player (glicko2 scale).
+ * @param[in]       oppMu       Rating of the opponent (glicko2 scale).
+ * @param[in]       oppPhi      Rating deviation of the opponent (glicko2 scale).
+ * @param[in]       score       Score of the player.
+ * @param[in,out]   sumV        Sum of g^2*E*(1-E).
+ * @param[in,out]   sumDelta    Sum of g*(s-E).
+ */
+template <typename VALUE>
+inline void AccumulateScalar(VALUE mu, VALUE oppMu, VALUE oppPhi, VALUE score, VALUE &sumV, VALUE &sumDelta)
+{
+    VALUE g = 1/std::sqrt(1 + oppPhi*oppPhi*G_FACTOR<VALUE>);
+    VALUE E = 1/(1 + std::exp(-g*(mu - oppMu)));
+    sumV += g*g*E*(1 - E);
+    sumDelta += g*(score - E);
+}
+
+/**
+ * @brief Scalar kernel.
+ *
+ * @copydetails BasicFunction
+ */
+template <typename VALUE>
+inline void ComputeScalar(VALUE mu, const VALUE *oppMu, const VALUE *oppPhi, const VALUE *scores,
+                          std::size_t count, VALUE &v, VALUE &delta)
+{
+    VALUE sumV = 0;
+    VALUE sumDelta = 0;
+    for(std::size_t i = 0; i < count; ++i)
+    {
+        AccumulateScalar(mu, oppMu[i], oppPhi[i], scores[i], sumV, sumDelta);
+    }
+    v = 1/sumV;
+    delta = v*sumDelta;
+}
+
+/**
+ * @brief Signature of a kernel predicting games of one player against candidates.
+ *
+ * The expected score uses the combined deviation sqrt(phi^2 + oppPhi^2), the match
+ * quality is 4E(1-E), 1 for an even game.
+ * @param[in]   mu          Rating of the player (glicko2 scale).
+ * @param[in]   phi         Rating deviation of the player (glicko2 scale).
+ * @param[in]   oppMu       Ratings of the candidates (glicko2 scale).
+ * @param[in]   oppPhi      Rating deviations of the candidates (glicko2 scale).
+ * @param[in]   count       Number of candidates.
+ * @param[out]  expected    Expected score of the player against each candidate.
+ * @param[out]  quality     Match quality of each pairing.
+ */
+using PredictionFunction = void (*)(double mu, double phi, const double *oppMu, const double *oppPhi,
+                                    std::size_t count, double *expected, double *quality);
+
+/**
+ * @brief Scalar prediction kernel.
+ *
+ * @copydetails PredictionFunction
+ */
+inline void PredictScalar(double mu, double phi, const double *oppMu, const double *oppPhi,
+                          std::size_t count, double *expected, double *quality)
+{
+    for(std::size_t i = 0; i < count; ++i)
+    {
+        double g = 1/sqrt(1 + (phi*phi + oppPhi[i]*oppPhi[i])*G_FACTOR<double>);
+        double E = 1/(1 + exp(-g*(mu - oppMu[i])));
+        expected[i] = E;
+        quality[i] = 4*E*(1 - E);
+    }
+}
+
+#ifdef GLICKO_X86_KERNELS
+
+/**
+ * @brief exp for 4 doubles.
+ *
+ * Range reduction to [-ln2/2, ln2/2] and a degree 13 Taylor polynomial,
+ * relative error of a few ulp. Arguments are clamped to [-708, 708].
+ * @param[in]   x   Arguments.
+ * @return          exp(x).
+ */
+__attribute__((target("avx2,fma"))) inline __m256d Exp4(__m256d x)
+{
+    x = _mm256_max_pd(_mm256_min_pd(x, _mm256_set1_pd(708.0)), _mm256_set1_pd(-708.0));
+    __m256d n = _mm256_round_pd(_mm256_mul_pd(x, _mm256_set1_pd(1.4426950408889634)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m256d r = _mm256_fnmadd_pd(n, _mm256_set1_pd(6.93147180369123816490e-01), x);
+    r = _mm256_fnmadd_pd(n, _mm256_set1_pd(1.90821492927058770002e-10), r);
+    __m256d p = _mm256_set1_pd(1.0/6227020800);
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0/479001600));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0/39916800));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0/3628800));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0/362880));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0/40320));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0/5040));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0/720));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0/120));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0/24));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0/6));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(0.5));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0));
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(1.0));
+    // 2^n: move integer n into the exponent bits
+    const __m256d magic = _mm256_set1_pd(6755399441055744.0);
+    __m256i bits = _mm256_sub_epi64(_mm256_castpd_si256(_mm256_add_pd(n, magic)), _mm256_castpd_si256(magic));
+    bits = _mm256_slli_epi64(_mm256_add_epi64(bits, _mm256_set1_epi64x(1023)), 52);
+    return _mm256_mul_pd(p, _mm256_castsi256_pd(bits));
+}
+
+/**
+ * @brief AVX2 kernel.
+ *
+ * @copydetails BasicFunction
+ */
+__attribute__((target("avx2,fma"))) inline void ComputeAVX2(double mu, const double *oppMu, const double *oppPhi, const double *scores,
+                                                            std::size_t count, double &v, double &delta)
+{
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d threeOverPiSquare = _mm256_set1_pd(G_FACTOR<double>);
+    const __m256d muVec = _mm256_set1_pd(mu);
+    __m256d sumV = _mm256_setzero_pd();
+    __m256d sumDelta = _mm256_setzero_pd();
+    std::size_t i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        __m256d phi = _mm256_loadu_pd(oppPhi + i);
+        __m256d g = _mm256_div_pd(one, _mm256_sqrt_pd(_mm256_fmadd_pd(_mm256_mul_pd(phi, phi), threeOverPiSquare, one)));
+        __m256d x = _mm256_mul_pd(g, _mm256_sub_pd(_mm256_loadu_pd(oppMu + i), muVec));
+        __m256d E = _mm256_div_pd(one, _mm256_add_pd(one, Exp4(x)));
+        sumV = _mm256_fmadd_pd(_mm256_mul_pd(_mm256_mul_pd(g, g), E), _mm256_sub_pd(one, E), sumV);
+        sumDelta = _mm256_fmadd_pd(g, _mm256_sub_pd(_mm256_loadu_pd(scores + i), E), sumDelta);
+    }
+    // horizontal sums
+    __m128d v2 = _mm_add_pd(_mm256_castpd256_pd128(sumV), _mm256_extractf128_pd(sumV, 1));
+    __m128d d2 = _mm_add_pd(_mm256_castpd256_pd128(sumDelta), _mm256_extractf128_pd(sumDelta, 1));
+    double totalV = _mm_cvtsd_f64(_mm_add_sd(v2, _mm_unpackhi_pd(v2, v2)));
+    double totalDelta = _mm_cvtsd_f64(_mm_add_sd(d2, _mm_unpackhi_pd(d2, d2)));
+    // remaining games
+    for(; i < count; ++i)
+    {
+        double phi = oppPhi[i];
+        double g = 1/sqrt(1 + phi*phi*G_FACTOR<double>);
+        double E = 1/(1 + exp(-g*(mu - oppMu[i])));
+        totalV += g*g*E*(1 - E);
+        totalDelta += g*(scores[i] - E);
+    }
+    v = 1/totalV;
+    delta = v*totalDelta;
+}
+
+/**
+ * @brief AVX2 prediction kernel.
+ *
+ * @copydetails PredictionFunction
+ */
+__attribute__((target("avx2,fma"))) inline void PredictAVX2(double mu, double phi, const double *oppMu, const double *oppPhi,
+                                                            std::size_t count, double *expected, double *quality)
+{
+    const __m256d one = _mm256_set1_pd(1.0);
+    const __m256d four = _mm256_set1_pd(4.0);
+    const __m256d threeOverPiSquare = _mm256_set1_pd(G_FACTOR<double>);
+    const __m256d muVec = _mm256_set1_pd(mu);
+    const __m256d phiSquare = _mm256_set1_pd(phi*phi);
+    std::size_t i = 0;
+    for(; i + 4 <= count; i += 4)
+    {
+        __m256d oppPhiVec = _mm256_loadu_pd(oppPhi + i);
+        __m256d combined = _mm256_fmadd_pd(oppPhiVec, oppPhiVec, phiSquare);
+        __m256d g = _mm256_div_pd(one, _mm256_sqrt_pd(_mm256_fmadd_pd(combined, threeOverPiSquare, one)));
+        __m256d x = _mm256_mul_pd(g, _mm256_sub_pd(_mm256_loadu_pd(oppMu + i), muVec));
+        __m256d E = _mm256_div_pd(one, _mm256_add_pd(one, Exp4(x)));
+        _mm256_storeu_pd(expected + i, E);
+        _mm256_storeu_pd(quality + i, _mm256_mul_pd(_mm256_mul_pd(four, E), _mm256_sub_pd(one, E)));
+    }
+    PredictScalar(mu, phi, oppMu + i, oppPhi + i, count - i, expected + i, quality + i);
+}
+
+// GCC 12 warns about _mm512_undefined_pd() used inside its own intrinsics
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+/**
+ * @brief exp for 8 doubles.
+ *
+ * Same method as Exp4.
+ * @param[in]   x   Arguments.
+ * @return          exp(x).
+ */
+__attribute__((target("avx512f"))) inline __m512d Exp8(__m512d x)
+{
+    x = _mm512_max_pd(_mm512_min_pd(x, _mm512_set1_pd(708.0)), _mm512_set1_pd(-708.0));
+    __m512d n = _mm512_roundscale_pd(_mm512_mul_pd(x, _mm512_set1_pd(1.4426950408889634)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+    __m512d r = _mm512_fnmadd_pd(n, _mm512_set1_pd(6.93147180369123816490e-01), x);
+    r = _mm512_fnmadd_pd(n, _mm512_set1_pd(1.90821492927058770002e-10), r);
+    __m512d p = _mm512_set1_pd(1.0/6227020800);
+    p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(1.0/479001600));
+    p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(1.0/39916800));
+    p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(1.0/3628800));
+    p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(1.0/362880));
+    p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(1.0/40320));
+    p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(1.0/5040));
+    p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(1.0/720));
+    p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(1.0/120));
+    p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(1.0/24));
+    p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(1.0/6));
+    p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(0.5));
+    p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(1.0));
+    p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(1.0));
+    return _mm512_scalef_pd(p, n);
+}
+
+/**
+ * @brief AVX-512 kernel.
+ *
+ * @copydetails BasicFunction
+ */
+__attribute__((target("avx512f"))) inline void ComputeAVX512(double mu, const double *oppMu, const double *oppPhi, const double *scores,
+                                                             std::size_t count, double &v, double &delta)
+{
+    const __m512d one = _mm512_set1_pd(1.0);
+    const __m512d threeOverPiSquare = _mm512_set1_pd(G_FACTOR<double>);
+    const __m512d muVec = _mm512_set1_pd(mu);
+    __m512d sumV = _mm512_setzero_pd();
+    __m512d sumDelta = _mm512_setzero_pd();
+    for(std::size_t i = 0; i < count; i += 8)
+    {
+        // masked loads for the last games, unused lanes are not added
+        __mmask8 mask = (count - i >= 8) ? 0xFF : static_cast<__mmask8>((1u << (count - i)) - 1);
+        __m512d phi = _mm512_maskz_loadu_pd(mask, oppPhi + i);
+        __m512d g = _mm512_div_pd(one, _mm512_sqrt_pd(_mm512_fmadd_pd(_mm512_mul_pd(phi, phi), threeOverPiSquare, one)));
+        __m512d x = _mm512_mul_pd(g, _mm512_sub_pd(_mm512_maskz_loadu_pd(mask, oppMu + i), muVec));
+        __m512d E = _mm512_div_pd(one, _mm512_add_pd(one, Exp8(x)));
+        sumV = _mm512_mask3_fmadd_pd(_mm512_mul_pd(_mm512_mul_pd(g, g), E), _mm512_sub_pd(one, E), sumV, mask);
+        sumDelta = _mm512_mask3_fmadd_pd(g, _mm512_sub_pd(_mm512_maskz_loadu_pd(mask, scores + i), E), sumDelta, mask);
+    }
+    v = 1/_mm512_reduce_add_pd(sumV);
+    delta = v*_mm512_reduce_add_pd(sumDelta);
+}
+
+/**
+ * @brief AVX-512 prediction kernel.
+ *
+ * @copydetails PredictionFunction
+ */
+__attribute__((target("avx512f"))) inline void PredictAVX512(double mu, double phi, const double *oppMu, const double *oppPhi,
+                                                             std::size_t count, double *expected, double *quality)
+{
+    const __m512d one = _mm512_set1_pd(1.0);
+    const __m512d four = _mm512_set1_pd(4.0);
+    const __m512d threeOverPiSquare = _mm512_set1_pd(G_FACTOR<double>);
+    const __m512d muVec = _mm512_set1_pd(mu);
+    const __m512d phiSquare = _mm512_set1_pd(phi*phi);
+    for(std::size_t i = 0; i < count; i += 8)
+    {
+        // masked loads and stores for the last candidates
+        __mmask8 mask = (count - i >= 8) ? 0xFF : static_cast<__mmask8>((1u << (count - i)) - 1);
+        __m512d oppPhiVec = _mm512_maskz_loadu_pd(mask, oppPhi + i);
+        __m512d combined = _mm512_fmadd_pd(oppPhiVec, oppPhiVec, phiSquare);
+        __m512d g = _mm512_div_pd(one, _mm512_sqrt_pd(_mm512_fmadd_pd(combined, threeOverPiSquare, one)));
+        __m512d x = _mm512_mul_pd(g, _mm512_sub_pd(_mm512_maskz_loadu_pd(mask, oppMu + i), muVec));
+        __m512d E = _mm512_div_pd(one, _mm512_add_pd(one, Exp8(x)));
+        _mm512_mask_storeu_pd(expected + i, mask, E);
+        _mm512_mask_storeu_pd(quality + i, mask, _mm512_mul_pd(_mm512_mul_pd(four, E), _mm512_sub_pd(one, E)));
+    }
+}
+
+#pragma GCC diagnostic pop
+
+#endif // GLICKO_X86_KERNELS
+
+/**
+ * @brief Check if a kernel is supported by the CPU.
+ *
+ * @param[in]   kernel  The kernel.
+ * @return              true if the kernel can be used.
+ */
+inline bool IsSupported(Kernel kernel)
+{
+    switch(kernel)
+    {
+    case Kernel::Scalar:
+    case Kernel::Auto:
+        return true;
+#ifdef GLICKO_X86_KERNELS
+    case Kernel::AVX2:
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    case Kernel::AVX512:
+        return __builtin_cpu_supports("avx512f");
+#endif
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief Resolve a kernel to a kernel supported by the CPU.
+ *
+ * Kernel::Auto is resolved to the best kernel supported by the CPU.
+ * Unsupported kernels fall back to the scalar kernel.
+ * @param[in]   kernel  The kernel.
+ * @return              The kernel to use.
+ */
+inline Kernel Resolve(Kernel kernel)
+{
+    if(kernel == Kernel::Auto)
+    {
+        kernel = IsSupported(Kernel::AVX512) ? Kernel::AVX512 : (IsSupported(Kernel::AVX2) ? Kernel::AVX2 : Kernel::Scalar);
+    }
+    if(!IsSupported(kernel))
+    {
+        kernel = Kernel::Scalar;
+    }
+    return kernel;
+}
+
+/**
+ * @brief Get kernel function.
+ *
+ * The kernel is resolved with Resolve. The vector kernels exist in double
+ * precision only, other value types always get the scalar kernel.
+ * @param[in]   kernel  The kernel.
+ * @return              The kernel function.
+ */
+template <typename VALUE = double>
+inline BasicFunction<VALUE> Select(Kernel kernel)
+{
+    static_cast<void>(kernel);
+    return &ComputeScalar<VALUE>;
+}
+
+/**
+ * @copydoc Select
+ */
+template <>
+inline Function Select<double>(Kernel kernel)
+{
+    switch(Resolve(kernel))
+    {
+#ifdef GLICKO_X86_KERNELS
+    case Kernel::AVX2:
+        return &ComputeAVX2;
+    case Kernel::AVX512:
+        return &ComputeAVX512;
+#endif
+    default:
+        return &ComputeScalar<double>;
+    }
+}
+
+/**
+ * @brief Get prediction kernel function.
+ *
+ * The kernel is resolved with Resolve.
+ * @param[in]   kernel  The kernel.
+ * @return              The prediction kernel function.
+ */
+inline PredictionFunction SelectPrediction(Kernel kernel)
+{
+    switch(Resolve(kernel))
+    {
+#ifdef GLICKO_X86_KERNELS
+    case Kernel::AVX2:
+        return &PredictAVX2;
+    case Kernel::AVX512:
+        return &PredictAVX512;
+#endif
+    default:
+        return &PredictScalar;
+    }
+}
+
+} // namespace kernel
+
+} // namespace glicko
+
+#endif // GLICKO_KERNEL_H
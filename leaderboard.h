@@ -0,0 +1,225 @@
+/******************************************************************************//**
+ * @file
+ * @brief Rating-ordered index of all players
+ *
+ * @copyright Copyright (C) by Doru Julian Bugariu
+ * julian@bugariu.eu
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the
+ * Free Software Foundation
+ * 51 Franklin Street, Fifth Floor
+ * Boston, MA 02110-1301, USA
+ * http://www.fsf.org/about/contact.html
+ *********************************************************************************/
+
+#ifndef GLICKO_LEADERBOARD_H
+#define GLICKO_LEADERBOARD_H
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace glicko
+{
+
+/**
+ * @brief Players ordered by rating, best first.
+ *
+ * Players are identified by their index in the player table. Players with
+ * equal ratings are ordered by index. After a rating period only the players
+ * whose ratings changed are sorted, then merged with the unchanged order,
+ * which costs O(n + k log k) for k changed players.
+ */
+class Leaderboard
+{
+public:
+    static constexpr std::size_t NO_RANK = static_cast<std::size_t>(-1);   ///< Position of players not ranked.
+    /**
+     * @brief Update the order.
+     *
+     * Players without rank (new players) get ranked, unless excluded by ranked.
+     * @param[in]   ratings     Ratings of all players, indexed by player.
+     * @param[in]   changed     Ranked players whose ratings changed, each at most once.
+     * @param[in]   ranked      Returns false for players not to rank, e.g. removed ones.
+     * @param[in]   convert     Converts a rating to the scale of the rating queries, must not decrease.
+     */
+    template <typename VALUE, typename RANKED, typename CONVERT>
+    void Update(const std::vector<VALUE> &ratings, const std::vector<std::size_t> &changed, RANKED ranked, CONVERT convert)
+    {
+        m_Position.resize(ratings.size(), NO_RANK);
+        // take changed players out of the order, then collect all players without rank
+        for(std::size_t player : changed)
+        {
+            m_Position[player] = NO_RANK;
+        }
+        m_Order.erase(std::remove_if(m_Order.begin(), m_Order.end(), [this](std::size_t player)
+        {
+            return m_Position[player] == NO_RANK;
+        }), m_Order.end());
+        m_Pending.clear();
+        for(std::size_t player = 0; player < ratings.size(); ++player)
+        {
+            if(m_Position[player] == NO_RANK && ranked(player))
+            {
+                m_Pending.push_back(player);
+            }
+        }
+        auto better = [&ratings](std::size_t player1, std::size_t player2)
+        {
+            return ratings[player1] > ratings[player2] || (ratings[player1] == ratings[player2] && player1 < player2);
+        };
+        std::sort(m_Pending.begin(), m_Pending.end(), better);
+        m_Merged.resize(m_Order.size() + m_Pending.size());
+        std::merge(m_Order.begin(), m_Order.end(), m_Pending.begin(), m_Pending.end(), m_Merged.begin(), better);
+        m_Order.swap(m_Merged);
+        // positions and ratings in rank order
+        m_Ratings.resize(m_Order.size());
+        for(std::size_t i = 0; i < m_Order.size(); ++i)
+        {
+            m_Position[m_Order[i]] = i;
+            m_Ratings[i] = convert(ratings[m_Order[i]]);
+        }
+    }
+    /**
+     * @brief Remove a player.
+     *
+     * Costs O(n) for a ranked player, the players below move up.
+     * @param[in]   player  Player index.
+     */
+    void Remove(std::size_t player)
+    {
+        std::size_t position = GetPosition(player);
+        if(position == NO_RANK)
+        {
+            return;
+        }
+        m_Order.erase(m_Order.begin() + position);
+        m_Ratings.erase(m_Ratings.begin() + position);
+        m_Position[player] = NO_RANK;
+        for(std::size_t i = position; i < m_Order.size(); ++i)
+        {
+            m_Position[m_Order[i]] = i;
+        }
+    }
+    /**
+     * @brief Change the index of a player.
+     *
+     * The order of equal ratings stays valid if the player does not pass other
+     * players, i.e. all players between the old and new index are removed.
+     * @param[in]   from    Old player index.
+     * @param[in]   to      New player index, not ranked.
+     */
+    void Move(std::size_t from, std::size_t to)
+    {
+        std::size_t position = GetPosition(from);
+        if(position == NO_RANK)
+        {
+            return;
+        }
+        m_Order[position] = to;
+        m_Position[to] = position;
+        m_Position[from] = NO_RANK;
+    }
+    /**
+     * @brief Remove all players.
+     */
+    void Clear()
+    {
+        m_Order.clear();
+        m_Position.clear();
+        m_Ratings.clear();
+    }
+    /**
+     * @brief Get number of ranked players.
+     *
+     * @return  Number of ranked players.
+     */
+    std::size_t Size() const
+    {
+        return m_Order.size();
+    }
+    /**
+     * @brief Get player at a position.
+     *
+     * @param[in]   position    Position, 0 for the best player.
+     * @return                  Player index.
+     */
+    std::size_t GetPlayer(std::size_t position) const
+    {
+        return m_Order[position];
+    }
+    /**
+     * @brief Get position of a player.
+     *
+     * @param[in]   player  Player index.
+     * @return              Position, 0 for the best player, NO_RANK if not ranked.
+     */
+    std::size_t GetPosition(std::size_t player) const
+    {
+        return (player < m_Position.size()) ? m_Position[player] : NO_RANK;
+    }
+    /**
+     * @brief Get rating at a position.
+     *
+     * @param[in]   position    Position, 0 for the best player.
+     * @return                  Rating (converted scale).
+     */
+    double GetRating(std::size_t position) const
+    {
+        return m_Ratings[position];
+    }
+    /**
+     * @brief Count players with a lower rating.
+     *
+     * @param[in]   rating  Rating (converted scale).
+     * @return              Number of players rated below.
+     */
+    std::size_t CountBelow(double rating) const
+    {
+        return m_Ratings.end() - std::partition_point(m_Ratings.begin(), m_Ratings.end(), [rating](double value)
+        {
+            return value >= rating;
+        });
+    }
+    /**
+     * @brief Get positions of players within a rating window.
+     *
+     * @param[in]   minRating   Lowest rating (converted scale).
+     * @param[in]   maxRating   Highest rating (converted scale).
+     * @return                  First position and one past the last position.
+     */
+    std::pair<std::size_t, std::size_t> GetRange(double minRating, double maxRating) const
+    {
+        auto first = std::partition_point(m_Ratings.begin(), m_Ratings.end(), [maxRating](double value)
+        {
+            return value > maxRating;
+        });
+        auto last = std::partition_point(first, m_Ratings.end(), [minRating](double value)
+        {
+            return value >= minRating;
+        });
+        return {static_cast<std::size_t>(first - m_Ratings.begin()), static_cast<std::size_t>(last - m_Ratings.begin())};
+    }
+private:
+    std::vector<std::size_t>    m_Order;        ///< Players by rank.
+    std::vector<std::size_t>    m_Position;     ///< Position of each player in m_Order.
+    std::vector<double>         m_Ratings;      ///< Rating of each position (converted scale).
+    std::vector<std::size_t>    m_Pending;      ///< Players to insert, kept to reuse memory.
+    std::vector<std::size_t>    m_Merged;       ///< Merge buffer, kept to reuse memory.
+};
+
+} // namespace glicko
+
+#endif // GLICKO_LEADERBOARD_H
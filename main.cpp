@@ -23,49 +23,463 @@
  * http://www.fsf.org/about/contact.html
  *********************************************************************************/
 
+#include "gamelog.h"
 #include "glicko.h"
+#include "input.h"
+
+#include <charconv>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+
+/**
+ * @brief Configuration with a direct-indexed vector index, for the interned player IDs.
+ */
+struct DenseIndexTraits : glicko::DefaultTraits
+{
+    template <typename IDTYPE> using index_type = glicko::index::DenseIndex<IDTYPE>;        ///< Index of the players.
+};
+
+using Engine = glicko::Glicko<std::uint32_t, DenseIndexTraits>;    ///< Engine on interned player IDs.
+using Clock = std::chrono::steady_clock;                            ///< Clock of the timings.
+
+
+/**
+ * @brief Command line options.
+ */
+struct Options
+{
+    std::string                 playerFile;                         ///< Initial players (CSV), empty for none.
+    std::vector<std::string>    gameFiles;                          ///< Game files, CSV or binary game logs.
+    std::string                 outFile;                            ///< Ratings output (CSV), empty for standard output.
+    std::string                 convertFile;                        ///< Binary game log to write instead of computing ratings.
+    std::size_t                 periodGames{0};                     ///< Games per rating period, 0 for one rating period.
+    double                      volatility{0.06};                   ///< Initial rating volatility.
+    double                      tau{0.5};                           ///< Tau system constant.
+    unsigned                    threads{0};                         ///< Threads of ComputeRatings, 0 for all cores.
+    glicko::Kernel              kernel{glicko::Kernel::Scalar};     ///< Kernel of ComputeRatings.
+};
+
+
+Options g_Options;  ///< Command line options.
+
+
+/**
+ * @brief Rates game files in rating periods of a fixed number of games.
+ *
+ * The files are mapped and parsed in place; player names are interned to dense
+ * IDs, so the engine never sees a string.
+ */
+class BatchRunner
+{
+public:
+    /**
+     * @brief Constructor.
+     */
+    BatchRunner():
+        m_Engine{g_Options.volatility, g_Options.tau}
+    {
+        m_Engine.SetThreadCount(g_Options.threads);
+        m_Engine.SetKernel(g_Options.kernel);
+        if(g_Options.periodGames > 0)
+        {
+            m_Games.reserve(g_Options.periodGames);
+        }
+    }
+    /**
+     * @brief Create players from a CSV file.
+     *
+     * Lines are name,rating,deviation,volatility; missing values get the defaults.
+     * A first line without a rating is a header.
+     * @throws glicko::GlickoException when the file cannot be read or is invalid.
+     * @param[in]   fileName    Name of the file.
+     */
+    void LoadPlayers(const std::string &fileName)
+    {
+        glicko::input::CsvReader reader{Map(fileName), fileName};
+        bool first = true;
+        while(reader.NextLine())
+        {
+            std::string_view name;
+            std::string_view field;
+            reader.NextField(name);
+            double values[3] = {glicko::config::INITIAL_RATING, glicko::config::INITIAL_DEVIATION, g_Options.volatility};
+            std::size_t count = 0;
+            bool header = false;
+            while(count < 3 && reader.NextField(field))
+            {
+                if(!field.empty() && !glicko::input::ParseNumber(field, values[count]))
+                {
+                    header = first && count == 0;
+                    if(!header)
+                    {
+                        reader.Fail("Invalid number " + std::string{field} + ".");
+                    }
+                    break;
+                }
+                ++count;
+            }
+            first = false;
+            if(header)
+            {
+                continue;
+            }
+            bool added = false;
+            std::uint32_t id = m_Interner.Intern(name, added);
+            if(!added)
+            {
+                reader.Fail("Player " + std::string{name} + " is listed twice.");
+            }
+            m_Engine.CreatePlayer(id, values[0], values[1], values[2]);
+        }
+    }
+    /**
+     * @brief Rate the games of a file.
+     *
+     * Binary game logs (string IDs) are recognized by their magic, anything else is
+     * CSV with lines player1,player2,result; see input::ParseResult for the results.
+     * A first line without a valid result is a header. New players get the default values.
+     * @throws glicko::GlickoException when the file cannot be read or is invalid.
+     * @param[in]   fileName    Name of the file.
+     */
+    void RateGames(const std::string &fileName)
+    {
+        ParseGames(fileName, [this](std::string_view player1, std::string_view player2, glicko::GameResult result)
+        {
+            m_Games.push_back({GetPlayer(player1), GetPlayer(player2), result});
+            if(m_Games.size() == g_Options.periodGames)
+            {
+                ComputePeriod();
+            }
+        });
+    }
+    /**
+     * @brief Compute the last rating period with the remaining games.
+     */
+    void Finish()
+    {
+        if(!m_Games.empty())
+        {
+            ComputePeriod();
+        }
+    }
+    /**
+     * @brief Convert game files to a binary game log.
+     *
+     * @throws glicko::GlickoException when a file cannot be read, is invalid or cannot be written.
+     * @param[in]   fileName    Name of the game log.
+     */
+    void Convert(const std::string &fileName)
+    {
+        glicko::gamelog::Writer<std::string> writer{fileName};
+        std::string player1;
+        std::string player2;
+        for(const auto & gameFile : g_Options.gameFiles)
+        {
+            ParseGames(gameFile, [&](std::string_view name1, std::string_view name2, glicko::GameResult result)
+            {
+                player1.assign(name1);
+                player2.assign(name2);
+                writer.Write(player1, player2, result);
+            });
+        }
+        writer.Close();
+    }
+    /**
+     * @brief Write all ratings as CSV, readable by LoadPlayers.
+     *
+     * @throws glicko::GlickoException when the file cannot be written.
+     * @param[in]   fileName    Name of the file, empty for standard output.
+     */
+    void WriteRatings(const std::string &fileName) const
+    {
+        std::FILE * out = fileName.empty() ? stdout : std::fopen(fileName.c_str(), "wb");
+        if(out == nullptr)
+        {
+            GLTHROW("Cannot create file " + fileName + ".");
+        }
+        std::string buffer = "player,rating,deviation,volatility\n";
+        const auto & names = m_Interner.GetNames();
+        bool ok = true;
+        for(std::uint32_t id = 0; id < names.size(); ++id)
+        {
+            buffer.append(names[id]);
+            for(double value : {m_Engine.GetRating(id), m_Engine.GetDeviation(id), m_Engine.GetVolatility(id)})
+            {
+                char text[32];
+                text[0] = ',';
+                auto converted = std::to_chars(text + 1, text + sizeof(text), value);
+                buffer.append(text, converted.ptr);
+            }
+            buffer.push_back('\n');
+            if(buffer.size() >= (1 << 20) || id + 1 == names.size())
+            {
+                ok = ok && std::fwrite(buffer.data(), 1, buffer.size(), out) == buffer.size();
+                buffer.clear();
+            }
+        }
+        if(names.empty())
+        {
+            ok = std::fwrite(buffer.data(), 1, buffer.size(), out) == buffer.size();
+        }
+        ok = (std::fflush(out) == 0) && ok;
+        if(out != stdout)
+        {
+            ok = (std::fclose(out) == 0) && ok;
+        }
+        if(!ok)
+        {
+            GLTHROW("Cannot write file " + (fileName.empty() ? std::string{"standard output"} : fileName) + ".");
+        }
+    }
+    /**
+     * @brief Print games, players and throughput to standard error.
+     *
+     * @param[in]   seconds     Time of the whole run.
+     */
+    void PrintSummary(double seconds) const
+    {
+        double parseSeconds = seconds - m_ComputeSeconds;
+        std::fprintf(stderr, "games:   %zu in %zu rating periods, %zu players, %.1f MB\n",
+                     m_GameCount, m_PeriodCount, m_Interner.GetNames().size(), static_cast<double>(m_ByteCount)/1e6);
+        std::fprintf(stderr, "parse:   %.3f s, %.0f games/s, %.1f MB/s\n",
+                     parseSeconds, m_GameCount/parseSeconds, static_cast<double>(m_ByteCount)/1e6/parseSeconds);
+        if(m_PeriodCount > 0)
+        {
+            std::fprintf(stderr, "compute: %.3f s, %.0f games/s\n", m_ComputeSeconds, m_GameCount/m_ComputeSeconds);
+        }
+        std::fprintf(stderr, "total:   %.3f s, %.0f games/s\n", seconds, m_GameCount/seconds);
+    }
+private:
+    /**
+     * @brief Map a file for the rest of the run.
+     *
+     * Interned names point into the mappings, so they are never unmapped.
+     * @param[in]   fileName    Name of the file.
+     * @return                  Contents of the file.
+     */
+    std::string_view Map(const std::string &fileName)
+    {
+        m_Files.push_back(std::make_unique<glicko::snapshot::MappedFile>(fileName));
+        m_ByteCount += m_Files.back()->GetSize();
+        return {m_Files.back()->GetData(), m_Files.back()->GetSize()};
+    }
+    /**
+     * @brief Parse the games of a file.
+     *
+     * @tparam      FUNCTION    Function void(std::string_view, std::string_view, glicko::GameResult).
+     * @param[in]   fileName    Name of the file.
+     * @param[in]   function    Called for each game.
+     */
+    template <typename FUNCTION>
+    void ParseGames(const std::string &fileName, FUNCTION function)
+    {
+        std::string_view data = Map(fileName);
+        std::string_view player1;
+        std::string_view player2;
+        glicko::GameResult result;
+        if(data.size() >= sizeof(glicko::gamelog::MAGIC) && std::memcmp(data.data(), glicko::gamelog::MAGIC, sizeof(glicko::gamelog::MAGIC)) == 0)
+        {
+            glicko::gamelog::View<std::string> view{data, fileName};
+            while(view.Next(player1, player2, result))
+            {
+                function(player1, player2, result);
+                ++m_GameCount;
+            }
+            return;
+        }
+        glicko::input::CsvReader reader{data, fileName};
+        bool first = true;
+        while(reader.NextLine())
+        {
+            std::string_view field;
+            if(!reader.NextField(player1) || !reader.NextField(player2) || !reader.NextField(field))
+            {
+                reader.Fail("Expected player1,player2,result.");
+            }
+            if(!glicko::input::ParseResult(field, result))
+            {
+                if(first)
+                {
+                    first = false;
+                    continue;
+                }
+                reader.Fail("Invalid result " + std::string{field} + ".");
+            }
+            first = false;
+            function(player1, player2, result);
+            ++m_GameCount;
+        }
+    }
+    /**
+     * @brief Get the ID of a player, create the player on first use.
+     *
+     * @param[in]   name    Name of the player.
+     * @return              ID of the player.
+     */
+    std::uint32_t GetPlayer(std::string_view name)
+    {
+        bool added = false;
+        std::uint32_t id = m_Interner.Intern(name, added);
+        if(added)
+        {
+            m_Engine.CreatePlayer(id);
+        }
+        return id;
+    }
+    /**
+     * @brief Compute a rating period with the collected games.
+     */
+    void ComputePeriod()
+    {
+        auto start = Clock::now();
+        m_Engine.AddGames(m_Games.begin(), m_Games.end());
+        m_Engine.ComputeRatings();
+        m_Games.clear();
+        ++m_PeriodCount;
+        m_ComputeSeconds += std::chrono::duration<double>(Clock::now() - start).count();
+    }
+    Engine                                                      m_Engine;               ///< The engine.
+    glicko::input::Interner                                     m_Interner;             ///< ID of each player name.
+    std::vector<std::unique_ptr<glicko::snapshot::MappedFile>>  m_Files;                ///< All mapped files.
+    std::vector<Engine::GameRecord>                             m_Games;                ///< Games of the current rating period.
+    std::size_t                                                 m_GameCount{0};         ///< Number of games parsed.
+    std::size_t                                                 m_PeriodCount{0};       ///< Number of rating periods computed.
+    std::size_t                                                 m_ByteCount{0};         ///< Size of all mapped files.
+    double                                                      m_ComputeSeconds{0};    ///< Time spent in rating periods.
+};
+
+
+/**
+ * @brief Print usage.
+ */
+void PrintUsage()
+{
+    std::cout << "usage: glicko [options] <game file>...\n"
+              << "Rates games from CSV files (player1,player2,result with result 1, 0.5, 0, 1-0, 1/2-1/2 or 0-1)\n"
+              << "or binary game logs and writes player,rating,deviation,volatility as CSV.\n"
+              << "  --players=<file>        initial players as CSV player,rating,deviation,volatility\n"
+              << "  --output=<file>         write the ratings to file (default: standard output)\n"
+              << "  --period=<n>            games per rating period (default: all games in one period)\n"
+              << "  --volatility=<x>        initial rating volatility (default 0.06)\n"
+              << "  --tau=<x>               tau system constant (default 0.5)\n"
+              << "  --threads=<n>           threads of a rating period (default: all cores)\n"
+              << "  --kernel=scalar|vector  kernel of a rating period (default scalar)\n"
+              << "  --convert=<file>        write the games as binary game log instead of rating them\n";
+}
+
+
+/**
+ * @brief Parse command line.
+ *
+ * @param[in]   argc    Number of arguments.
+ * @param[in]   argv    Arguments.
+ * @return              false on error.
+ */
+bool ParseOptions(int argc, char *argv[])
+{
+    for(int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        if(arg.compare(0, 2, "--") != 0)
+        {
+            g_Options.gameFiles.push_back(arg);
+            continue;
+        }
+        std::size_t pos = arg.find('=');
+        std::string key = arg.substr(0, pos);
+        std::string value = (pos != std::string::npos) ? arg.substr(pos + 1) : "";
+        try
+        {
+            if(key == "--players")
+            {
+                g_Options.playerFile = value;
+            }
+            else if(key == "--output")
+            {
+                g_Options.outFile = value;
+            }
+            else if(key == "--period")
+            {
+                g_Options.periodGames = std::stoul(value);
+            }
+            else if(key == "--volatility")
+            {
+                g_Options.volatility = std::stod(value);
+            }
+            else if(key == "--tau")
+            {
+                g_Options.tau = std::stod(value);
+            }
+            else if(key == "--threads")
+            {
+                g_Options.threads = static_cast<unsigned>(std::stoul(value));
+            }
+            else if(key == "--kernel" && (value == "scalar" || value == "vector"))
+            {
+                g_Options.kernel = (value == "vector") ? glicko::Kernel::Auto : glicko::Kernel::Scalar;
+            }
+            else if(key == "--convert")
+            {
+                g_Options.convertFile = value;
+            }
+            else
+            {
+                return false;
+            }
+        }
+        catch(const std::exception &)
+        {
+            return false;
+        }
+    }
+    return !g_Options.gameFiles.empty();
+}
+
+} // namespace
+
 
-int main(int /*argc*/, char */*argv*/[])
+int main(int argc, char *argv[])
 {
-    glicko::Glicko<int> glicko{0.06, 0.5};
-
-    // add some players
-//    glicko.CreatePlayer(1, 1500, 200, 0.06);
-//    glicko.CreatePlayer(2, 1400, 30, 0.06);
-//    glicko.CreatePlayer(3, 1550, 100, 0.06);
-//    glicko.CreatePlayer(4, 1700, 300, 0.06);
-    glicko.CreatePlayer(1);
-    glicko.CreatePlayer(2);
-    glicko.CreatePlayer(3);
-    glicko.CreatePlayer(4);
-
-
-    std::cout << 1 << " " << glicko.GetRating(1) << " " << glicko.GetDeviation(1) << " " << glicko.GetVolatility(1) << std::endl;
-    std::cout << 2 << " " << glicko.GetRating(2) << " " << glicko.GetDeviation(2) << " " << glicko.GetVolatility(2) << std::endl;
-    std::cout << 3 << " " << glicko.GetRating(3) << " " << glicko.GetDeviation(3) << " " << glicko.GetVolatility(3) << std::endl;
-    std::cout << 4 << " " << glicko.GetRating(4) << " " << glicko.GetDeviation(4) << " " << glicko.GetVolatility(4) << std::endl;
-
-
-    // add games
-    glicko.AddGame(1, 2, glicko::GameResult::Player1);
-    glicko.AddGame(3, 4, glicko::GameResult::Player2);
-
-    // compute ratings
-    glicko.ComputeRatings();
-
-    // new round
-    glicko.AddGame(1, 3, glicko::GameResult::Player1);
-    glicko.AddGame(2, 4, glicko::GameResult::Player2);
-    glicko.ComputeRatings();
-
-    // new round
-    glicko.AddGame(1, 4, glicko::GameResult::Player1);
-    glicko.AddGame(2, 3, glicko::GameResult::Player2);
-    glicko.ComputeRatings();
-
-    std::cout << 1 << " " << glicko.GetRating(1) << " " << glicko.GetDeviation(1) << " " << glicko.GetVolatility(1) << std::endl;
-    std::cout << 2 << " " << glicko.GetRating(2) << " " << glicko.GetDeviation(2) << " " << glicko.GetVolatility(2) << std::endl;
-    std::cout << 3 << " " << glicko.GetRating(3) << " " << glicko.GetDeviation(3) << " " << glicko.GetVolatility(3) << std::endl;
-    std::cout << 4 << " " << glicko.GetRating(4) << " " << glicko.GetDeviation(4) << " " << glicko.GetVolatility(4) << std::endl;
+    if(!ParseOptions(argc, argv))
+    {
+        PrintUsage();
+        return 1;
+    }
+    try
+    {
+        auto start = Clock::now();
+        BatchRunner runner;
+        if(!g_Options.convertFile.empty())
+        {
+            runner.Convert(g_Options.convertFile);
+            return 0;
+        }
+        if(!g_Options.playerFile.empty())
+        {
+            runner.LoadPlayers(g_Options.playerFile);
+        }
+        for(const auto & fileName : g_Options.gameFiles)
+        {
+            runner.RateGames(fileName);
+        }
+        runner.Finish();
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        runner.WriteRatings(g_Options.outFile);
+        runner.PrintSummary(seconds);
+    }
+    catch(const glicko::GlickoException &e)
+    {
+        std::cerr << "glicko: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
 }
@@ -0,0 +1,872 @@
+/******************************************************************************//**
+ * @file
+ * @brief Rating periods computed by several processes
+ *
+ * @copyright Copyright (C) by Doru Julian Bugariu
+ * julian@bugariu.eu
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the
+ * Free Software Foundation
+ * 51 Franklin Street, Fifth Floor
+ * Boston, MA 02110-1301, USA
+ * http://www.fsf.org/about/contact.html
+ *********************************************************************************/
+
+
+#ifndef GLICKO_PARTITION_H
+#define GLICKO_PARTITION_H
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "exception.h"
+#include "glicko.h"
+#include "index.h"
+
+namespace glicko
+{
+
+namespace partition
+{
+
+/**
+ * @brief Command sent by the coordinator to a shard.
+ */
+enum class Command : std::uint8_t
+{
+    Create,             ///< Create a player with default values, no reply.
+    CreateWithValues,   ///< Create a player with values, no reply.
+    Sync,               ///< Reply the first error of the commands without reply.
+    State,              ///< Reply the glicko2 values of players.
+    Period,             ///< Compute a rating period with ghost opponents.
+    Get,                ///< Reply the values of one player.
+    Count,              ///< Reply the number of players.
+    Quit                ///< End the shard process.
+};
+
+
+/**
+ * @brief Buffered binary messages over a socket.
+ *
+ * Values are written raw, the peer is a process of the same program.
+ */
+class Channel
+{
+public:
+    /**
+     * @brief Constructor.
+     *
+     * @param[in]   fd  Connected socket, closed by the destructor.
+     */
+    explicit Channel(int fd):
+        m_Fd{fd},
+        m_In(1 << 16)
+    {
+    }
+    /**
+     * @brief Destructor, closes the socket.
+     */
+    ~Channel()
+    {
+        ::close(m_Fd);
+    }
+    Channel(const Channel &) = delete;
+    Channel & operator=(const Channel &) = delete;
+    /**
+     * @brief Get the socket.
+     *
+     * @return  File descriptor of the socket.
+     */
+    int GetFd() const
+    {
+        return m_Fd;
+    }
+    /**
+     * @brief Append a value to the output buffer.
+     *
+     * @param[in]   value   Trivially copyable value.
+     */
+    template <typename VALUE>
+    void Put(const VALUE &value)
+    {
+        static_assert(std::is_trivially_copyable<VALUE>::value, "Channel::Put needs a trivially copyable type.");
+        const char * bytes = reinterpret_cast<const char *>(&value);
+        m_Out.insert(m_Out.end(), bytes, bytes + sizeof(VALUE));
+    }
+    /**
+     * @brief Append a player ID to the output buffer.
+     *
+     * @param[in]   id  Trivially copyable ID or std::string.
+     */
+    template <typename IDTYPE>
+    void PutID(const IDTYPE &id)
+    {
+        if constexpr(std::is_trivially_copyable<IDTYPE>::value)
+        {
+            Put(id);
+        }
+        else
+        {
+            Put(static_cast<std::uint32_t>(id.size()));
+            m_Out.insert(m_Out.end(), id.begin(), id.end());
+        }
+    }
+    /**
+     * @brief Send the output buffer.
+     *
+     * @throws glicko::GlickoException when the peer has closed the socket.
+     */
+    void Flush()
+    {
+        std::size_t done = 0;
+        while(done < m_Out.size())
+        {
+            ssize_t count = ::send(m_Fd, m_Out.data() + done, m_Out.size() - done, MSG_NOSIGNAL);
+            if(count < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            if(count <= 0)
+            {
+                m_Out.clear();
+                GLTHROW("Lost connection to partition process.");
+            }
+            done += static_cast<std::size_t>(count);
+        }
+        m_Out.clear();
+    }
+    /**
+     * @brief Read a value.
+     *
+     * @throws glicko::GlickoException when the peer has closed the socket.
+     * @return  The value.
+     */
+    template <typename VALUE>
+    VALUE Get()
+    {
+        static_assert(std::is_trivially_copyable<VALUE>::value, "Channel::Get needs a trivially copyable type.");
+        VALUE value;
+        Read(&value, sizeof(VALUE));
+        return value;
+    }
+    /**
+     * @brief Read a player ID.
+     *
+     * @throws glicko::GlickoException when the peer has closed the socket.
+     * @param[out]  id  Trivially copyable ID or std::string.
+     */
+    template <typename IDTYPE>
+    void GetID(IDTYPE &id)
+    {
+        if constexpr(std::is_trivially_copyable<IDTYPE>::value)
+        {
+            id = Get<IDTYPE>();
+        }
+        else
+        {
+            id.resize(Get<std::uint32_t>());
+            Read(&id[0], id.size());
+        }
+    }
+    /**
+     * @brief Check if the peer has closed the socket before the next message.
+     *
+     * @return  true at the end of the stream.
+     */
+    bool AtEnd()
+    {
+        return m_Position == m_Filled && !Fill();
+    }
+private:
+    /**
+     * @brief Read bytes through the input buffer.
+     *
+     * @throws glicko::GlickoException when the peer has closed the socket.
+     * @param[out]  data    Destination.
+     * @param[in]   size    Number of bytes.
+     */
+    void Read(void *data, std::size_t size)
+    {
+        char * destination = static_cast<char *>(data);
+        while(size > 0)
+        {
+            if(m_Position == m_Filled && !Fill())
+            {
+                GLTHROW("Lost connection to partition process.");
+            }
+            std::size_t count = std::min(size, m_Filled - m_Position);
+            std::memcpy(destination, m_In.data() + m_Position, count);
+            m_Position += count;
+            destination += count;
+            size -= count;
+        }
+    }
+    /**
+     * @brief Refill the empty input buffer.
+     *
+     * @return  false at the end of the stream.
+     */
+    bool Fill()
+    {
+        ssize_t count;
+        do
+        {
+            count = ::recv(m_Fd, m_In.data(), m_In.size(), 0);
+        }
+        while(count < 0 && errno == EINTR);
+        m_Position = 0;
+        m_Filled = (count > 0) ? static_cast<std::size_t>(count) : 0;
+        return m_Filled > 0;
+    }
+    int                 m_Fd;           ///< The socket.
+    std::vector<char>   m_Out;          ///< Output buffer.
+    std::vector<char>   m_In;           ///< Input buffer.
+    std::size_t         m_Position{0};  ///< Read position in m_In.
+    std::size_t         m_Filled{0};    ///< Number of valid bytes in m_In.
+};
+
+
+/**
+ * @brief Glicko engine split over several processes.
+ *
+ * Players are sharded by a hash of their ID over worker processes, each with its
+ * own engine holding only its players, so the player table is bounded by the
+ * memory of all shards together. The coordinator keeps the games of the current
+ * rating period and routes each game to the shards of its players. Before a
+ * rating period it fetches the values of each opponent from another shard and
+ * creates it in the shard of the player as ghost, removed again after the rating
+ * period. A shard sees the games of its players in the order they were added, so
+ * the results equal a single engine with the same TRAITS and settings bit for bit.
+ *
+ * The shards are forked by the constructor and talk to the coordinator over Unix
+ * sockets (POSIX only); they end when the coordinator is destroyed. Players are
+ * created lazily: errors of CreatePlayer are reported by the next call that waits
+ * for the shards. Team games are not supported.
+ *
+ * A rating period is not atomic over the shards: when one shard fails, the others
+ * have computed the period already. The coordinator then refuses all further
+ * calls, its players must be rebuilt, e.g. from saved ratings.
+ * @tparam  IDTYPE  Type of player ID, trivially copyable or std::string, with std::hash.
+ * @tparam  TRAITS  Compile-time configuration, see BasicTraits.
+ */
+template <typename IDTYPE, typename TRAITS = DefaultTraits>
+class Coordinator
+{
+public:
+    using engine_type = Glicko<IDTYPE, TRAITS>;                     ///< Engine of each shard.
+    using PlayerState = typename engine_type::PlayerState;          ///< Values of a player in glicko2 scale.
+    using GameRecord = typename engine_type::GameRecord;            ///< A game.
+    /**
+     * @brief Constructor.
+     *
+     * Forks the shard processes.
+     * @throws glicko::GlickoException when a process cannot be created.
+     * @param[in]   shardCount          Number of shard processes, at least 1.
+     * @param[in]   initialVolatility   Initial rating volatility.
+     * @param[in]   tau                 Tau system constant.
+     * @param[in]   configure           Called in each shard process with its engine, e.g. to set
+     *                                  the kernel, the threads or streaming mode.
+     */
+    Coordinator(unsigned shardCount, double initialVolatility, double tau,
+                const std::function<void(engine_type &)> &configure = nullptr)
+    {
+        if(shardCount == 0)
+        {
+            GLTHROW("A partition needs at least one shard.");
+        }
+        for(unsigned i = 0; i < shardCount; ++i)
+        {
+            int fds[2];
+            if(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) != 0)
+            {
+                Shutdown();
+                GLTHROW("Cannot create socket for partition process.");
+            }
+            pid_t pid = ::fork();
+            if(pid < 0)
+            {
+                ::close(fds[0]);
+                ::close(fds[1]);
+                Shutdown();
+                GLTHROW("Cannot create partition process.");
+            }
+            if(pid == 0)
+            {
+                // shard process: drop the coordinator's sockets, serve, never return
+                ::close(fds[0]);
+                for(const auto & shard : m_Shards)
+                {
+                    ::close(shard.channel->GetFd());
+                }
+                int status = 0;
+                try
+                {
+                    Channel channel{fds[1]};
+                    engine_type engine{initialVolatility, tau};
+                    if(configure)
+                    {
+                        configure(engine);
+                    }
+                    Serve(engine, channel);
+                }
+                catch(...)
+                {
+                    status = 1;
+                }
+                ::_exit(status);
+            }
+            ::close(fds[1]);
+            m_Shards.push_back({pid, std::make_unique<Channel>(fds[0]), false});
+        }
+    }
+    /**
+     * @brief Destructor, ends the shard processes.
+     */
+    ~Coordinator()
+    {
+        Shutdown();
+    }
+    Coordinator(const Coordinator &) = delete;
+    Coordinator & operator=(const Coordinator &) = delete;
+    /**
+     * @brief Get number of shards.
+     *
+     * @return  Number of shard processes.
+     */
+    unsigned GetShardCount() const
+    {
+        return static_cast<unsigned>(m_Shards.size());
+    }
+    /**
+     * @brief Get shard of a player.
+     *
+     * @param[in]   playerID    ID of the player.
+     * @return                  Shard owning the player.
+     */
+    unsigned GetShard(const IDTYPE &playerID) const
+    {
+        return static_cast<unsigned>(index::Mix(std::hash<IDTYPE>{}(playerID)) % m_Shards.size());
+    }
+    /**
+     * @brief Create a new player with default values.
+     *
+     * @param[in]   playerID    ID of the player.
+     */
+    void CreatePlayer(const IDTYPE &playerID)
+    {
+        Shard & shard = m_Shards[GetShard(playerID)];
+        shard.channel->Put(Command::Create);
+        shard.channel->PutID(playerID);
+        shard.pending = true;
+    }
+    /**
+     * @brief Create a new player.
+     *
+     * @param[in]   playerID            ID of the player.
+     * @param[in]   initialRating       Initial rating.
+     * @param[in]   initialDeviation    Initial rating deviation.
+     * @param[in]   initialVolatility   Initial rating volatility.
+     */
+    void CreatePlayer(const IDTYPE &playerID, double initialRating, double initialDeviation, double initialVolatility)
+    {
+        Shard & shard = m_Shards[GetShard(playerID)];
+        shard.channel->Put(Command::CreateWithValues);
+        shard.channel->PutID(playerID);
+        shard.channel->Put(initialRating);
+        shard.channel->Put(initialDeviation);
+        shard.channel->Put(initialVolatility);
+        shard.pending = true;
+    }
+    /**
+     * @brief Add a game.
+     *
+     * @param[in]   playerID1   ID of player 1.
+     * @param[in]   playerID2   ID of player 2.
+     * @param[in]   result      Game result.
+     */
+    void AddGame(const IDTYPE &playerID1, const IDTYPE &playerID2, GameResult result)
+    {
+        m_Games.push_back({playerID1, playerID2, result});
+    }
+    /**
+     * @brief Compute a rating period in all shards.
+     *
+     * When a shard fails in the rating period, the coordinator becomes unusable,
+     * see the class description.
+     * @throws glicko::GlickoException when a shard reports an error or has ended.
+     */
+    void ComputeRatings()
+    {
+        Sync();
+        std::size_t shardCount = m_Shards.size();
+        // route games, each shard needs the opponents of its players from other shards
+        std::vector<std::unordered_set<IDTYPE>> ghosts(shardCount);
+        std::vector<std::uint64_t> gameCounts(shardCount, 0);
+        m_GameShards.resize(2*m_Games.size());
+        for(std::size_t i = 0; i < m_Games.size(); ++i)
+        {
+            unsigned shard1 = GetShard(m_Games[i].player1);
+            unsigned shard2 = GetShard(m_Games[i].player2);
+            m_GameShards[2*i] = shard1;
+            m_GameShards[2*i + 1] = shard2;
+            ++gameCounts[shard1];
+            if(shard2 != shard1)
+            {
+                ++gameCounts[shard2];
+                ghosts[shard1].insert(m_Games[i].player2);
+                ghosts[shard2].insert(m_Games[i].player1);
+            }
+        }
+        // fetch the ghosts from their shards, all shards answer in parallel
+        std::vector<std::vector<const IDTYPE *>> requests(shardCount);
+        for(const auto & shardGhosts : ghosts)
+        {
+            for(const IDTYPE & id : shardGhosts)
+            {
+                requests[GetShard(id)].push_back(&id);
+            }
+        }
+        for(std::size_t t = 0; t < shardCount; ++t)
+        {
+            Channel & channel = *m_Shards[t].channel;
+            channel.Put(Command::State);
+            channel.Put(static_cast<std::uint64_t>(requests[t].size()));
+            for(const IDTYPE * id : requests[t])
+            {
+                channel.PutID(*id);
+            }
+            channel.Flush();
+        }
+        std::unordered_map<IDTYPE, PlayerState> states;
+        ReadReplies([this, &requests, &states](Shard &shard)
+        {
+            Channel & channel = *shard.channel;
+            CheckReply(channel);
+            for(const IDTYPE * id : requests[&shard - m_Shards.data()])
+            {
+                // unknown players get no ghost, their games are skipped as by a single engine
+                if(channel.Get<std::uint8_t>() != 0)
+                {
+                    states.emplace(*id, channel.Get<PlayerState>());
+                }
+            }
+        });
+        // send ghosts and games, then wait for all shards; from here on a failure
+        // may leave the period applied on some shards only
+        m_Failed = true;
+        for(std::size_t s = 0; s < shardCount; ++s)
+        {
+            Channel & channel = *m_Shards[s].channel;
+            channel.Put(Command::Period);
+            std::uint64_t ghostCount = 0;
+            for(const IDTYPE & id : ghosts[s])
+            {
+                ghostCount += states.count(id);
+            }
+            channel.Put(ghostCount);
+            for(const IDTYPE & id : ghosts[s])
+            {
+                auto found = states.find(id);
+                if(found != states.end())
+                {
+                    channel.PutID(id);
+                    channel.Put(found->second);
+                }
+            }
+            channel.Put(gameCounts[s]);
+            for(std::size_t i = 0; i < m_Games.size(); ++i)
+            {
+                if(m_GameShards[2*i] == s || m_GameShards[2*i + 1] == s)
+                {
+                    channel.PutID(m_Games[i].player1);
+                    channel.PutID(m_Games[i].player2);
+                    channel.Put(m_Games[i].result);
+                }
+            }
+            channel.Flush();
+        }
+        m_Games.clear();
+        ReadReplies([](Shard &shard)
+        {
+            CheckReply(*shard.channel);
+        });
+        m_Failed = false;
+    }
+    /**
+     * @brief Get rating for one player.
+     *
+     * @throws glicko::GlickoException when player with this ID does not exist.
+     * @param[in]   playerID    ID of the player.
+     * @return                  Player rating.
+     */
+    double GetRating(const IDTYPE &playerID)
+    {
+        return Get(playerID).rating;
+    }
+    /**
+     * @brief Get rating deviation for one player.
+     *
+     * @throws glicko::GlickoException when player with this ID does not exist.
+     * @param[in]   playerID    ID of the player.
+     * @return                  Player rating deviation.
+     */
+    double GetDeviation(const IDTYPE &playerID)
+    {
+        return Get(playerID).deviation;
+    }
+    /**
+     * @brief Get rating volatility for one player.
+     *
+     * @throws glicko::GlickoException when player with this ID does not exist.
+     * @param[in]   playerID    ID of the player.
+     * @return                  Player rating volatility.
+     */
+    double GetVolatility(const IDTYPE &playerID)
+    {
+        return Get(playerID).volatility;
+    }
+    /**
+     * @brief Get rating, rating deviation and rating volatility of one player.
+     *
+     * @throws glicko::GlickoException when player with this ID does not exist.
+     * @param[in]   playerID    ID of the player.
+     * @return                  The values, as returned by the engine of the shard.
+     */
+    typename engine_type::Rating Get(const IDTYPE &playerID)
+    {
+        Sync();
+        Channel & channel = *m_Shards[GetShard(playerID)].channel;
+        channel.Put(Command::Get);
+        channel.PutID(playerID);
+        channel.Flush();
+        CheckReply(channel);
+        return channel.Get<typename engine_type::Rating>();
+    }
+    /**
+     * @brief Get number of players.
+     *
+     * @throws glicko::GlickoException when a shard reports an error or has ended.
+     * @return  Number of players in all shards.
+     */
+    std::size_t GetPlayerCount()
+    {
+        Sync();
+        for(auto & shard : m_Shards)
+        {
+            shard.channel->Put(Command::Count);
+            shard.channel->Flush();
+        }
+        std::size_t count = 0;
+        ReadReplies([&count](Shard &shard)
+        {
+            Channel & channel = *shard.channel;
+            CheckReply(channel);
+            count += channel.Get<std::uint64_t>();
+        });
+        return count;
+    }
+private:
+    /**
+     * @brief A shard process.
+     */
+    struct Shard
+    {
+        pid_t                       pid;        ///< Process ID.
+        std::unique_ptr<Channel>    channel;    ///< Socket to the process.
+        bool                        pending;    ///< Commands without reply were sent since the last Sync.
+    };
+    std::vector<Shard>          m_Shards;           ///< The shard processes.
+    std::vector<GameRecord>     m_Games;            ///< Games of the current rating period, in order.
+    std::vector<unsigned>       m_GameShards;       ///< Shards of both players of each game.
+    bool                        m_Failed{false};    ///< A rating period failed on some shards.
+    /**
+     * @brief Send the pending commands and report their first error.
+     *
+     * @throws glicko::GlickoException when a shard reports an error or has ended,
+     *         or a rating period has failed before.
+     */
+    void Sync()
+    {
+        if(m_Failed)
+        {
+            GLTHROW("Partition is inconsistent after a failed rating period.");
+        }
+        for(auto & shard : m_Shards)
+        {
+            if(shard.pending)
+            {
+                shard.channel->Put(Command::Sync);
+                shard.channel->Flush();
+            }
+        }
+        ReadReplies([](Shard &shard)
+        {
+            if(shard.pending)
+            {
+                shard.pending = false;
+                CheckReply(*shard.channel);
+            }
+        });
+    }
+    /**
+     * @brief Read the replies of all shards, then report the first error.
+     *
+     * Every shard is read even when an earlier one fails, so the requests and
+     * replies of the other shards stay in step.
+     * @throws glicko::GlickoException the first error of a shard.
+     * @param[in]   read    Reads the reply of one shard, called as read(shard).
+     */
+    template <typename READ> void ReadReplies(READ read)
+    {
+        std::exception_ptr error;
+        for(auto & shard : m_Shards)
+        {
+            try
+            {
+                read(shard);
+            }
+            catch(const GlickoException &)
+            {
+                if(!error)
+                {
+                    error = std::current_exception();
+                }
+            }
+        }
+        if(error)
+        {
+            std::rethrow_exception(error);
+        }
+    }
+    /**
+     * @brief Read the status of a reply.
+     *
+     * @throws glicko::GlickoException with the message of the shard when it reports an error.
+     * @param[in]   channel     Channel of the shard.
+     */
+    static void CheckReply(Channel &channel)
+    {
+        if(channel.Get<std::uint8_t>() != 0)
+        {
+            std::string message;
+            channel.GetID(message);
+            GLTHROW(message);
+        }
+    }
+    /**
+     * @brief Send a reply status.
+     *
+     * @param[in]   channel     Channel to the coordinator.
+     * @param[in]   error       Error message, empty for success.
+     */
+    static void PutStatus(Channel &channel, const std::string &error)
+    {
+        channel.Put(static_cast<std::uint8_t>(error.empty() ? 0 : 1));
+        if(!error.empty())
+        {
+            channel.PutID(error);
+        }
+    }
+    /**
+     * @brief Serve the coordinator in a shard process until it quits.
+     *
+     * @param[in,out]   engine      Engine of the shard.
+     * @param[in,out]   channel     Channel to the coordinator.
+     */
+    static void Serve(engine_type &engine, Channel &channel)
+    {
+        std::string error;      // first error of the commands without reply
+        IDTYPE id{};
+        while(!channel.AtEnd())
+        {
+            Command command = channel.Get<Command>();
+            switch(command)
+            {
+            case Command::Create:
+            case Command::CreateWithValues:
+            {
+                channel.GetID(id);
+                double values[3];
+                if(command == Command::CreateWithValues)
+                {
+                    for(double & value : values)
+                    {
+                        value = channel.Get<double>();
+                    }
+                }
+                try
+                {
+                    if(command == Command::Create)
+                    {
+                        engine.CreatePlayer(id);
+                    }
+                    else
+                    {
+                        engine.CreatePlayer(id, values[0], values[1], values[2]);
+                    }
+                }
+                catch(const GlickoException &e)
+                {
+                    if(error.empty())
+                    {
+                        error = e.what();
+                    }
+                }
+                break;
+            }
+            case Command::Sync:
+                PutStatus(channel, error);
+                error.clear();
+                break;
+            case Command::State:
+            {
+                std::uint64_t count = channel.Get<std::uint64_t>();
+                PutStatus(channel, "");
+                for(std::uint64_t i = 0; i < count; ++i)
+                {
+                    channel.GetID(id);
+                    bool found = engine.HasPlayer(id);
+                    channel.Put(static_cast<std::uint8_t>(found));
+                    if(found)
+                    {
+                        channel.Put(engine.GetPlayerState(id));
+                    }
+                }
+                break;
+            }
+            case Command::Period:
+            {
+                std::vector<std::pair<IDTYPE, PlayerState>> ghosts(channel.Get<std::uint64_t>());
+                for(auto & ghost : ghosts)
+                {
+                    channel.GetID(ghost.first);
+                    ghost.second = channel.Get<PlayerState>();
+                }
+                std::vector<GameRecord> games(channel.Get<std::uint64_t>());
+                for(GameRecord & game : games)
+                {
+                    channel.GetID(game.player1);
+                    channel.GetID(game.player2);
+                    game.result = channel.Get<GameResult>();
+                }
+                std::string periodError;
+                std::size_t created = 0;
+                try
+                {
+                    for(; created < ghosts.size(); ++created)
+                    {
+                        engine.CreatePlayer(ghosts[created].first, ghosts[created].second);
+                    }
+                    engine.AddGames(std::make_move_iterator(games.begin()), std::make_move_iterator(games.end()));
+                    engine.ComputeRatings();
+                }
+                catch(const std::exception &e)
+                {
+                    periodError = e.what();
+                }
+                // remove the ghosts also after an error, compaction only cuts the end of the table
+                try
+                {
+                    for(std::size_t i = 0; i < created; ++i)
+                    {
+                        engine.RemovePlayer(ghosts[i].first);
+                    }
+                    engine.Compact(static_cast<std::size_t>(-1));
+                }
+                catch(const std::exception &e)
+                {
+                    if(periodError.empty())
+                    {
+                        periodError = e.what();
+                    }
+                }
+                PutStatus(channel, periodError);
+                break;
+            }
+            case Command::Get:
+            {
+                channel.GetID(id);
+                typename engine_type::Rating rating{};
+                try
+                {
+                    rating = {engine.GetRating(id), engine.GetDeviation(id), engine.GetVolatility(id)};
+                }
+                catch(const GlickoException &e)
+                {
+                    PutStatus(channel, e.what());
+                    break;
+                }
+                PutStatus(channel, "");
+                channel.Put(rating);
+                break;
+            }
+            case Command::Count:
+                PutStatus(channel, "");
+                channel.Put(static_cast<std::uint64_t>(engine.GetPlayerCount()));
+                break;
+            case Command::Quit:
+            default:
+                return;
+            }
+            channel.Flush();
+        }
+    }
+    /**
+     * @brief End all shard processes and wait for them.
+     */
+    void Shutdown()
+    {
+        for(auto & shard : m_Shards)
+        {
+            try
+            {
+                shard.channel->Put(Command::Quit);
+                shard.channel->Flush();
+            }
+            catch(const GlickoException &)
+            {
+                // the process has ended already
+            }
+        }
+        for(auto & shard : m_Shards)
+        {
+            shard.channel.reset();
+            ::waitpid(shard.pid, nullptr, 0);
+        }
+        m_Shards.clear();
+    }
+};
+
+} // namespace partition
+
+} // namespace glicko
+
+#endif // GLICKO_PARTITION_H
@@ -0,0 +1,471 @@
+/******************************************************************************//**
+ * @file
+ * @brief Replay of game history over many rating periods
+ *
+ * @copyright Copyright (C) by Doru Julian Bugariu
+ * julian@bugariu.eu
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the
+ * Free Software Foundation
+ * 51 Franklin Street, Fifth Floor
+ * Boston, MA 02110-1301, USA
+ * http://www.fsf.org/about/contact.html
+ *********************************************************************************/
+
+
+#ifndef GLICKO_REPLAY_H
+#define GLICKO_REPLAY_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "glicko.h"
+
+namespace glicko
+{
+
+namespace replay
+{
+
+/**
+ * @brief A game with the time it was played.
+ *
+ * @tparam  IDTYPE  Type of player ID.
+ */
+template <typename IDTYPE>
+struct TimedGame
+{
+    std::int64_t    time;       ///< Time of the game, in any unit (e.g. seconds).
+    IDTYPE          player1;    ///< ID of player 1.
+    IDTYPE          player2;    ///< ID of player 2.
+    GameResult      result;     ///< Game result.
+};
+
+/**
+ * @brief Replay of a game history through an engine.
+ *
+ * The games are split into rating periods of fixed length by their time. A
+ * producer thread reads and buckets the games of period k+1 while the engine
+ * computes period k (with its own threads, see Glicko::SetThreadCount). After
+ * each period a snapshot and the new values of the players of the period can
+ * be written and a callback is called.
+ * @tparam  IDTYPE  Type of player ID, needs operator< when writing deltas.
+ * @tparam  TRAITS  Configuration of the engine.
+ */
+template <typename IDTYPE, typename TRAITS = DefaultTraits>
+class Replay
+{
+public:
+    using Engine = Glicko<IDTYPE, TRAITS>;      ///< Engine type.
+    /**
+     * @brief Called after each rating period with the period number (from 0) and the engine.
+     *
+     * For a run of periods without games it is called once, with the last period of the run.
+     */
+    using Callback = std::function<void(std::uint64_t period, const Engine &engine)>;
+    /**
+     * @brief Constructor.
+     *
+     * Period k contains the games with start + k*periodLength <= time < start + (k+1)*periodLength.
+     * @throws glicko::GlickoException when periodLength is not positive.
+     * @param[in]   engine          Engine with the players, its games not yet computed are added to the first period.
+     * @param[in]   start           Start time of the first period.
+     * @param[in]   periodLength    Length of a rating period.
+     */
+    Replay(Engine &engine, std::int64_t start, std::int64_t periodLength):
+        m_Engine(engine),
+        m_Start{start},
+        m_PeriodLength{periodLength}
+    {
+        if(periodLength <= 0)
+        {
+            GLTHROW("Period length must be positive.");
+        }
+    }
+    Replay(const Replay &) = delete;
+    Replay & operator=(const Replay &) = delete;
+    /**
+     * @brief Set the callback called after each rating period.
+     *
+     * @param[in]   callback    The callback, empty for none.
+     */
+    void SetCallback(Callback callback)
+    {
+        m_Callback = std::move(callback);
+    }
+    /**
+     * @brief Write a snapshot after every n-th rating period.
+     *
+     * The file of period k is prefix + k + ".snapshot".
+     * @param[in]   prefix  Prefix of the file names, empty for no snapshots.
+     * @param[in]   every   Write a snapshot after each period k with (k+1) % every == 0.
+     */
+    void SetSnapshots(const std::string &prefix, std::uint64_t every = 1)
+    {
+        m_SnapshotPrefix = prefix;
+        m_SnapshotEvery = std::max<std::uint64_t>(every, 1);
+    }
+    /**
+     * @brief Write the new values of the players of each rating period.
+     *
+     * One CSV line "period,id,rating,deviation,volatility" per existing player
+     * named in the games of the period. Idle players are not written, their deviation grows by the
+     * glicko2 rules. IDs are written with operator<<.
+     * @param[in]   fileName    Name of the file, empty for no deltas.
+     */
+    void SetDeltas(const std::string &fileName)
+    {
+        m_DeltaFileName = fileName;
+    }
+    /**
+     * @brief Set the number of rating periods bucketed ahead of the computation.
+     *
+     * @param[in]   depth   Number of periods, at least 1.
+     */
+    void SetQueueDepth(std::size_t depth)
+    {
+        m_QueueDepth = std::max<std::size_t>(depth, 1);
+    }
+    /**
+     * @brief Replay games from a source.
+     *
+     * The games must be ordered by rating period, games within a period may be in
+     * any order. Periods without games are computed too, a run of them in one step
+     * with Glicko::ComputeIdlePeriods, so a far jump in time costs no more than one
+     * period. Snapshots and the callback see only the last period of such a run.
+     * @throws glicko::GlickoException when a game is before the start or out of
+     *         order, or a file cannot be written. Exceptions of the source and the
+     *         callback are passed on.
+     * @tparam      SOURCE  Callable bool(TimedGame<IDTYPE> &game), returns false after the last game.
+     * @param[in]   source  Source of the games, called from the producer thread.
+     * @return              Number of computed rating periods.
+     */
+    template <typename SOURCE>
+    std::uint64_t Run(SOURCE source)
+    {
+        if(!m_DeltaFileName.empty())
+        {
+            m_Deltas.open(m_DeltaFileName, std::ios::trunc);
+            if(!m_Deltas)
+            {
+                GLTHROW("Cannot create file " + m_DeltaFileName + ".");
+            }
+            m_Deltas.precision(std::numeric_limits<double>::max_digits10);
+        }
+        m_CollectPlayers = m_Deltas.is_open();
+        m_Queue.clear();
+        m_Done = false;
+        m_Stop = false;
+        m_Error = nullptr;
+        std::thread producer{[this, &source]
+        {
+            Produce(source);
+        }};
+        std::uint64_t periodCount = 0;
+        try
+        {
+            Bucket bucket;
+            while(Pop(bucket))
+            {
+                if(bucket.idle > 0)
+                {
+                    m_Engine.ComputeIdlePeriods(bucket.idle);
+                    FinishPeriods(bucket.period - bucket.idle, bucket.period - 1, {});
+                    periodCount += bucket.idle;
+                }
+                m_Engine.AddGames(std::make_move_iterator(bucket.games.begin()), std::make_move_iterator(bucket.games.end()));
+                m_Engine.ComputeRatings();
+                FinishPeriods(bucket.period, bucket.period, bucket.players);
+                ++periodCount;
+                Recycle(std::move(bucket));
+            }
+        }
+        catch(...)
+        {
+            {
+                std::lock_guard<std::mutex> lock{m_Mutex};
+                m_Stop = true;
+            }
+            m_Changed.notify_all();
+            producer.join();
+            m_Deltas.close();
+            throw;
+        }
+        producer.join();
+        if(m_Deltas.is_open())
+        {
+            m_Deltas.close();
+            if(!m_Deltas)
+            {
+                GLTHROW("Cannot write file " + m_DeltaFileName + ".");
+            }
+        }
+        if(m_Error)
+        {
+            std::rethrow_exception(m_Error);
+        }
+        return periodCount;
+    }
+    /**
+     * @brief Replay games from a range.
+     *
+     * @copydetails Run(SOURCE)
+     * @param[in]   first   First TimedGame.
+     * @param[in]   last    One past the last TimedGame.
+     */
+    template <typename ITERATOR>
+    std::uint64_t Run(ITERATOR first, ITERATOR last)
+    {
+        return Run([&first, last](TimedGame<IDTYPE> &game)
+        {
+            if(first == last)
+            {
+                return false;
+            }
+            game = *first++;
+            return true;
+        });
+    }
+private:
+    /**
+     * @brief Games of one rating period.
+     */
+    struct Bucket
+    {
+        std::uint64_t                               period{0};  ///< Period number.
+        std::uint64_t                               idle{0};    ///< Number of periods without games just before this one.
+        std::vector<typename Engine::GameRecord>    games;      ///< Games of the period.
+        std::vector<IDTYPE>                         players;    ///< Sorted IDs of the players with games, when writing deltas.
+    };
+    /**
+     * @brief Run the producer thread.
+     *
+     * @param[in]   source  Source of the games.
+     */
+    template <typename SOURCE>
+    void Produce(SOURCE &source)
+    {
+        try
+        {
+            Bucketize(source);
+        }
+        catch(...)
+        {
+            std::lock_guard<std::mutex> lock{m_Mutex};
+            m_Error = std::current_exception();
+        }
+        {
+            std::lock_guard<std::mutex> lock{m_Mutex};
+            m_Done = true;
+        }
+        m_Changed.notify_all();
+    }
+    /**
+     * @brief Read the games and pass them on in buckets of one rating period.
+     *
+     * @param[in]   source  Source of the games.
+     */
+    template <typename SOURCE>
+    void Bucketize(SOURCE &source)
+    {
+        Bucket bucket = NewBucket(0);
+        bool any = false;
+        TimedGame<IDTYPE> game;
+        while(source(game))
+        {
+            if(game.time < m_Start)
+            {
+                GLTHROW("Game before the start of the replay.");
+            }
+            std::uint64_t period = static_cast<std::uint64_t>(game.time - m_Start)/static_cast<std::uint64_t>(m_PeriodLength);
+            if(period < bucket.period)
+            {
+                GLTHROW("Games are not ordered by rating period.");
+            }
+            if(period > bucket.period)
+            {
+                // the periods in between have no games
+                std::uint64_t idle = period - bucket.period - 1;
+                if(!Push(std::move(bucket)))
+                {
+                    return;
+                }
+                bucket = NewBucket(period);
+                bucket.idle = idle;
+            }
+            bucket.games.push_back({std::move(game.player1), std::move(game.player2), game.result});
+            any = true;
+        }
+        if(any)
+        {
+            Push(std::move(bucket));
+        }
+    }
+    /**
+     * @brief Get an empty bucket, reusing the storage of computed ones.
+     *
+     * @param[in]   period  Period number.
+     * @return              The bucket.
+     */
+    Bucket NewBucket(std::uint64_t period)
+    {
+        Bucket bucket;
+        {
+            std::lock_guard<std::mutex> lock{m_Mutex};
+            if(!m_Free.empty())
+            {
+                bucket = std::move(m_Free.back());
+                m_Free.pop_back();
+            }
+        }
+        bucket.period = period;
+        bucket.idle = 0;
+        bucket.games.clear();
+        bucket.players.clear();
+        return bucket;
+    }
+    /**
+     * @brief Pass a full bucket to the computation, waits while the queue is full.
+     *
+     * The players of the period are collected here, so that is pipelined too.
+     * @param[in]   bucket  The bucket.
+     * @return              false if the replay has been stopped.
+     */
+    bool Push(Bucket bucket)
+    {
+        if(m_CollectPlayers)
+        {
+            for(const auto & game : bucket.games)
+            {
+                bucket.players.push_back(game.player1);
+                bucket.players.push_back(game.player2);
+            }
+            std::sort(bucket.players.begin(), bucket.players.end());
+            bucket.players.erase(std::unique(bucket.players.begin(), bucket.players.end()), bucket.players.end());
+        }
+        std::unique_lock<std::mutex> lock{m_Mutex};
+        m_Changed.wait(lock, [this]
+        {
+            return m_Stop || m_Queue.size() < m_QueueDepth;
+        });
+        if(m_Stop)
+        {
+            return false;
+        }
+        m_Queue.push_back(std::move(bucket));
+        lock.unlock();
+        m_Changed.notify_all();
+        return true;
+    }
+    /**
+     * @brief Get the next bucket to compute, waits while the queue is empty.
+     *
+     * @param[out]  bucket  The bucket.
+     * @return              false after the last bucket.
+     */
+    bool Pop(Bucket &bucket)
+    {
+        std::unique_lock<std::mutex> lock{m_Mutex};
+        m_Changed.wait(lock, [this]
+        {
+            return m_Done || !m_Queue.empty();
+        });
+        if(m_Queue.empty())
+        {
+            return false;
+        }
+        bucket = std::move(m_Queue.front());
+        m_Queue.pop_front();
+        lock.unlock();
+        m_Changed.notify_all();
+        return true;
+    }
+    /**
+     * @brief Return the storage of a computed bucket.
+     *
+     * @param[in]   bucket  The bucket.
+     */
+    void Recycle(Bucket bucket)
+    {
+        std::lock_guard<std::mutex> lock{m_Mutex};
+        if(m_Free.size() < m_QueueDepth + 1)
+        {
+            m_Free.push_back(std::move(bucket));
+        }
+    }
+    /**
+     * @brief Write snapshot and deltas of computed rating periods and call the callback.
+     *
+     * @param[in]   first   First period, computed in one step up to last.
+     * @param[in]   last    Last period.
+     * @param[in]   players Players with games in the periods, when writing deltas.
+     */
+    void FinishPeriods(std::uint64_t first, std::uint64_t last, const std::vector<IDTYPE> &players)
+    {
+        // a snapshot is due if one of the periods k has (k+1) % every == 0
+        if(!m_SnapshotPrefix.empty() && (last + 1)/m_SnapshotEvery > first/m_SnapshotEvery)
+        {
+            m_Engine.SaveSnapshot(m_SnapshotPrefix + std::to_string(last) + ".snapshot");
+        }
+        if(m_Deltas.is_open())
+        {
+            for(const auto & id : players)
+            {
+                if(m_Engine.HasPlayer(id))
+                {
+                    m_Deltas << last << ',' << id << ',' << m_Engine.GetRating(id) << ','
+                             << m_Engine.GetDeviation(id) << ',' << m_Engine.GetVolatility(id) << '\n';
+                }
+            }
+        }
+        if(m_Callback)
+        {
+            m_Callback(last, m_Engine);
+        }
+    }
+    Engine &                    m_Engine;               ///< The engine.
+    std::int64_t                m_Start;                ///< Start time of the first period.
+    std::int64_t                m_PeriodLength;         ///< Length of a rating period.
+    Callback                    m_Callback;             ///< Called after each period.
+    std::string                 m_SnapshotPrefix;       ///< Prefix of snapshot files, empty for none.
+    std::uint64_t               m_SnapshotEvery{1};     ///< Write a snapshot every n periods.
+    std::string                 m_DeltaFileName;        ///< Name of the delta file, empty for none.
+    std::ofstream               m_Deltas;               ///< Delta file.
+    bool                        m_CollectPlayers{false};///< Collect the players of each period for the deltas.
+    std::size_t                 m_QueueDepth{2};        ///< Maximum number of buckets waiting for the computation.
+    std::mutex                  m_Mutex;                ///< Protects the members below.
+    std::condition_variable     m_Changed;              ///< Signals changes of the queue.
+    std::deque<Bucket>          m_Queue;                ///< Buckets waiting for the computation.
+    std::vector<Bucket>         m_Free;                 ///< Storage of computed buckets.
+    bool                        m_Done{false};          ///< Producer has finished.
+    bool                        m_Stop{false};          ///< Computation has failed, producer stops.
+    std::exception_ptr          m_Error;                ///< Exception of the producer.
+};
+
+} // namespace replay
+
+} // namespace glicko
+
+#endif // GLICKO_REPLAY_H
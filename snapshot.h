@@ -0,0 +1,282 @@
+/******************************************************************************//**
+ * @file
+ * @brief Binary snapshot format of the player table
+ *
+ * @copyright Copyright (C) by Doru Julian Bugariu
+ * julian@bugariu.eu
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the
+ * Free Software Foundation
+ * 51 Franklin Street, Fifth Floor
+ * Boston, MA 02110-1301, USA
+ * http://www.fsf.org/about/contact.html
+ *********************************************************************************/
+
+
+#ifndef GLICKO_SNAPSHOT_H
+#define GLICKO_SNAPSHOT_H
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "exception.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define GLICKO_HAS_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace glicko
+{
+
+namespace snapshot
+{
+
+constexpr char          MAGIC[8] = {'G', 'L', 'I', 'C', 'K', 'O', 'S', 'N'};   ///< File magic.
+constexpr std::uint32_t VERSION = 1;                                            ///< Current format version.
+constexpr std::uint32_t BYTE_ORDER_MARK = 0x01020304;                           ///< Detects files of other byte order.
+
+/**
+ * @brief File header.
+ *
+ * Followed by the ratings, the rating deviations and the rating volatilities
+ * (glicko2 scale, playerCount doubles each) and the IDs as written by IdCodec.
+ */
+struct Header
+{
+    char            magic[8];           ///< File magic.
+    std::uint32_t   version;            ///< Format version.
+    std::uint32_t   byteOrder;          ///< BYTE_ORDER_MARK.
+    std::uint32_t   idKind;             ///< IdCodec::KIND of the IDs.
+    std::uint32_t   idSize;             ///< IdCodec::SIZE of the IDs.
+    std::uint64_t   playerCount;        ///< Number of players.
+    std::uint64_t   idBytes;            ///< Size of the ID section in bytes.
+    double          defaultVolatility;  ///< Default rating volatility.
+    double          tau;                ///< Tau system constant.
+};
+
+
+/**
+ * @brief Codec for player IDs.
+ *
+ * Trivially copyable IDs are stored as raw array.
+ */
+template <typename IDTYPE, typename ENABLE = void> struct IdCodec;
+
+/**
+ * @brief Codec for trivially copyable IDs.
+ */
+template <typename IDTYPE> struct IdCodec<IDTYPE, std::enable_if_t<std::is_trivially_copyable<IDTYPE>::value>>
+{
+    static constexpr std::uint32_t KIND = 1;                ///< Raw IDs.
+    static constexpr std::uint32_t SIZE = sizeof(IDTYPE);   ///< Size of one ID.
+    /**
+     * @brief Write IDs.
+     *
+     * @param[out]  out     Output stream.
+     * @param[in]   ids     The IDs.
+     * @return              Number of bytes written.
+     */
+    static std::uint64_t Write(std::ostream &out, const std::vector<IDTYPE> &ids)
+    {
+        out.write(reinterpret_cast<const char *>(ids.data()), ids.size()*sizeof(IDTYPE));
+        return ids.size()*sizeof(IDTYPE);
+    }
+    /**
+     * @brief Read IDs.
+     *
+     * @param[in]   data    Start of ID section.
+     * @param[in]   size    Size of ID section in bytes.
+     * @param[in]   count   Number of IDs.
+     * @param[out]  ids     The IDs.
+     * @return              false if the section is malformed.
+     */
+    static bool Read(const char *data, std::uint64_t size, std::uint64_t count, std::vector<IDTYPE> &ids)
+    {
+        if(size != count*sizeof(IDTYPE))
+        {
+            return false;
+        }
+        ids.resize(count);
+        std::memcpy(ids.data(), data, size);
+        return true;
+    }
+};
+
+/**
+ * @brief Codec for string IDs.
+ *
+ * Stored as playerCount+1 offsets (uint64) followed by the characters of all IDs.
+ */
+template <> struct IdCodec<std::string>
+{
+    static constexpr std::uint32_t KIND = 2;    ///< String IDs.
+    static constexpr std::uint32_t SIZE = 0;    ///< Variable size.
+    /**
+     * @copydoc IdCodec<IDTYPE, std::enable_if_t<std::is_trivially_copyable<IDTYPE>::value>>::Write
+     */
+    static std::uint64_t Write(std::ostream &out, const std::vector<std::string> &ids)
+    {
+        std::vector<std::uint64_t> offsets(ids.size() + 1, 0);
+        for(std::size_t i = 0; i < ids.size(); ++i)
+        {
+            offsets[i + 1] = offsets[i] + ids[i].size();
+        }
+        out.write(reinterpret_cast<const char *>(offsets.data()), offsets.size()*sizeof(std::uint64_t));
+        for(const auto & id : ids)
+        {
+            out.write(id.data(), id.size());
+        }
+        return offsets.size()*sizeof(std::uint64_t) + offsets.back();
+    }
+    /**
+     * @copydoc IdCodec<IDTYPE, std::enable_if_t<std::is_trivially_copyable<IDTYPE>::value>>::Read
+     */
+    static bool Read(const char *data, std::uint64_t size, std::uint64_t count, std::vector<std::string> &ids)
+    {
+        if(count >= size/sizeof(std::uint64_t))
+        {
+            return false;
+        }
+        std::uint64_t offsetBytes = (count + 1)*sizeof(std::uint64_t);
+        std::vector<std::uint64_t> offsets(count + 1);
+        std::memcpy(offsets.data(), data, offsetBytes);
+        if(offsets[0] != 0 || offsets[count] != size - offsetBytes)
+        {
+            return false;
+        }
+        // all offsets must be valid before the first ID is filled, so none is beyond the characters
+        for(std::uint64_t i = 0; i < count; ++i)
+        {
+            if(offsets[i + 1] < offsets[i])
+            {
+                return false;
+            }
+        }
+        const char * chars = data + offsetBytes;
+        ids.resize(count);
+        for(std::uint64_t i = 0; i < count; ++i)
+        {
+            ids[i].assign(chars + offsets[i], offsets[i + 1] - offsets[i]);
+        }
+        return true;
+    }
+};
+
+
+/**
+ * @brief Read-only file mapped into memory.
+ *
+ * Uses mmap where available, else the file is read into a buffer.
+ */
+class MappedFile
+{
+public:
+    /**
+     * @brief Constructor.
+     *
+     * @throws glicko::GlickoException when the file cannot be opened.
+     * @param[in]   fileName    Name of the file.
+     */
+    explicit MappedFile(const std::string &fileName)
+    {
+#ifdef GLICKO_HAS_MMAP
+        int fd = ::open(fileName.c_str(), O_RDONLY);
+        if(fd < 0)
+        {
+            GLTHROW("Cannot open file " + fileName + ".");
+        }
+        struct stat info;
+        if(::fstat(fd, &info) != 0)
+        {
+            ::close(fd);
+            GLTHROW("Cannot read file " + fileName + ".");
+        }
+        m_Size = static_cast<std::size_t>(info.st_size);
+        if(m_Size > 0)
+        {
+            void * data = ::mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(data == MAP_FAILED)
+            {
+                ::close(fd);
+                GLTHROW("Cannot map file " + fileName + ".");
+            }
+            ::madvise(data, m_Size, MADV_SEQUENTIAL);
+            m_Data = static_cast<const char *>(data);
+        }
+        ::close(fd);
+#else
+        std::ifstream in{fileName, std::ios::binary};
+        if(!in)
+        {
+            GLTHROW("Cannot open file " + fileName + ".");
+        }
+        m_Buffer.assign(std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{});
+        m_Data = m_Buffer.data();
+        m_Size = m_Buffer.size();
+#endif
+    }
+    MappedFile(const MappedFile &) = delete;
+    MappedFile & operator=(const MappedFile &) = delete;
+    /**
+     * @brief Destructor.
+     */
+    ~MappedFile()
+    {
+#ifdef GLICKO_HAS_MMAP
+        if(m_Data)
+        {
+            ::munmap(const_cast<char *>(m_Data), m_Size);
+        }
+#endif
+    }
+    /**
+     * @brief Get file contents.
+     *
+     * @return  Start of file contents.
+     */
+    const char * GetData() const
+    {
+        return m_Data;
+    }
+    /**
+     * @brief Get file size.
+     *
+     * @return  Size in bytes.
+     */
+    std::size_t GetSize() const
+    {
+        return m_Size;
+    }
+private:
+    const char *        m_Data{nullptr};    ///< File contents.
+    std::size_t         m_Size{0};          ///< File size.
+#ifndef GLICKO_HAS_MMAP
+    std::vector<char>   m_Buffer;           ///< File contents if mmap is not available.
+#endif
+};
+
+} // namespace snapshot
+
+} // namespace glicko
+
+#endif // GLICKO_SNAPSHOT_H
@@ -0,0 +1,289 @@
+/******************************************************************************//**
+ * @file
+ * @brief Volatility solver for the glicko2 rating update
+ *
+ * @copyright Copyright (C) by Doru Julian Bugariu
+ * julian@bugariu.eu
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the
+ * Free Software Foundation
+ * 51 Franklin Street, Fifth Floor
+ * Boston, MA 02110-1301, USA
+ * http://www.fsf.org/about/contact.html
+ *********************************************************************************/
+
+
+#ifndef GLICKO_SOLVER_H
+#define GLICKO_SOLVER_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace glicko
+{
+
+/**
+ * @brief Root-finding method of the volatility solver.
+ */
+enum class SolverMethod
+{
+    Illinois,   ///< Illinois algorithm as described by Glickman.
+    Newton      ///< Newton's method, safeguarded by bisection. Usually needs fewer iterations.
+};
+
+
+/**
+ * @brief Settings of the volatility solver.
+ */
+struct SolverSettings
+{
+    SolverMethod    method{SolverMethod::Illinois};     ///< Root-finding method.
+    double          tolerance{0.000001};                ///< Convergence tolerance.
+    unsigned        maxIterations{100};                 ///< Maximum number of iterations of one solve.
+};
+
+
+/**
+ * @brief Statistics of the volatility solver.
+ */
+struct SolverStatistics
+{
+    std::uint64_t   solves{0};          ///< Number of solves.
+    std::uint64_t   iterations{0};      ///< Total number of iterations of all solves.
+    std::uint64_t   failures{0};        ///< Number of solves which did not converge.
+    /**
+     * @brief Add statistics.
+     *
+     * @param[in]   other   Statistics to add.
+     * @return              This object.
+     */
+    SolverStatistics & operator+=(const SolverStatistics &other)
+    {
+        solves += other.solves;
+        iterations += other.iterations;
+        failures += other.failures;
+        return *this;
+    }
+};
+
+
+/**
+ * @brief Solver for the new volatility of a player.
+ *
+ * Finds the root of f(x) (step 5 of the glicko2 algorithm) with a bounded
+ * number of iterations. Each evaluation of f computes exp(x) only once.
+ */
+class VolatilitySolver
+{
+public:
+    /**
+     * @brief Constructor.
+     *
+     * @param[in]   tau         Tau system constant.
+     * @param[in]   settings    Solver settings.
+     */
+    VolatilitySolver(double tau, const SolverSettings &settings):
+        m_Tau{tau},
+        m_InverseTauSquare{1/(tau*tau)},
+        m_Settings{settings}
+    {
+    }
+    /**
+     * @brief Compute new volatility.
+     *
+     * If no bracket for the root is found or the solver does not converge within
+     * the maximum number of iterations, the current volatility is returned.
+     * @param[in]       sigma       Current volatility.
+     * @param[in]       phi         Current rating deviation (glicko2 scale).
+     * @param[in]       v           Estimated variance of the player's rating.
+     * @param[in]       delta       Estimated improvement in rating.
+     * @param[in,out]   statistics  Statistics to update.
+     * @return                      New volatility.
+     */
+    double Solve(double sigma, double phi, double v, double delta, SolverStatistics &statistics) const
+    {
+        Function f{delta*delta - phi*phi - v, phi*phi + v, log(sigma*sigma), m_InverseTauSquare};
+        ++statistics.solves;
+        // bracket the root
+        unsigned iterations = 0;
+        double A = f.a;
+        double B = 0;
+        if(f.d > 0)
+        {
+            B = log(f.d);
+        }
+        else
+        {
+            double k = 1;
+            while(f(f.a - k*m_Tau) < 0)
+            {
+                if(++iterations >= m_Settings.maxIterations)
+                {
+                    statistics.iterations += iterations;
+                    ++statistics.failures;
+                    return sigma;
+                }
+                k++;
+            }
+            B = f.a - k*m_Tau;
+        }
+        double result = 0;
+        bool converged = (m_Settings.method == SolverMethod::Newton) ? SolveNewton(f, A, B, result, iterations)
+                                                                     : SolveIllinois(f, A, B, result, iterations);
+        statistics.iterations += iterations;
+        if(!converged)
+        {
+            ++statistics.failures;
+            return sigma;
+        }
+        return exp(result/2);
+    }
+private:
+    /**
+     * @brief The function f(x) whose root is searched.
+     *
+     * Terms which do not depend on x are computed once per solve.
+     */
+    struct Function
+    {
+        double  d;                  ///< delta^2 - phi^2 - v.
+        double  c;                  ///< phi^2 + v.
+        double  a;                  ///< ln(sigma^2).
+        double  inverseTauSquare;   ///< 1/tau^2.
+        /**
+         * @brief Evaluate f.
+         *
+         * @param[in]   x   Argument.
+         * @return          f(x).
+         */
+        double operator()(double x) const
+        {
+            double ex = exp(x);
+            return ex*(d - ex)/(2*(c + ex)*(c + ex)) - (x - a)*inverseTauSquare;
+        }
+        /**
+         * @brief Evaluate f and its derivative.
+         *
+         * @param[in]   x           Argument.
+         * @param[out]  derivative  f'(x).
+         * @return                  f(x).
+         */
+        double operator()(double x, double &derivative) const
+        {
+            double ex = exp(x);
+            double ce = c + ex;
+            derivative = ex*((d - 2*ex)*ce - 2*ex*(d - ex))/(2*ce*ce*ce) - inverseTauSquare;
+            return ex*(d - ex)/(2*ce*ce) - (x - a)*inverseTauSquare;
+        }
+    };
+    double          m_Tau{0};               ///< Tau system constant.
+    double          m_InverseTauSquare{0};  ///< 1/tau^2.
+    SolverSettings  m_Settings;             ///< Solver settings.
+    /**
+     * @brief Illinois algorithm.
+     *
+     * @param[in]       f           The function.
+     * @param[in]       A           Start of bracket.
+     * @param[in]       B           End of bracket.
+     * @param[out]      result      Root.
+     * @param[in,out]   iterations  Iteration counter.
+     * @return                      true if converged.
+     */
+    bool SolveIllinois(const Function &f, double A, double B, double &result, unsigned &iterations) const
+    {
+        double fA = f(A);
+        double fB = f(B);
+        while(fabs(B-A) > m_Settings.tolerance)
+        {
+            if(++iterations > m_Settings.maxIterations)
+            {
+                result = A;
+                return false;
+            }
+            double C = A + (A - B)*fA/(fB-fA);
+            double fC = f(C);
+            if(fB*fC < 0)
+            {
+                A = B;
+                fA = fB;
+            }
+            else
+            {
+                fA = fA/2;
+            }
+            B = C;
+            fB = fC;
+        }
+        result = A;
+        return true;
+    }
+    /**
+     * @brief Newton's method, falling back to bisection when a step leaves the bracket.
+     *
+     * @param[in]       f           The function.
+     * @param[in]       A           Start of bracket.
+     * @param[in]       B           End of bracket.
+     * @param[out]      result      Root.
+     * @param[in,out]   iterations  Iteration counter.
+     * @return                      true if converged.
+     */
+    bool SolveNewton(const Function &f, double A, double B, double &result, unsigned &iterations) const
+    {
+        double x = A;
+        double derivative = 0;
+        double fx = f(x, derivative);
+        // f is decreasing: keep f(low) > 0 > f(high)
+        double low = A;
+        double high = B;
+        if(fx < 0)
+        {
+            std::swap(low, high);
+        }
+        for(;;)
+        {
+            if(++iterations > m_Settings.maxIterations)
+            {
+                result = x;
+                return false;
+            }
+            double next = x - fx/derivative;
+            if(!(next > std::min(low, high) && next < std::max(low, high)) || derivative >= 0)
+            {
+                // bisection step
+                next = (low + high)/2;
+            }
+            double step = next - x;
+            x = next;
+            fx = f(x, derivative);
+            if(fx > 0)
+            {
+                low = x;
+            }
+            else
+            {
+                high = x;
+            }
+            if(fabs(step) <= m_Settings.tolerance || fabs(high - low) <= m_Settings.tolerance || fx == 0)
+            {
+                result = x;
+                return true;
+            }
+        }
+    }
+};
+
+} // namespace glicko
+
+#endif // GLICKO_SOLVER_H
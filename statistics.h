@@ -0,0 +1,157 @@
+/******************************************************************************//**
+ * @file
+ * @brief Statistics of a rating period
+ *
+ * @copyright Copyright (C) by Doru Julian Bugariu
+ * julian@bugariu.eu
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the
+ * Free Software Foundation
+ * 51 Franklin Street, Fifth Floor
+ * Boston, MA 02110-1301, USA
+ * http://www.fsf.org/about/contact.html
+ *********************************************************************************/
+
+#ifndef GLICKO_STATISTICS_H
+#define GLICKO_STATISTICS_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+#include <string>
+
+#include "solver.h"
+
+namespace glicko
+{
+
+/**
+ * @brief Phase of a rating period.
+ */
+enum class Phase
+{
+    Merge,      ///< Moving games added by AddGameConcurrent to the game list.
+    Index,      ///< Resolving player IDs and grouping games by player.
+    Compute,    ///< Computing new values of all players.
+    Adopt,      ///< Taking over the new values.
+    Publish,    ///< Publishing the rating table (auto publish only).
+    Count       ///< Number of phases.
+};
+
+
+/**
+ * @brief Statistics of one rating period.
+ *
+ * Collected by Glicko only when the traits enable them (see BasicTraits::STATISTICS).
+ */
+struct PeriodStatistics
+{
+    static constexpr std::size_t ITERATION_BUCKETS = 17;    ///< Buckets of the iteration histogram, the last one holds all larger counts.
+    std::uint32_t   period{0};              ///< Number of the rating period, starting at 0.
+    std::uint64_t   activePlayers{0};       ///< Players with at least one game.
+    std::uint64_t   idlePlayers{0};         ///< Players without games.
+    std::uint64_t   games{0};               ///< Games used for the rating period.
+    std::uint64_t   unmatchedGames{0};      ///< Games skipped because a player ID did not match any player.
+    std::array<double, static_cast<std::size_t>(Phase::Count)> seconds{};  ///< Wall time of each phase.
+    SolverStatistics solver;                ///< Statistics of the volatility solver.
+    std::array<std::uint64_t, ITERATION_BUCKETS> iterations{};  ///< Number of solves by number of iterations.
+    /**
+     * @brief Get wall time of the rating period.
+     *
+     * @return  Sum of the wall times of all phases in seconds.
+     */
+    double GetTotalSeconds() const
+    {
+        double total = 0;
+        for(double phaseSeconds : seconds)
+        {
+            total += phaseSeconds;
+        }
+        return total;
+    }
+};
+
+
+/**
+ * @brief Get name of a phase.
+ *
+ * @param[in]   phase   The phase.
+ * @return              Lower case name.
+ */
+inline const char * GetPhaseName(Phase phase)
+{
+    switch(phase)
+    {
+    case Phase::Merge:
+        return "merge";
+    case Phase::Index:
+        return "index";
+    case Phase::Compute:
+        return "compute";
+    case Phase::Adopt:
+        return "adopt";
+    case Phase::Publish:
+        return "publish";
+    default:
+        return "unknown";
+    }
+}
+
+
+/**
+ * @brief Format statistics in the Prometheus text exposition format.
+ *
+ * @param[in]   statistics  Statistics of a rating period.
+ * @param[in]   prefix      Prefix of the metric names.
+ * @return                  The metrics, one per line.
+ */
+inline std::string FormatPrometheus(const PeriodStatistics &statistics, const std::string &prefix = "glicko")
+{
+    std::ostringstream out;
+    auto gauge = [&](const char *name, const char *help, auto value)
+    {
+        out << "# HELP " << prefix << "_" << name << " " << help << "\n";
+        out << "# TYPE " << prefix << "_" << name << " gauge\n";
+        out << prefix << "_" << name << " " << value << "\n";
+    };
+    gauge("period", "Number of the last rating period.", statistics.period);
+    gauge("active_players", "Players with games in the last rating period.", statistics.activePlayers);
+    gauge("idle_players", "Players without games in the last rating period.", statistics.idlePlayers);
+    gauge("games", "Games used in the last rating period.", statistics.games);
+    gauge("unmatched_games", "Games with unknown players in the last rating period.", statistics.unmatchedGames);
+    gauge("solver_failures", "Volatility solves without convergence in the last rating period.", statistics.solver.failures);
+    out << "# HELP " << prefix << "_phase_seconds Wall time of each phase of the last rating period.\n";
+    out << "# TYPE " << prefix << "_phase_seconds gauge\n";
+    for(std::size_t i = 0; i < statistics.seconds.size(); ++i)
+    {
+        out << prefix << "_phase_seconds{phase=\"" << GetPhaseName(static_cast<Phase>(i)) << "\"} " << statistics.seconds[i] << "\n";
+    }
+    out << "# HELP " << prefix << "_solver_iterations Iterations of each volatility solve in the last rating period.\n";
+    out << "# TYPE " << prefix << "_solver_iterations histogram\n";
+    std::uint64_t cumulative = 0;
+    for(std::size_t i = 0; i + 1 < statistics.iterations.size(); ++i)
+    {
+        cumulative += statistics.iterations[i];
+        out << prefix << "_solver_iterations_bucket{le=\"" << i << "\"} " << cumulative << "\n";
+    }
+    out << prefix << "_solver_iterations_bucket{le=\"+Inf\"} " << statistics.solver.solves << "\n";
+    out << prefix << "_solver_iterations_sum " << statistics.solver.iterations << "\n";
+    out << prefix << "_solver_iterations_count " << statistics.solver.solves << "\n";
+    return out.str();
+}
+
+} // namespace glicko
+
+#endif // GLICKO_STATISTICS_H
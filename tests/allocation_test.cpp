@@ -0,0 +1,146 @@
+/******************************************************************************//**
+ * @file
+ * @brief Heap allocations of a steady-state rating period
+ *
+ * @copyright Copyright (C) by Doru Julian Bugariu
+ * julian@bugariu.eu
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the
+ * Free Software Foundation
+ * 51 Franklin Street, Fifth Floor
+ * Boston, MA 02110-1301, USA
+ * http://www.fsf.org/about/contact.html
+ *********************************************************************************/
+
+#include "check.h"
+#include "glicko.h"
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+std::atomic<std::size_t> g_Allocations{0};    ///< Number of calls of operator new.
+
+} // namespace
+
+
+/**
+ * @brief Counting operator new.
+ *
+ * The other forms of operator new forward to this one. The operators are not
+ * inlined, GCC would otherwise see malloc/free and warn about mismatches.
+ * @param[in]   size    Size in bytes.
+ * @return              Allocated memory.
+ */
+__attribute__((noinline)) void *operator new(std::size_t size)
+{
+    g_Allocations.fetch_add(1, std::memory_order_relaxed);
+    if(void *pointer = std::malloc(size ? size : 1))
+    {
+        return pointer;
+    }
+    throw std::bad_alloc{};
+}
+
+
+/**
+ * @brief Release memory of the counting operator new.
+ *
+ * @param[in]   pointer Memory to release.
+ */
+__attribute__((noinline)) void operator delete(void *pointer) noexcept
+{
+    std::free(pointer);
+}
+
+
+/**
+ * @brief Release memory of the counting operator new.
+ *
+ * @param[in]   pointer Memory to release.
+ */
+__attribute__((noinline)) void operator delete(void *pointer, std::size_t) noexcept
+{
+    std::free(pointer);
+}
+
+
+namespace
+{
+
+/**
+ * @brief A game of the test period.
+ */
+struct Game
+{
+    int                 player1;    ///< ID of player 1.
+    int                 player2;    ///< ID of player 2.
+    glicko::GameResult  result;     ///< Game result.
+};
+
+
+/**
+ * @brief Count allocations of a rating period after the buffers have grown.
+ *
+ * @param[in]   threads     Number of threads.
+ */
+void TestSteadyState(unsigned threads)
+{
+    const int playerCount = 2000;
+    std::mt19937 rng{threads};
+    std::vector<Game> games(20000);
+    for(Game &game : games)
+    {
+        game = {static_cast<int>(rng() % playerCount), static_cast<int>(rng() % playerCount), static_cast<glicko::GameResult>(rng() % 3)};
+    }
+    glicko::Glicko<int> glicko{0.06, 0.5};
+    glicko.SetThreadCount(threads);
+    glicko.Reserve(playerCount, games.size());
+    for(int i = 0; i < playerCount; ++i)
+    {
+        glicko.CreatePlayer(i);
+    }
+    for(int period = 0; period < 5; ++period)
+    {
+        std::size_t before = g_Allocations.load();
+        for(const Game &game : games)
+        {
+            glicko.AddGame(game.player1, game.player2, game.result);
+        }
+        glicko.ComputeRatings();
+        std::size_t allocations = g_Allocations.load() - before;
+        std::printf("threads %u, period %d: %zu allocations\n", threads, period, allocations);
+        // the first period grows the buffers and starts the threads
+        if(period > 0)
+        {
+            CHECK(allocations == 0);
+        }
+    }
+}
+
+} // namespace
+
+
+int main()
+{
+    TestSteadyState(1);
+    TestSteadyState(4);
+    return glicko::test::Result();
+}
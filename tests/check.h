@@ -0,0 +1,104 @@
+/******************************************************************************//**
+ * @file
+ * @brief Minimal checks for the tests
+ *
+ * @copyright Copyright (C) by Doru Julian Bugariu
+ * julian@bugariu.eu
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the
+ * Free Software Foundation
+ * 51 Franklin Street, Fifth Floor
+ * Boston, MA 02110-1301, USA
+ * http://www.fsf.org/about/contact.html
+ *********************************************************************************/
+
+
+#ifndef GLICKO_TESTS_CHECK_H
+#define GLICKO_TESTS_CHECK_H
+
+#include <cstdio>
+
+namespace glicko
+{
+
+namespace test
+{
+
+inline int g_Failures = 0;  ///< Number of failed checks.
+
+/**
+ * @brief Record the result of a check.
+ *
+ * @param[in]   ok          Result of the check.
+ * @param[in]   expression  The checked expression.
+ * @param[in]   fileName    Source file of the check.
+ * @param[in]   line        Source line of the check.
+ * @return                  ok.
+ */
+inline bool Check(bool ok, const char *expression, const char *fileName, int line)
+{
+    if(!ok)
+    {
+        std::fprintf(stderr, "%s:%d: check failed: %s\n", fileName, line, expression);
+        ++g_Failures;
+    }
+    return ok;
+}
+
+/**
+ * @brief Report the checks, to be returned from main.
+ *
+ * @return  0 if all checks passed, else 1.
+ */
+inline int Result()
+{
+    if(g_Failures > 0)
+    {
+        std::fprintf(stderr, "%d checks failed\n", g_Failures);
+        return 1;
+    }
+    return 0;
+}
+
+} // namespace test
+
+} // namespace glicko
+
+/**
+ * @brief Check a condition, continue with the test on failure.
+ * @param[in] condition     The condition.
+ */
+#define CHECK(condition) glicko::test::Check((condition), #condition, __FILE__, __LINE__)
+
+/**
+ * @brief Check that a statement throws glicko::GlickoException.
+ * @param[in] statement     The statement.
+ */
+#define CHECK_THROWS(statement) \
+    do \
+    { \
+        bool thrown = false; \
+        try \
+        { \
+            statement; \
+        } \
+        catch(const glicko::GlickoException &) \
+        { \
+            thrown = true; \
+        } \
+        glicko::test::Check(thrown, #statement " throws", __FILE__, __LINE__); \
+    } \
+    while(false)
+
+#endif // GLICKO_TESTS_CHECK_H
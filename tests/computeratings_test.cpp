@@ -0,0 +1,321 @@
+/******************************************************************************//**
+ * @file
+ * @brief Rating periods compared with the original per-player scan
+ *
+ * @copyright Copyright (C) by Doru Julian Bugariu
+ * julian@bugariu.eu
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the
+ * Free Software Foundation
+ * 51 Franklin Street, Fifth Floor
+ * Boston, MA 02110-1301, USA
+ * http://www.fsf.org/about/contact.html
+ *********************************************************************************/
+
+#include "check.h"
+#include "glicko.h"
+
+#include <cmath>
+#include <list>
+#include <map>
+#include <random>
+
+namespace
+{
+
+/**
+ * @brief The original algorithm: for each player, scan all games of the rating period.
+ *
+ * O(players × games), kept as reference for the game index of Glicko.
+ */
+class Reference
+{
+public:
+    /**
+     * @brief Constructor.
+     *
+     * @param[in]   volatility  Initial rating volatility.
+     * @param[in]   tau         Tau system constant.
+     */
+    Reference(double volatility, double tau):
+        m_Volatility{volatility},
+        m_Tau{tau}
+    {
+    }
+    /**
+     * @brief Create a player (glicko scale).
+     *
+     * @param[in]   id          ID of the player.
+     * @param[in]   rating      Rating.
+     * @param[in]   deviation   Rating deviation.
+     * @param[in]   volatility  Rating volatility.
+     */
+    void CreatePlayer(int id, double rating, double deviation, double volatility)
+    {
+        m_Players[id] = {(rating - 1500)/glicko::config::GLICO_CONSTANT, deviation/glicko::config::GLICO_CONSTANT, volatility, 0, 0, 0};
+    }
+    /**
+     * @brief Create a player with default values.
+     *
+     * @param[in]   id  ID of the player.
+     */
+    void CreatePlayer(int id)
+    {
+        CreatePlayer(id, 1500, 350, m_Volatility);
+    }
+    /**
+     * @brief Add a game.
+     *
+     * @param[in]   player1     ID of player 1.
+     * @param[in]   player2     ID of player 2.
+     * @param[in]   result      Game result.
+     */
+    void AddGame(int player1, int player2, glicko::GameResult result)
+    {
+        m_Games.push_back({player1, player2, result});
+    }
+    /**
+     * @brief Compute a rating period.
+     */
+    void ComputeRatings()
+    {
+        for(auto & entry : m_Players)
+        {
+            Player & player = entry.second;
+            double v = 0;
+            double delta = 0;
+            bool played = false;
+            for(const Game & game : m_Games)
+            {
+                int opponentID = 0;
+                double s = 0;
+                if(game.player1 == entry.first)
+                {
+                    opponentID = game.player2;
+                    s = (game.result == glicko::GameResult::Player1) ? 1 : ((game.result == glicko::GameResult::Draw) ? 0.5 : 0);
+                }
+                else if(game.player2 == entry.first)
+                {
+                    opponentID = game.player1;
+                    s = (game.result == glicko::GameResult::Player2) ? 1 : ((game.result == glicko::GameResult::Draw) ? 0.5 : 0);
+                }
+                else
+                {
+                    continue;
+                }
+                auto opponent = m_Players.find(opponentID);
+                if(opponent == m_Players.end() || m_Players.count(entry.first) == 0)
+                {
+                    continue;
+                }
+                double mu = opponent->second.mu;
+                double phi = opponent->second.phi;
+                double g = 1/sqrt(1 + 3*phi*phi/M_PI/M_PI);
+                double E = 1/(1 + exp(-g*(player.mu - mu)));
+                v += g*g*E*(1 - E);
+                delta += g*(s - E);
+                played = true;
+            }
+            double phi = player.phi;
+            double sigma = player.sigma;
+            if(!played)
+            {
+                player.newMu = player.mu;
+                player.newPhi = sqrt(phi*phi + sigma*sigma);
+                player.newSigma = sigma;
+                continue;
+            }
+            v = 1/v;
+            delta = v*delta;
+            // Illinois iteration of the paper
+            double a = log(sigma*sigma);
+            double A = a;
+            double B = 0;
+            if(delta*delta > phi*phi + v)
+            {
+                B = log(delta*delta - phi*phi - v);
+            }
+            else
+            {
+                double k = 1;
+                while(F(a - k*m_Tau, delta, phi, v, a) < 0)
+                {
+                    k++;
+                }
+                B = a - k*m_Tau;
+            }
+            double fA = F(A, delta, phi, v, a);
+            double fB = F(B, delta, phi, v, a);
+            while(fabs(B - A) > 0.000001)
+            {
+                double C = A + (A - B)*fA/(fB - fA);
+                double fC = F(C, delta, phi, v, a);
+                if(fB*fC < 0)
+                {
+                    A = B;
+                    fA = fB;
+                }
+                else
+                {
+                    fA = fA/2;
+                }
+                B = C;
+                fB = fC;
+            }
+            player.newSigma = exp(A/2);
+            double phiStarSquare = phi*phi + player.newSigma*player.newSigma;
+            player.newPhi = 1/sqrt(1/phiStarSquare + 1/v);
+            player.newMu = player.mu + player.newPhi*player.newPhi*delta/v;
+        }
+        for(auto & entry : m_Players)
+        {
+            entry.second.mu = entry.second.newMu;
+            entry.second.phi = entry.second.newPhi;
+            entry.second.sigma = entry.second.newSigma;
+        }
+        m_Games.clear();
+    }
+    /**
+     * @brief Get values of a player (glicko scale).
+     *
+     * @param[in]   id  ID of the player.
+     * @return          Rating, rating deviation and rating volatility.
+     */
+    glicko::Glicko<int>::Rating Get(int id) const
+    {
+        const Player & player = m_Players.at(id);
+        return {glicko::config::GLICO_CONSTANT*player.mu + 1500, glicko::config::GLICO_CONSTANT*player.phi, player.sigma};
+    }
+private:
+    /**
+     * @brief A player (glicko2 scale).
+     */
+    struct Player
+    {
+        double  mu;         ///< Rating.
+        double  phi;        ///< Rating deviation.
+        double  sigma;      ///< Rating volatility.
+        double  newMu;      ///< New rating.
+        double  newPhi;     ///< New rating deviation.
+        double  newSigma;   ///< New rating volatility.
+    };
+    /**
+     * @brief A game.
+     */
+    struct Game
+    {
+        int                 player1;    ///< ID of player 1.
+        int                 player2;    ///< ID of player 2.
+        glicko::GameResult  result;     ///< Game result.
+    };
+    /**
+     * @brief Function of the volatility iteration.
+     */
+    double F(double x, double delta, double phi, double v, double a) const
+    {
+        return exp(x)*(delta*delta - phi*phi - v - exp(x))/2/(phi*phi + v + exp(x))/(phi*phi + v + exp(x)) - (x - a)/m_Tau/m_Tau;
+    }
+    std::map<int, Player>   m_Players;      ///< The players.
+    std::list<Game>         m_Games;        ///< Games of the rating period.
+    double                  m_Volatility;   ///< Initial rating volatility.
+    double                  m_Tau;          ///< Tau system constant.
+};
+
+
+/**
+ * @brief Check that two values agree up to rounding.
+ *
+ * The kernel folds 3/pi^2 into one constant, so the last bits may differ.
+ * @param[in]   a   First value.
+ * @param[in]   b   Second value.
+ * @return          true if the relative difference is below 1e-9.
+ */
+bool Near(double a, double b)
+{
+    return std::abs(a - b) <= 1e-9*std::max(1.0, std::abs(b));
+}
+
+
+/**
+ * @brief Play a randomized tournament on the engine and the reference.
+ *
+ * Includes games of unknown players and games of a player against itself.
+ * @param[in]   seed        Random seed.
+ * @param[in]   threads     Threads of the engine.
+ */
+void RunTournament(unsigned seed, unsigned threads)
+{
+    std::mt19937 rng{seed};
+    glicko::Glicko<int> engine{0.06, 0.5};
+    engine.SetThreadCount(threads);
+    glicko::Glicko<int> single{0.06, 0.5};
+    Reference reference{0.06, 0.5};
+    int playerCount = 100 + static_cast<int>(rng() % 300);
+    for(int i = 0; i < playerCount; ++i)
+    {
+        if(i % 3 == 0)
+        {
+            double rating = 1200 + rng() % 800;
+            double deviation = 30 + rng() % 320;
+            engine.CreatePlayer(i, rating, deviation, 0.06);
+            single.CreatePlayer(i, rating, deviation, 0.06);
+            reference.CreatePlayer(i, rating, deviation, 0.06);
+        }
+        else
+        {
+            engine.CreatePlayer(i);
+            single.CreatePlayer(i);
+            reference.CreatePlayer(i);
+        }
+    }
+    for(int period = 0; period < 6; ++period)
+    {
+        int gameCount = 50 + static_cast<int>(rng() % 1000);
+        for(int k = 0; k < gameCount; ++k)
+        {
+            int player1 = static_cast<int>(rng() % (playerCount + 10));
+            int player2 = (k % 50 == 0) ? player1 : static_cast<int>(rng() % (playerCount + 10));
+            auto result = static_cast<glicko::GameResult>(rng() % 3);
+            engine.AddGame(player1, player2, result);
+            single.AddGame(player1, player2, result);
+            reference.AddGame(player1, player2, result);
+        }
+        engine.ComputeRatings();
+        single.ComputeRatings();
+        reference.ComputeRatings();
+    }
+    for(int i = 0; i < playerCount; ++i)
+    {
+        auto expected = reference.Get(i);
+        CHECK(Near(engine.GetRating(i), expected.rating));
+        CHECK(Near(engine.GetDeviation(i), expected.deviation));
+        CHECK(Near(engine.GetVolatility(i), expected.volatility));
+        // the results do not depend on the number of threads
+        CHECK(engine.GetRating(i) == single.GetRating(i));
+        CHECK(engine.GetDeviation(i) == single.GetDeviation(i));
+        CHECK(engine.GetVolatility(i) == single.GetVolatility(i));
+    }
+}
+
+} // namespace
+
+
+int main()
+{
+    for(unsigned seed = 1; seed <= 10; ++seed)
+    {
+        RunTournament(seed, 1 + seed % 4);
+    }
+    return glicko::test::Result();
+}
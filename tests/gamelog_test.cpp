@@ -0,0 +1,166 @@
+/******************************************************************************//**
+ * @file
+ * @brief Reading valid, truncated and corrupt game logs
+ *
+ * @copyright Copyright (C) by Doru Julian Bugariu
+ * julian@bugariu.eu
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the
+ * Free Software Foundation
+ * 51 Franklin Street, Fifth Floor
+ * Boston, MA 02110-1301, USA
+ * http://www.fsf.org/about/contact.html
+ *********************************************************************************/
+
+#include "check.h"
+#include "glicko.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+const char * const FILE_NAME = "gamelog_test.log";   ///< Name of the test log.
+
+
+/**
+ * @brief Read all games of a log with Reader and with View.
+ *
+ * @param[out]  games   Games read by Reader.
+ * @return              Number of games parsed by View, must equal games.size().
+ */
+std::size_t ReadLog(std::vector<glicko::gamelog::Record<std::string>> &games)
+{
+    glicko::gamelog::Reader<std::string> reader{FILE_NAME};
+    games.clear();
+    std::vector<glicko::gamelog::Record<std::string>> chunk;
+    while(reader.Read(chunk, 3))
+    {
+        games.insert(games.end(), chunk.begin(), chunk.end());
+    }
+    std::ifstream in{FILE_NAME, std::ios::binary};
+    std::string content{std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{}};
+    glicko::gamelog::View<std::string> view{content, FILE_NAME};
+    std::string_view player1, player2;
+    glicko::GameResult result;
+    std::size_t count = 0;
+    while(view.Next(player1, player2, result))
+    {
+        CHECK(count < games.size() && player1 == games[count].player1 && player2 == games[count].player2 && result == games[count].result);
+        ++count;
+    }
+    return count;
+}
+
+
+/**
+ * @brief Write a file.
+ *
+ * @param[in]   content     Content of the file.
+ */
+void WriteFile(const std::string &content)
+{
+    std::ofstream out{FILE_NAME, std::ios::binary | std::ios::trunc};
+    out.write(content.data(), static_cast<std::streamsize>(content.size()));
+}
+
+} // namespace
+
+
+int main()
+{
+    std::vector<glicko::gamelog::Record<std::string>> written;
+    for(int i = 0; i < 10; ++i)
+    {
+        written.push_back({"player-" + std::to_string(i), std::string(i, 'x'), static_cast<glicko::GameResult>(i % 3)});
+    }
+    {
+        glicko::gamelog::Writer<std::string> writer{FILE_NAME};
+        for(const auto & game : written)
+        {
+            writer.Write(game.player1, game.player2, game.result);
+        }
+        writer.Close();
+    }
+    std::vector<glicko::gamelog::Record<std::string>> games;
+    CHECK(ReadLog(games) == written.size());
+    CHECK(games.size() == written.size());
+    for(std::size_t i = 0; i < games.size() && i < written.size(); ++i)
+    {
+        CHECK(games[i].player1 == written[i].player1 && games[i].player2 == written[i].player2 && games[i].result == written[i].result);
+    }
+    std::ifstream in{FILE_NAME, std::ios::binary};
+    const std::string content{std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{}};
+    in.close();
+    // every truncation within a game, a log ending between games is valid
+    std::size_t end = sizeof(glicko::gamelog::Header);
+    for(const auto & game : written)
+    {
+        std::size_t begin = end;
+        end += 2*sizeof(std::uint32_t) + game.player1.size() + game.player2.size() + 1;
+        for(std::size_t size = begin + 1; size < end; ++size)
+        {
+            WriteFile(content.substr(0, size));
+            CHECK_THROWS(ReadLog(games));
+        }
+    }
+    CHECK(end == content.size());
+    // string length beyond the end of the file, must not allocate it
+    std::string corrupt = content.substr(0, sizeof(glicko::gamelog::Header));
+    const std::uint32_t length = 0xfffffff0;
+    corrupt.append(reinterpret_cast<const char *>(&length), sizeof(length));
+    corrupt.append(16, 'x');
+    WriteFile(corrupt);
+    CHECK_THROWS(ReadLog(games));
+    // invalid result
+    corrupt = content;
+    corrupt.back() = 3;
+    WriteFile(corrupt);
+    CHECK_THROWS(ReadLog(games));
+    // rating period from a truncated log, then a normal rating period
+    glicko::Glicko<std::string> engine{0.06, 0.5};
+    glicko::Glicko<std::string> expected{0.06, 0.5};
+    for(const auto & game : written)
+    {
+        for(const std::string & id : {game.player1, game.player2})
+        {
+            if(!engine.HasPlayer(id))
+            {
+                engine.CreatePlayer(id);
+                expected.CreatePlayer(id);
+            }
+        }
+    }
+    WriteFile(content.substr(0, content.size() - 1));
+    glicko::gamelog::Reader<std::string> reader{FILE_NAME};
+    CHECK_THROWS(engine.ComputeRatings(reader, 4));
+    for(const auto & game : written)
+    {
+        engine.AddGame(game.player2, game.player1, game.result);
+        expected.AddGame(game.player2, game.player1, game.result);
+    }
+    engine.ComputeRatings();
+    expected.ComputeRatings();
+    for(const auto & game : written)
+    {
+        CHECK(engine.GetRating(game.player1) == expected.GetRating(game.player1));
+        CHECK(engine.GetDeviation(game.player1) == expected.GetDeviation(game.player1));
+    }
+    std::remove(FILE_NAME);
+    return glicko::test::Result();
+}
@@ -0,0 +1,177 @@
+/******************************************************************************//**
+ * @file
+ * @brief Slot index compared with the ordered index
+ *
+ * @copyright Copyright (C) by Doru Julian Bugariu
+ * julian@bugariu.eu
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the
+ * Free Software Foundation
+ * 51 Franklin Street, Fifth Floor
+ * Boston, MA 02110-1301, USA
+ * http://www.fsf.org/about/contact.html
+ *********************************************************************************/
+
+#include "check.h"
+#include "glicko.h"
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+/**
+ * @brief Hash putting all IDs into one probe sequence.
+ */
+struct CollidingHash
+{
+    /**
+     * @brief Hash an ID.
+     *
+     * @param[in]   id  ID of the player.
+     * @return          Hash value.
+     */
+    std::size_t operator()(int id) const
+    {
+        return static_cast<std::size_t>(id % 3);
+    }
+};
+
+
+/**
+ * @brief Configuration with the ordered index.
+ */
+struct OrderedIndexTraits : glicko::DefaultTraits
+{
+    template <typename IDTYPE> using index_type = glicko::index::OrderedIndex<IDTYPE>;  ///< Index of the players.
+};
+
+
+/**
+ * @brief Insert and erase in a slot index with colliding hashes, compare with an ordered index.
+ */
+void TestCollisions()
+{
+    glicko::index::SlotIndex<int, CollidingHash> index;
+    glicko::index::OrderedIndex<int> expected;
+    std::vector<int> ids;
+    for(int i = 0; i < 300; ++i)
+    {
+        CHECK(index.Insert(7*i, ids.size(), ids));
+        expected.Insert(7*i, ids.size());
+        ids.push_back(7*i);
+    }
+    CHECK(!index.Insert(14, ids.size(), ids));
+    for(int i = 0; i < 300; i += 2)
+    {
+        index.Erase(7*i, ids);
+        expected.Erase(7*i);
+    }
+    index.Erase(1, ids);
+    CHECK(index.Size() == expected.Size());
+    for(int id = -10; id < 7*300 + 10; ++id)
+    {
+        CHECK(index.Find(id, ids) == expected.Find(id));
+    }
+}
+
+
+/**
+ * @brief Create, remove and compact players, compare with an engine with the ordered index.
+ *
+ * @param[in]   makeID  Function making the ID of player i.
+ */
+template <typename IDTYPE, typename FUNCTION>
+void TestEngine(FUNCTION makeID)
+{
+    static_assert(glicko::index::UsesIDs<typename glicko::Glicko<IDTYPE>::index_type>::value, "SlotIndex is the default.");
+    const int count = 3000;
+    glicko::Glicko<IDTYPE> engine{0.06, 0.5};
+    glicko::Glicko<IDTYPE, OrderedIndexTraits> expected{0.06, 0.5};
+    for(int i = 0; i < count; ++i)
+    {
+        engine.CreatePlayer(makeID(i));
+        expected.CreatePlayer(makeID(i));
+    }
+    for(int i = 0; i < count; ++i)
+    {
+        engine.AddGame(makeID(i), makeID((7*i + 1) % count), glicko::GameResult::Player1);
+        expected.AddGame(makeID(i), makeID((7*i + 1) % count), glicko::GameResult::Player1);
+    }
+    engine.ComputeRatings();
+    expected.ComputeRatings();
+    engine.PublishRatings();
+    auto table = engine.GetRatingTable();
+    // remove every third player, compact and create some of them again
+    for(int i = 0; i < count; i += 3)
+    {
+        engine.RemovePlayer(makeID(i));
+        expected.RemovePlayer(makeID(i));
+    }
+    CHECK(engine.Compact(2*count) == 0);
+    CHECK(expected.Compact(2*count) == 0);
+    for(int i = 0; i < count; i += 6)
+    {
+        engine.CreatePlayer(makeID(i));
+        expected.CreatePlayer(makeID(i));
+    }
+    CHECK_THROWS(engine.CreatePlayer(makeID(1)));
+    CHECK(engine.GetPlayerCount() == expected.GetPlayerCount());
+    for(int i = 0; i < count; ++i)
+    {
+        CHECK(engine.HasPlayer(makeID(i)) == expected.HasPlayer(makeID(i)));
+        if(expected.HasPlayer(makeID(i)))
+        {
+            CHECK(engine.GetRating(makeID(i)) == expected.GetRating(makeID(i)));
+            CHECK(engine.GetDeviation(makeID(i)) == expected.GetDeviation(makeID(i)));
+        }
+    }
+    // the table published before keeps the players of its time
+    for(int i = 0; i < count; ++i)
+    {
+        typename glicko::Glicko<IDTYPE>::Rating rating{};
+        CHECK(table->Find(makeID(i), rating));
+    }
+    engine.PublishRatings();
+    expected.PublishRatings();
+    auto newTable = engine.GetRatingTable();
+    auto expectedTable = expected.GetRatingTable();
+    CHECK(newTable->Size() == expectedTable->Size());
+    for(int i = 0; i < count; ++i)
+    {
+        typename glicko::Glicko<IDTYPE>::Rating rating{};
+        typename glicko::Glicko<IDTYPE, OrderedIndexTraits>::Rating expectedRating{};
+        CHECK(newTable->Find(makeID(i), rating) == expectedTable->Find(makeID(i), expectedRating));
+        CHECK(rating.rating == expectedRating.rating);
+    }
+}
+
+} // namespace
+
+
+int main()
+{
+    TestCollisions();
+    TestEngine<int>([](int i)
+    {
+        return i;
+    });
+    TestEngine<std::string>([](int i)
+    {
+        return "player" + std::to_string(i);
+    });
+    return glicko::test::Result();
+}
@@ -0,0 +1,129 @@
+/******************************************************************************//**
+ * @file
+ * @brief Vector kernels compared with the scalar kernel
+ *
+ * @copyright Copyright (C) by Doru Julian Bugariu
+ * julian@bugariu.eu
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the
+ * Free Software Foundation
+ * 51 Franklin Street, Fifth Floor
+ * Boston, MA 02110-1301, USA
+ * http://www.fsf.org/about/contact.html
+ *********************************************************************************/
+
+#include "check.h"
+#include "kernel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace
+{
+
+/**
+ * @brief Check that a value agrees with the scalar result.
+ *
+ * @param[in]   value       Value of the vector kernel.
+ * @param[in]   expected    Value of the scalar kernel.
+ * @param[in]   scale       Magnitude of the summed terms.
+ * @return                  true if the difference is below 1e-12 of the scale.
+ */
+bool Near(double value, double expected, double scale)
+{
+    return std::abs(value - expected) <= 1e-12*std::max(scale, std::abs(expected));
+}
+
+
+/**
+ * @brief Compare a kernel with ComputeScalar and PredictScalar.
+ *
+ * Game counts cover the vector tails, ratings cover expected scores close to 0 and 1.
+ * @param[in]   kernel  The kernel, must be supported.
+ * @param[in]   name    Name for the output.
+ */
+void TestKernel(glicko::Kernel kernel, const char *name)
+{
+    std::printf("testing kernel %s\n", name);
+    glicko::kernel::Function compute = glicko::kernel::Select(kernel);
+    glicko::kernel::PredictionFunction predict = glicko::kernel::SelectPrediction(kernel);
+    std::mt19937_64 rng{4};
+    std::uniform_real_distribution<double> muDistribution{-6, 6};
+    std::uniform_real_distribution<double> phiDistribution{0.05, 2.5};
+    for(std::size_t count = 1; count <= 70; ++count)
+    {
+        for(int round = 0; round < 20; ++round)
+        {
+            std::vector<double> oppMu(count), oppPhi(count), scores(count);
+            for(std::size_t i = 0; i < count; ++i)
+            {
+                oppMu[i] = muDistribution(rng);
+                oppPhi[i] = phiDistribution(rng);
+                scores[i] = static_cast<double>(rng() % 3)/2;
+            }
+            // extreme rating differences in the last round
+            double mu = (round == 19) ? 40.0 : muDistribution(rng);
+            double v = 0, delta = 0, expectedV = 0, expectedDelta = 0;
+            compute(mu, oppMu.data(), oppPhi.data(), scores.data(), count, v, delta);
+            glicko::kernel::ComputeScalar(mu, oppMu.data(), oppPhi.data(), scores.data(), count, expectedV, expectedDelta);
+            CHECK(Near(v, expectedV, 0));
+            CHECK(Near(delta, expectedDelta, expectedV*static_cast<double>(count)));
+            // games added one by one give the same sums as the scalar kernel
+            double sumV = 0, sumDelta = 0;
+            for(std::size_t i = 0; i < count; ++i)
+            {
+                glicko::kernel::AccumulateScalar(mu, oppMu[i], oppPhi[i], scores[i], sumV, sumDelta);
+            }
+            CHECK(1/sumV == expectedV);
+            CHECK(expectedV*sumDelta == expectedDelta);
+            double phi = phiDistribution(rng);
+            std::vector<double> expected(count), quality(count), scalarExpected(count), scalarQuality(count);
+            predict(mu, phi, oppMu.data(), oppPhi.data(), count, expected.data(), quality.data());
+            glicko::kernel::PredictScalar(mu, phi, oppMu.data(), oppPhi.data(), count, scalarExpected.data(), scalarQuality.data());
+            for(std::size_t i = 0; i < count; ++i)
+            {
+                CHECK(Near(expected[i], scalarExpected[i], 1e-300));
+                CHECK(Near(quality[i], scalarQuality[i], 1e-300));
+            }
+        }
+    }
+}
+
+} // namespace
+
+
+int main()
+{
+    TestKernel(glicko::Kernel::Scalar, "Scalar");
+    if(glicko::kernel::IsSupported(glicko::Kernel::AVX2))
+    {
+        TestKernel(glicko::Kernel::AVX2, "AVX2");
+    }
+    else
+    {
+        std::printf("AVX2 not supported, skipped\n");
+    }
+    if(glicko::kernel::IsSupported(glicko::Kernel::AVX512))
+    {
+        TestKernel(glicko::Kernel::AVX512, "AVX512");
+    }
+    else
+    {
+        std::printf("AVX512 not supported, skipped\n");
+    }
+    return glicko::test::Result();
+}
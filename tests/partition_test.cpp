@@ -0,0 +1,148 @@
+/******************************************************************************//**
+ * @file
+ * @brief Partitioned engine compared with a single engine
+ *
+ * @copyright Copyright (C) by Doru Julian Bugariu
+ * julian@bugariu.eu
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the
+ * Free Software Foundation
+ * 51 Franklin Street, Fifth Floor
+ * Boston, MA 02110-1301, USA
+ * http://www.fsf.org/about/contact.html
+ *********************************************************************************/
+
+#include "check.h"
+#include "partition.h"
+
+#include <cstdio>
+#include <random>
+#include <string>
+#include <type_traits>
+
+namespace
+{
+
+/**
+ * @brief Make the ID of the i-th player.
+ *
+ * @param[in]   i   Number of the player.
+ * @return          The ID.
+ */
+template <typename IDTYPE> IDTYPE MakeID(std::size_t i)
+{
+    if constexpr(std::is_same<IDTYPE, std::string>::value)
+    {
+        return "player" + std::to_string(i);
+    }
+    else
+    {
+        return static_cast<IDTYPE>(i*2654435761u % 1000003);
+    }
+}
+
+
+/**
+ * @brief Rate the same periods with a coordinator and a single engine.
+ *
+ * Includes players created between periods, custom initial values, unknown
+ * players and self-games. All values must be identical.
+ * @param[in]   shardCount  Number of shards.
+ * @param[in]   streaming   Streaming mode of the engines.
+ */
+template <typename IDTYPE> void TestShards(unsigned shardCount, bool streaming)
+{
+    using Engine = glicko::Glicko<IDTYPE>;
+    std::printf("%u shards, %s IDs, streaming %d\n", shardCount, std::is_same<IDTYPE, std::string>::value ? "string" : "int", streaming);
+    std::mt19937 rng{shardCount*10 + streaming};
+    Engine single{0.06, 0.5};
+    single.SetStreaming(streaming);
+    glicko::partition::Coordinator<IDTYPE> partition{shardCount, 0.06, 0.5, [streaming](Engine &engine)
+    {
+        engine.SetStreaming(streaming);
+        engine.SetThreadCount(2);
+    }};
+    std::size_t playerCount = 0;
+    auto create = [&](std::size_t count)
+    {
+        for(std::size_t k = 0; k < count; ++k, ++playerCount)
+        {
+            IDTYPE id = MakeID<IDTYPE>(playerCount);
+            if(playerCount % 3 == 0)
+            {
+                double rating = 1200 + rng() % 600;
+                double deviation = 50 + rng() % 300;
+                single.CreatePlayer(id, rating, deviation, 0.05);
+                partition.CreatePlayer(id, rating, deviation, 0.05);
+            }
+            else
+            {
+                single.CreatePlayer(id);
+                partition.CreatePlayer(id);
+            }
+        }
+    };
+    create(1000);
+    for(int period = 0; period < 5; ++period)
+    {
+        if(period == 2)
+        {
+            create(300);
+        }
+        for(int k = 0; k < 2000; ++k)
+        {
+            std::size_t player1 = rng() % (playerCount + 20);
+            std::size_t player2 = (k % 97 == 0) ? player1 : rng() % (playerCount + 20);
+            auto result = static_cast<glicko::GameResult>(rng() % 3);
+            single.AddGame(MakeID<IDTYPE>(player1), MakeID<IDTYPE>(player2), result);
+            partition.AddGame(MakeID<IDTYPE>(player1), MakeID<IDTYPE>(player2), result);
+        }
+        single.ComputeRatings();
+        partition.ComputeRatings();
+    }
+    for(std::size_t i = 0; i < playerCount; ++i)
+    {
+        IDTYPE id = MakeID<IDTYPE>(i);
+        auto rating = partition.Get(id);
+        CHECK(rating.rating == single.GetRating(id));
+        CHECK(rating.deviation == single.GetDeviation(id));
+        CHECK(rating.volatility == single.GetVolatility(id));
+    }
+    CHECK(partition.GetPlayerCount() == single.GetPlayerCount());
+    CHECK_THROWS(partition.GetRating(MakeID<IDTYPE>(playerCount + 5)));
+    // errors of several shards at once are reported once, all replies are read
+    for(std::size_t i = 0; i < 50; ++i)
+    {
+        partition.CreatePlayer(MakeID<IDTYPE>(i));
+    }
+    CHECK_THROWS(partition.ComputeRatings());
+    CHECK(partition.GetPlayerCount() == single.GetPlayerCount());
+    CHECK(partition.GetRating(MakeID<IDTYPE>(1)) == single.GetRating(MakeID<IDTYPE>(1)));
+}
+
+} // namespace
+
+
+int main()
+{
+    for(unsigned shardCount = 1; shardCount <= 4; ++shardCount)
+    {
+        for(bool streaming : {false, true})
+        {
+            TestShards<int>(shardCount, streaming);
+            TestShards<std::string>(shardCount, streaming);
+        }
+    }
+    return glicko::test::Result();
+}
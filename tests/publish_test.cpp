@@ -0,0 +1,162 @@
+/******************************************************************************//**
+ * @file
+ * @brief Concurrent readers of published rating tables
+ *
+ * @copyright Copyright (C) by Doru Julian Bugariu
+ * julian@bugariu.eu
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the
+ * Free Software Foundation
+ * 51 Franklin Street, Fifth Floor
+ * Boston, MA 02110-1301, USA
+ * http://www.fsf.org/about/contact.html
+ *********************************************************************************/
+
+#include "check.h"
+#include "glicko.h"
+
+#include <atomic>
+#include <cstdio>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+const int       INITIAL_PLAYERS = 1000;     ///< Players before the first period.
+const int       NEW_PLAYERS = 50;           ///< Players added in each period.
+const int       PERIODS = 30;               ///< Number of rating periods.
+const int       GAMES = 5000;               ///< Games per period.
+const unsigned  READERS = 4;                ///< Number of reader threads.
+
+using Rating = glicko::Glicko<int>::Rating;
+
+
+/**
+ * @brief Run the periods of the test.
+ *
+ * Players are added before each period, so the published index grows.
+ * @param[in]   glicko      The engine, publishing after each period.
+ * @param[in]   period      Called after each period with the period number.
+ */
+template <typename CALLBACK> void Run(glicko::Glicko<int> &glicko, CALLBACK period)
+{
+    std::mt19937 rng{3};
+    int playerCount = INITIAL_PLAYERS;
+    for(int i = 0; i < playerCount; ++i)
+    {
+        glicko.CreatePlayer(i);
+    }
+    glicko.PublishRatings();
+    period(0, playerCount);
+    for(int p = 1; p <= PERIODS; ++p)
+    {
+        for(int i = 0; i < NEW_PLAYERS; ++i)
+        {
+            glicko.CreatePlayer(playerCount++);
+        }
+        for(int k = 0; k < GAMES; ++k)
+        {
+            glicko.AddGame(static_cast<int>(rng() % playerCount), static_cast<int>(rng() % playerCount), static_cast<glicko::GameResult>(rng() % 3));
+        }
+        glicko.ComputeRatings();
+        period(p, playerCount);
+    }
+}
+
+
+/**
+ * @brief Check that two ratings are identical.
+ *
+ * @param[in]   a   First rating.
+ * @param[in]   b   Second rating.
+ * @return          true if all values are identical.
+ */
+bool Equal(const Rating &a, const Rating &b)
+{
+    return a.rating == b.rating && a.deviation == b.deviation && a.volatility == b.volatility;
+}
+
+} // namespace
+
+
+int main()
+{
+    // expected values of each period, computed without readers
+    std::vector<std::vector<Rating>> expected(PERIODS + 1);
+    glicko::Glicko<int> reference{0.06, 0.5};
+    reference.SetAutoPublish(true);
+    Run(reference, [&](int period, int playerCount)
+    {
+        auto table = reference.GetRatingTable();
+        for(int i = 0; i < playerCount; ++i)
+        {
+            expected[period].push_back(table->Get(i));
+        }
+    });
+    // the same periods while readers look up ratings
+    glicko::Glicko<int> glicko{0.06, 0.5};
+    glicko.SetAutoPublish(true);
+    glicko.SetThreadCount(2);
+    std::atomic<bool> stop{false};
+    std::atomic<int> failures{0};
+    std::atomic<long> lookups{0};
+    std::vector<std::thread> readers;
+    for(unsigned t = 0; t < READERS; ++t)
+    {
+        readers.emplace_back([&, t]
+        {
+            std::mt19937 rng{t};
+            while(!stop.load())
+            {
+                auto table = glicko.GetRatingTable();
+                // empty table until the engine publishes
+                if(table->Size() == 0)
+                {
+                    continue;
+                }
+                // every table shows exactly the values of one complete period
+                std::uint32_t period = table->GetPeriod();
+                const std::vector<Rating> &values = expected.at(period);
+                bool ok = table->Size() == values.size();
+                for(int k = 0; k < 1000; ++k)
+                {
+                    int id = static_cast<int>(rng() % (values.size() + NEW_PLAYERS));
+                    Rating rating;
+                    bool found = table->Find(id, rating);
+                    ok = ok && (static_cast<std::size_t>(id) < values.size() ? found && Equal(rating, values[id]) : !found);
+                }
+                if(!ok)
+                {
+                    failures.fetch_add(1);
+                }
+                lookups.fetch_add(1000);
+            }
+        });
+    }
+    Run(glicko, [&](int, int)
+    {
+    });
+    stop.store(true);
+    for(std::thread &reader : readers)
+    {
+        reader.join();
+    }
+    std::printf("%ld lookups\n", lookups.load());
+    CHECK(failures.load() == 0);
+    CHECK(glicko.GetRatingTable()->GetPeriod() == PERIODS);
+    CHECK(Equal(glicko.GetRatingTable()->Get(0), expected[PERIODS][0]));
+    return glicko::test::Result();
+}
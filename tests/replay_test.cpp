@@ -0,0 +1,144 @@
+/******************************************************************************//**
+ * @file
+ * @brief Replay of game histories with gaps between the games
+ *
+ * @copyright Copyright (C) by Doru Julian Bugariu
+ * julian@bugariu.eu
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the
+ * Free Software Foundation
+ * 51 Franklin Street, Fifth Floor
+ * Boston, MA 02110-1301, USA
+ * http://www.fsf.org/about/contact.html
+ *********************************************************************************/
+
+#include "check.h"
+#include "replay.h"
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace
+{
+
+using TimedGame = glicko::replay::TimedGame<int>;
+
+
+/**
+ * @brief Check that two values agree up to rounding.
+ *
+ * @param[in]   a   First value.
+ * @param[in]   b   Second value.
+ * @return          true if the relative difference is below 1e-12.
+ */
+bool Near(double a, double b)
+{
+    return std::abs(a - b) <= 1e-12*std::max(1.0, std::abs(b));
+}
+
+
+/**
+ * @brief Create an engine with four players.
+ *
+ * @param[in]   engine      The engine.
+ * @param[in]   streaming   Streaming mode.
+ */
+void Setup(glicko::Glicko<int> &engine, bool streaming)
+{
+    engine.SetStreaming(streaming);
+    for(int i = 0; i < 4; ++i)
+    {
+        engine.CreatePlayer(i, 1400 + 50*i, 60 + 20*i, 0.06);
+    }
+}
+
+
+/**
+ * @brief Replay games with empty periods, compare with single empty periods.
+ *
+ * @param[in]   streaming   Streaming mode.
+ */
+void TestGap(bool streaming)
+{
+    std::vector<TimedGame> history = {{3, 0, 1, glicko::GameResult::Player1}, {12, 2, 3, glicko::GameResult::Draw},
+                                      {55, 0, 2, glicko::GameResult::Player2}, {57, 1, 3, glicko::GameResult::Player1}};
+    glicko::Glicko<int> engine{0.06, 0.5};
+    Setup(engine, streaming);
+    glicko::replay::Replay<int> replay{engine, 0, 10};
+    std::vector<std::uint64_t> periods;
+    replay.SetCallback([&periods](std::uint64_t period, const glicko::Glicko<int> &)
+    {
+        periods.push_back(period);
+    });
+    CHECK(replay.Run(history.begin(), history.end()) == 6);
+    CHECK((periods == std::vector<std::uint64_t>{0, 1, 4, 5}));
+    // the same periods one by one
+    glicko::Glicko<int> expected{0.06, 0.5};
+    Setup(expected, streaming);
+    expected.AddGame(0, 1, glicko::GameResult::Player1);
+    expected.ComputeRatings();
+    expected.AddGame(2, 3, glicko::GameResult::Draw);
+    expected.ComputeRatings();
+    for(int period = 2; period < 5; ++period)
+    {
+        expected.ComputeRatings();
+    }
+    expected.AddGame(0, 2, glicko::GameResult::Player2);
+    expected.AddGame(1, 3, glicko::GameResult::Player1);
+    expected.ComputeRatings();
+    for(int i = 0; i < 4; ++i)
+    {
+        CHECK(Near(engine.GetRating(i), expected.GetRating(i)));
+        CHECK(Near(engine.GetDeviation(i), expected.GetDeviation(i)));
+        CHECK(Near(engine.GetVolatility(i), expected.GetVolatility(i)));
+    }
+}
+
+
+/**
+ * @brief Replay a timestamp far in the future.
+ *
+ * Must take no longer than a few periods, the deviation grows by all missed periods.
+ * @param[in]   streaming   Streaming mode.
+ */
+void TestFarJump(bool streaming)
+{
+    const std::int64_t far = 1000000000000;
+    std::vector<TimedGame> history = {{0, 0, 1, glicko::GameResult::Player1}, {far, 2, 3, glicko::GameResult::Draw}};
+    glicko::Glicko<int> engine{0.06, 0.5};
+    Setup(engine, streaming);
+    glicko::Glicko<int> expected{0.06, 0.5};
+    Setup(expected, streaming);
+    expected.AddGame(0, 1, glicko::GameResult::Player1);
+    expected.ComputeRatings();
+    double phi = expected.GetDeviation(0)/glicko::config::GLICO_CONSTANT;
+    double sigma = expected.GetVolatility(0);
+    glicko::replay::Replay<int> replay{engine, 0, 1};
+    CHECK(replay.Run(history.begin(), history.end()) == static_cast<std::uint64_t>(far) + 1);
+    CHECK(Near(engine.GetRating(0), expected.GetRating(0)));
+    CHECK(Near(engine.GetDeviation(0), glicko::config::GLICO_CONSTANT*std::sqrt(phi*phi + static_cast<double>(far)*sigma*sigma)));
+}
+
+} // namespace
+
+
+int main()
+{
+    TestGap(false);
+    TestGap(true);
+    TestFarJump(false);
+    TestFarJump(true);
+    return glicko::test::Result();
+}
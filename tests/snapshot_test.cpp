@@ -0,0 +1,259 @@
+/******************************************************************************//**
+ * @file
+ * @brief Snapshot round trips and invalid snapshot files
+ *
+ * @copyright Copyright (C) by Doru Julian Bugariu
+ * julian@bugariu.eu
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the
+ * Free Software Foundation
+ * 51 Franklin Street, Fifth Floor
+ * Boston, MA 02110-1301, USA
+ * http://www.fsf.org/about/contact.html
+ *********************************************************************************/
+
+#include "check.h"
+#include "glicko.h"
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+/**
+ * @brief Read a whole file.
+ *
+ * @param[in]   fileName    Name of the file.
+ * @return                  Content of the file.
+ */
+std::string ReadFile(const std::string &fileName)
+{
+    std::ifstream in{fileName, std::ios::binary};
+    return {std::istreambuf_iterator<char>{in}, std::istreambuf_iterator<char>{}};
+}
+
+
+/**
+ * @brief Write a whole file.
+ *
+ * @param[in]   fileName    Name of the file.
+ * @param[in]   content     Content of the file.
+ */
+void WriteFile(const std::string &fileName, const std::string &content)
+{
+    std::ofstream out{fileName, std::ios::binary | std::ios::trunc};
+    out.write(content.data(), static_cast<std::streamsize>(content.size()));
+}
+
+
+/**
+ * @brief Check that two engines have the same players with the same values.
+ *
+ * @param[in]   a       First engine.
+ * @param[in]   b       Second engine.
+ * @param[in]   ids     IDs of the players.
+ */
+template <typename IDTYPE> void CheckEqual(const glicko::Glicko<IDTYPE> &a, const glicko::Glicko<IDTYPE> &b, const std::vector<IDTYPE> &ids)
+{
+    CHECK(a.GetPlayerCount() == b.GetPlayerCount());
+    for(const IDTYPE &id : ids)
+    {
+        CHECK(a.GetRating(id) == b.GetRating(id));
+        CHECK(a.GetDeviation(id) == b.GetDeviation(id));
+        CHECK(a.GetVolatility(id) == b.GetVolatility(id));
+    }
+}
+
+
+/**
+ * @brief Save and load a snapshot, then continue rating on both engines.
+ *
+ * @param[in]   ids         IDs of the players.
+ * @param[in]   fileName    Name of the snapshot file.
+ */
+template <typename IDTYPE> void TestRoundTrip(const std::vector<IDTYPE> &ids, const std::string &fileName)
+{
+    std::mt19937 rng{7};
+    glicko::Glicko<IDTYPE> original{0.05, 0.4};
+    for(const IDTYPE &id : ids)
+    {
+        original.CreatePlayer(id, 1000 + rng() % 1000, 30 + rng() % 300, 0.06);
+    }
+    auto play = [&](glicko::Glicko<IDTYPE> &engine, unsigned seed)
+    {
+        std::mt19937 games{seed};
+        for(std::size_t k = 0; k < 4*ids.size(); ++k)
+        {
+            engine.AddGame(ids[games() % ids.size()], ids[games() % ids.size()], static_cast<glicko::GameResult>(games() % 3));
+        }
+        engine.ComputeRatings();
+    };
+    play(original, 1);
+    original.SaveSnapshot(fileName);
+    // different default volatility and tau, both are taken from the snapshot
+    glicko::Glicko<IDTYPE> loaded{0.01, 0.1};
+    loaded.CreatePlayer(ids[0]);
+    loaded.CreatePlayer(ids[1]);
+    // pending games are deleted by the load
+    loaded.AddGame(ids[0], ids[1], glicko::GameResult::Draw);
+    loaded.AddGameConcurrent(ids[0], ids[1], glicko::GameResult::Player1);
+    loaded.LoadSnapshot(fileName);
+    CheckEqual(original, loaded, ids);
+    play(original, 2);
+    play(loaded, 2);
+    CheckEqual(original, loaded, ids);
+    std::remove(fileName.c_str());
+}
+
+
+/**
+ * @brief Check that loading an invalid snapshot throws and keeps the state.
+ *
+ * @param[in]   engine      Engine to load into.
+ * @param[in]   fileName    Name of the snapshot file.
+ * @param[in]   content     Content of the snapshot file.
+ */
+template <typename IDTYPE> void CheckInvalid(glicko::Glicko<IDTYPE> &engine, const std::string &fileName, const std::string &content)
+{
+    WriteFile(fileName, content);
+    std::size_t count = engine.GetPlayerCount();
+    CHECK_THROWS(engine.LoadSnapshot(fileName));
+    CHECK(engine.GetPlayerCount() == count);
+}
+
+
+/**
+ * @brief Corrupt a snapshot: player count too large for the file, size of the ID
+ *        section wrapped around so that the sum of the sections matches the file size.
+ *
+ * @param[in]   content     Content of the snapshot file.
+ * @return                  The corrupt content.
+ */
+std::string WrapSizes(const std::string &content)
+{
+    glicko::snapshot::Header header;
+    std::memcpy(&header, content.data(), sizeof(header));
+    std::uint64_t available = content.size() - sizeof(header);
+    header.playerCount = available/sizeof(double);
+    header.idBytes = available - 3*header.playerCount*sizeof(double);
+    std::string corrupt = content;
+    corrupt.replace(0, sizeof(header), reinterpret_cast<const char *>(&header), sizeof(header));
+    return corrupt;
+}
+
+
+/**
+ * @brief Load truncated and corrupt snapshots.
+ *
+ * @param[in]   ids         IDs of the players.
+ * @param[in]   fileName    Name of the snapshot file.
+ */
+template <typename IDTYPE> void TestInvalid(const std::vector<IDTYPE> &ids, const std::string &fileName)
+{
+    glicko::Glicko<IDTYPE> original{0.06, 0.5};
+    for(const IDTYPE &id : ids)
+    {
+        original.CreatePlayer(id);
+    }
+    original.SaveSnapshot(fileName);
+    const std::string content = ReadFile(fileName);
+    glicko::Glicko<IDTYPE> engine{0.06, 0.5};
+    engine.CreatePlayer(ids[0]);
+    for(std::size_t size = 0; size < content.size(); ++size)
+    {
+        CheckInvalid(engine, fileName, content.substr(0, size));
+    }
+    CheckInvalid(engine, fileName, content + '\0');
+    std::string corrupt = content;
+    corrupt[0] = 'X';
+    CheckInvalid(engine, fileName, corrupt);
+    // version
+    corrupt = content;
+    corrupt[offsetof(glicko::snapshot::Header, version)] = 9;
+    CheckInvalid(engine, fileName, corrupt);
+    // player count
+    corrupt = content;
+    corrupt[offsetof(glicko::snapshot::Header, playerCount) + 7] = 1;
+    CheckInvalid(engine, fileName, corrupt);
+    CheckInvalid(engine, fileName, WrapSizes(content));
+    // IDs
+    std::size_t idSection = sizeof(glicko::snapshot::Header) + 3*ids.size()*sizeof(double);
+    corrupt = content;
+    if constexpr(std::is_same<IDTYPE, std::string>::value)
+    {
+        // offsets decreasing
+        corrupt[idSection + sizeof(std::uint64_t)] = 127;
+        CheckInvalid(engine, fileName, corrupt);
+        // offset far beyond the characters, followed by valid ones
+        corrupt = content;
+        const std::uint64_t offset = std::uint64_t{1} << 32;
+        corrupt.replace(idSection + sizeof(offset), sizeof(offset), reinterpret_cast<const char *>(&offset), sizeof(offset));
+    }
+    else
+    {
+        // first ID equal to the second one
+        corrupt.replace(idSection, sizeof(IDTYPE), content, idSection + sizeof(IDTYPE), sizeof(IDTYPE));
+    }
+    CheckInvalid(engine, fileName, corrupt);
+    CHECK(engine.GetPlayerCount() == 1 && engine.GetRating(ids[0]) == 1500);
+    CHECK_THROWS(engine.LoadSnapshot(fileName + ".missing"));
+    std::remove(fileName.c_str());
+}
+
+} // namespace
+
+
+int main()
+{
+    std::vector<int> intIDs;
+    std::vector<std::string> stringIDs;
+    for(int i = 0; i < 500; ++i)
+    {
+        intIDs.push_back(7*i - 1000);
+        stringIDs.push_back("player-" + std::to_string(i) + std::string(i % 13, 'x'));
+    }
+    stringIDs.push_back("");
+    TestRoundTrip(intIDs, "snapshot_test_int.snapshot");
+    TestRoundTrip(stringIDs, "snapshot_test_string.snapshot");
+    TestInvalid(std::vector<int>(intIDs.begin(), intIDs.begin() + 5), "snapshot_test_int.snapshot");
+    TestInvalid(std::vector<std::string>(stringIDs.begin(), stringIDs.begin() + 5), "snapshot_test_string.snapshot");
+    // wrapped sizes in a large file, the ID section would be read far past the mapping
+    {
+        glicko::Glicko<std::string> large{0.06, 0.5};
+        for(int i = 0; i < 200000; ++i)
+        {
+            large.CreatePlayer(std::to_string(i));
+        }
+        large.SaveSnapshot("snapshot_test_large.snapshot");
+        WriteFile("snapshot_test_large.snapshot", WrapSizes(ReadFile("snapshot_test_large.snapshot")));
+        CHECK_THROWS(large.LoadSnapshot("snapshot_test_large.snapshot"));
+        CHECK(large.GetPlayerCount() == 200000);
+        std::remove("snapshot_test_large.snapshot");
+    }
+    // snapshot of another ID type
+    glicko::Glicko<std::string> strings{0.06, 0.5};
+    strings.CreatePlayer("a");
+    strings.SaveSnapshot("snapshot_test_type.snapshot");
+    glicko::Glicko<int> ints{0.06, 0.5};
+    CHECK_THROWS(ints.LoadSnapshot("snapshot_test_type.snapshot"));
+    std::remove("snapshot_test_type.snapshot");
+    return glicko::test::Result();
+}
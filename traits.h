@@ -0,0 +1,71 @@
+/******************************************************************************//**
+ * @file
+ * @brief Compile-time configuration of the glicko system
+ *
+ * @copyright Copyright (C) by Doru Julian Bugariu
+ * julian@bugariu.eu
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the
+ * Free Software Foundation
+ * 51 Franklin Street, Fifth Floor
+ * Boston, MA 02110-1301, USA
+ * http://www.fsf.org/about/contact.html
+ *********************************************************************************/
+
+#ifndef GLICKO_TRAITS_H
+#define GLICKO_TRAITS_H
+
+#include "index.h"
+
+namespace glicko
+{
+
+namespace config
+{
+constexpr double GLICO_CONSTANT = 173.7178;                     ///< The glicko constant to convert from glicko to glicko2 ratings.
+constexpr double INITIAL_RATING = 1500;                         ///< Initial glicko rating for a new player.
+constexpr double INITIAL_DEVIATION = 350;                       ///< Initial glicko rating deviation for a new player.
+}
+
+/**
+ * @brief Compile-time configuration of Glicko.
+ *
+ * To change the constants, derive a struct and hide the members to change,
+ * then pass it as second template argument of Glicko.
+ * value_type is the floating-point type of the player table and of the kernels.
+ * float halves the memory traffic of a rating period on large tables; the
+ * volatility is always solved in double. With STATISTICS set, each rating period
+ * collects PeriodStatistics; without it the code for them is not compiled in.
+ * index_type maps player IDs to players, see namespace index for the backends.
+ * The default index::SlotIndex keeps only player indices and reads the IDs
+ * from the engine, so each ID is stored once.
+ * @tparam  VALUE   Floating-point type, float or double.
+ */
+template <typename VALUE>
+struct BasicTraits
+{
+    using value_type = VALUE;                                       ///< Floating-point type of the player table.
+    static constexpr double GLICO_CONSTANT = config::GLICO_CONSTANT;        ///< Conversion from glicko to glicko2 ratings.
+    static constexpr double INITIAL_RATING = config::INITIAL_RATING;        ///< Initial glicko rating for a new player.
+    static constexpr double INITIAL_DEVIATION = config::INITIAL_DEVIATION;  ///< Initial glicko rating deviation for a new player.
+    static constexpr bool STATISTICS = false;                               ///< Collect statistics of each rating period.
+    template <typename IDTYPE> using index_type = index::DefaultIndex<IDTYPE>;   ///< Index of the players.
+};
+
+using DefaultTraits = BasicTraits<double>;  ///< Default configuration, the constants of Glickman's paper in double precision.
+using FloatTraits = BasicTraits<float>;     ///< Player table and kernels in single precision.
+
+} // namespace glicko
+
+#endif // GLICKO_TRAITS_H
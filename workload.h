@@ -0,0 +1,190 @@
+/******************************************************************************//**
+ * @file
+ * @brief Synthetic tournament generator for benchmarks
+ *
+ * @copyright Copyright (C) by Doru Julian Bugariu
+ * julian@bugariu.eu
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the
+ * Free Software Foundation
+ * 51 Franklin Street, Fifth Floor
+ * Boston, MA 02110-1301, USA
+ * http://www.fsf.org/about/contact.html
+ *********************************************************************************/
+
+
+#ifndef GLICKO_WORKLOAD_H
+#define GLICKO_WORKLOAD_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include "glicko.h"
+
+namespace glicko
+{
+
+namespace workload
+{
+
+/**
+ * @brief Distribution of the true skill of the players.
+ */
+enum class SkillDistribution
+{
+    Normal,     ///< Normal distribution with mean and standard deviation skillSpread.
+    Uniform     ///< Uniform distribution in [mean - skillSpread, mean + skillSpread].
+};
+
+
+/**
+ * @brief Settings of a synthetic workload.
+ */
+struct Settings
+{
+    std::size_t         playerCount{100000};                    ///< Number of players.
+    std::size_t         gamesPerPeriod{300000};                 ///< Number of games per rating period.
+    std::uint64_t       seed{1};                                ///< Random seed, same seed gives same workload.
+    SkillDistribution   skillDistribution{SkillDistribution::Normal};   ///< Distribution of the true skill.
+    double              skillMean{1500};                        ///< Mean true skill (glicko scale).
+    double              skillSpread{300};                       ///< Spread of the true skill (glicko scale).
+    double              activityExponent{1.5};                  ///< Pareto exponent of the player activity, 0 for uniform activity.
+    double              drawRate{0.1};                          ///< Probability of a draw.
+};
+
+
+/**
+ * @brief A generated game, with player indices from 0 to playerCount-1.
+ */
+struct Game
+{
+    std::uint32_t   player1;    ///< Index of player 1.
+    std::uint32_t   player2;    ///< Index of player 2.
+    GameResult      result;     ///< Game result.
+};
+
+
+/**
+ * @brief Generator of synthetic tournaments.
+ *
+ * Every player has a true skill and an activity weight. Players of a game are
+ * drawn by activity (heavy-tailed for activityExponent > 0, so a few players
+ * play many games and most play few or none), the winner is drawn from the
+ * logistic expected score of the true skills.
+ */
+class Generator
+{
+public:
+    /**
+     * @brief Constructor.
+     *
+     * @param[in]   settings    Workload settings.
+     */
+    explicit Generator(const Settings &settings):
+        m_Settings{settings},
+        m_Random{settings.seed}
+    {
+        m_Skill.resize(settings.playerCount);
+        m_Activity.resize(settings.playerCount);
+        std::normal_distribution<double> normal{settings.skillMean, settings.skillSpread};
+        std::uniform_real_distribution<double> uniform{settings.skillMean - settings.skillSpread, settings.skillMean + settings.skillSpread};
+        std::uniform_real_distribution<double> unit{0, 1};
+        double total = 0;
+        for(std::size_t i = 0; i < settings.playerCount; ++i)
+        {
+            m_Skill[i] = (settings.skillDistribution == SkillDistribution::Normal) ? normal(m_Random) : uniform(m_Random);
+            // Pareto distributed activity weight
+            double weight = (settings.activityExponent > 0) ? pow(1 - unit(m_Random), -1/settings.activityExponent) : 1;
+            total += weight;
+            m_Activity[i] = total;
+        }
+    }
+    /**
+     * @brief Get workload settings.
+     *
+     * @return  Settings.
+     */
+    const Settings & GetSettings() const
+    {
+        return m_Settings;
+    }
+    /**
+     * @brief Get true skill of a player.
+     *
+     * @param[in]   player  Player index.
+     * @return              True skill (glicko scale).
+     */
+    double GetSkill(std::size_t player) const
+    {
+        return m_Skill[player];
+    }
+    /**
+     * @brief Generate the games of one rating period.
+     *
+     * @return  gamesPerPeriod games.
+     */
+    std::vector<Game> GeneratePeriod()
+    {
+        std::vector<Game> games;
+        games.reserve(m_Settings.gamesPerPeriod);
+        std::uniform_real_distribution<double> unit{0, 1};
+        for(std::size_t i = 0; i < m_Settings.gamesPerPeriod; ++i)
+        {
+            std::uint32_t player1 = DrawPlayer();
+            std::uint32_t player2 = DrawPlayer();
+            while(player2 == player1 && m_Settings.playerCount > 1)
+            {
+                player2 = DrawPlayer();
+            }
+            double expected = 1/(1 + pow(10, (m_Skill[player2] - m_Skill[player1])/400));
+            double x = unit(m_Random);
+            GameResult result = GameResult::Player2;
+            if(x < m_Settings.drawRate)
+            {
+                result = GameResult::Draw;
+            }
+            else if((x - m_Settings.drawRate)/(1 - m_Settings.drawRate) < expected)
+            {
+                result = GameResult::Player1;
+            }
+            games.push_back({player1, player2, result});
+        }
+        return games;
+    }
+private:
+    Settings                m_Settings;     ///< Workload settings.
+    std::mt19937_64         m_Random;       ///< Random generator.
+    std::vector<double>     m_Skill;        ///< True skill of each player.
+    std::vector<double>     m_Activity;     ///< Cumulative activity weights.
+    /**
+     * @brief Draw a player by activity.
+     *
+     * @return  Player index.
+     */
+    std::uint32_t DrawPlayer()
+    {
+        std::uniform_real_distribution<double> unit{0, m_Activity.back()};
+        auto it = std::upper_bound(m_Activity.begin(), m_Activity.end(), unit(m_Random));
+        return static_cast<std::uint32_t>(std::min<std::size_t>(it - m_Activity.begin(), m_Activity.size() - 1));
+    }
+};
+
+} // namespace workload
+
+} // namespace glicko
+
+#endif // GLICKO_WORKLOAD_H